@@ -0,0 +1,550 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bentel_layer.h"
+#include "bentel_layer_private.h"
+#include "bentel_sim.h"
+#include "log_ring.h"
+
+/*
+ * The cost of framing and decoding, per frame type. Valid frames from
+ * the simulated panel are fed to a bentel layer one character per call,
+ * as the UART hands them over:
+ *
+ * bentel_bench [-n bytes] [-t ns_per_byte] [-v]
+ *
+ * One line per response type, then the mixes: all the responses in
+ * turn; with random characters between them; with a truncated frame
+ * before each (the framer has to resync); and the requests and
+ * responses of another master through a listen-only layer. For each it
+ * reports the time per character and per frame through
+ * bentel_layer_received_message (), the time of bentel_message_decode ()
+ * alone on a whole frame, the peak stack depth of one frame through the
+ * layer, and the characters memmove()d per frame.
+ *
+ * Each case runs for about bytes characters (1000000 by default). With
+ * -t it fails if any case takes more than ns_per_byte, so that a run
+ * can gate a change of the framer or the decoder. -v prints the log of
+ * the stack, at debug level, on stderr after the report.
+ */
+
+#define BENTEL_BENCH_BYTES 1000000
+#define BENTEL_BENCH_STREAM_MAX 65536
+#define BENTEL_BENCH_FRAMES 64
+
+#define BENTEL_BENCH_STACK_SIZE (256 * 1024)
+#define BENTEL_BENCH_STACK_PAINT 0xa5
+
+typedef struct _bentel_bench_frame_t bentel_bench_frame_t;
+
+struct _bentel_bench_frame_t
+{
+    bentel_message_type_t request_type;
+    char name[24];
+    uint8_t request[BENTEL_HEADER_SIZE + 32];
+    int request_len;
+    uint8_t response[BENTEL_SIM_FRAME_MAX];
+    int response_len;
+};
+
+typedef struct _bentel_bench_result_t bentel_bench_result_t;
+
+struct _bentel_bench_result_t
+{
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t expected;
+    uint32_t resyncs;
+    uint32_t moved;
+    double ns;
+    double decode_ns;
+    int stack;
+};
+
+static bentel_bench_frame_t frames[BENTEL_BENCH_FRAMES];
+static int frames_count = 0;
+
+static uint8_t stream[BENTEL_BENCH_STREAM_MAX];
+static int stream_len;
+static uint32_t stream_frames;
+
+static bentel_layer_t bentel_layer;
+static uint32_t delivered;
+
+/* stack depth of an empty thread, taken off every measure */
+static int stack_base;
+
+static uint32_t random_state = 1;
+
+static uint32_t
+bentel_bench_random (void)
+{
+    /* xorshift32, as in host/fault_layer.c */
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+static uint64_t
+now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int
+on_message (void * layer, void * message)
+{
+    (void) layer;
+    (void) message;
+
+    delivered++;
+
+    return 0;
+}
+
+static bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_upper_layer_received_message = on_message,
+};
+
+static void
+bentel_bench_name (bentel_message_type_t type, char * name, size_t len)
+{
+    int n;
+
+    if (type == BENTEL_GET_MODEL_REQUEST)
+    {
+        snprintf (name, len, "model");
+    }
+    else if (type == BENTEL_GET_PERIPHERALS_REQUEST)
+    {
+        snprintf (name, len, "peripherals");
+    }
+    else if (type <= BENTEL_GET_ZONES_NAMES_28_31_REQUEST)
+    {
+        n = (type - BENTEL_GET_ZONES_NAMES_0_3_REQUEST) / 2 * 4;
+        snprintf (name, len, "zone names %d-%d", n, n + 3);
+    }
+    else if (type <= BENTEL_GET_PARTITIONS_NAMES_4_7_REQUEST)
+    {
+        n = (type - BENTEL_GET_PARTITIONS_NAMES_0_3_REQUEST) / 2 * 4;
+        snprintf (name, len, "partition names %d-%d", n, n + 3);
+    }
+    else if (type == BENTEL_GET_STATUS_AND_FAULTS_REQUEST)
+    {
+        snprintf (name, len, "status");
+    }
+    else if (type == BENTEL_GET_ARMED_PARTITIONS_REQUEST)
+    {
+        snprintf (name, len, "armed");
+    }
+    else if (type <= BENTEL_GET_LOGGER_28_REQUEST)
+    {
+        snprintf (name, len, "logger %d",
+                  (type - BENTEL_GET_LOGGER_1_REQUEST) / 2 + 1);
+    }
+    else if (type == BENTEL_ARM_PARTITIONS_REQUEST)
+    {
+        snprintf (name, len, "arm");
+    }
+    else if (type == BENTEL_BYPASS_ZONES_REQUEST)
+    {
+        snprintf (name, len, "bypass");
+    }
+    else
+    {
+        snprintf (name, len, "reset");
+    }
+}
+
+/* every request the encoder can produce, and the answer of the panel */
+static void
+bentel_bench_frames_init (void)
+{
+    static bentel_sim_t sim;
+    static bentel_message_t request;
+    bentel_bench_frame_t * frame;
+    int type;
+
+    bentel_sim_init (&sim);
+    bentel_sim_apply (&sim, "events 200");
+
+    for (type = BENTEL_GET_MODEL_REQUEST ;
+         type <= BENTEL_RESET_ALARMS_REQUEST &&
+         frames_count < BENTEL_BENCH_FRAMES ;
+         type += 2)
+    {
+        frame = &frames[frames_count];
+
+        memset (&request, 0, sizeof (request));
+        request.message_type = type;
+
+        frame->request_type = type;
+        frame->request_len = bentel_message_encode (&request, frame->request,
+                                                    sizeof (frame->request));
+        bentel_sim_receive (&sim, frame->request, frame->request_len,
+                            frame->response, &frame->response_len);
+        bentel_bench_name (type, frame->name, sizeof (frame->name));
+
+        if (frame->request_len > 0 && frame->response_len > 0)
+        {
+            frames_count++;
+        }
+    }
+}
+
+static void
+stream_add (const uint8_t * data, int len)
+{
+    if (stream_len + len <= BENTEL_BENCH_STREAM_MAX)
+    {
+        memcpy (&stream[stream_len], data, len);
+        stream_len += len;
+    }
+}
+
+/* the frames from first to last, in turn, until the stream is full */
+static void
+stream_fill (int first, int last, int garbage, bool truncated,
+             bool requests)
+{
+    uint8_t junk[16];
+    bentel_bench_frame_t * frame;
+    bentel_bench_frame_t * other;
+    int len;
+    int n;
+    int i;
+    int k;
+
+    stream_len = 0;
+    stream_frames = 0;
+
+    for (k = 0 ; ; k++)
+    {
+        frame = &frames[first + k % (last - first + 1)];
+
+        len = frame->response_len;
+        len += requests ? frame->request_len : 0;
+        len += garbage + BENTEL_SIM_FRAME_MAX;
+
+        if (stream_len + len > BENTEL_BENCH_STREAM_MAX)
+        {
+            break;
+        }
+
+        if (garbage > 0)
+        {
+            n = bentel_bench_random () % (garbage + 1);
+            for (i = 0 ; i < n ; i++)
+            {
+                junk[i] = bentel_bench_random ();
+            }
+            stream_add (junk, n);
+        }
+
+        if (truncated)
+        {
+            /* the start of another frame, cut after its header */
+            other = &frames[bentel_bench_random () % frames_count];
+            if (other->response_len > BENTEL_HEADER_SIZE + 1)
+            {
+                stream_add (other->response, BENTEL_HEADER_SIZE + 1 +
+                    bentel_bench_random () %
+                        (other->response_len - BENTEL_HEADER_SIZE - 1));
+            }
+        }
+
+        if (requests)
+        {
+            stream_add (frame->request, frame->request_len);
+        }
+
+        stream_add (frame->response, frame->response_len);
+        stream_frames += requests ? 2 : 1;
+    }
+}
+
+static void
+layer_start (bool listen_only)
+{
+    memset (&bentel_layer, 0, sizeof (bentel_layer));
+    bentel_layer.ops = &bentel_layer_ops;
+    bentel_layer.upper_layer = &bentel_layer;
+    bentel_layer.listen_only = listen_only;
+    bentel_layer_start (&bentel_layer);
+}
+
+static void
+layer_feed (const uint8_t * data, int len)
+{
+    int i;
+
+    for (i = 0 ; i < len ; i++)
+    {
+        bentel_layer_received_message (&bentel_layer, (void *) &data[i], 1);
+    }
+}
+
+static void *
+stack_empty (void * arg)
+{
+    return arg;
+}
+
+static void *
+stack_frame (void * arg)
+{
+    bentel_bench_frame_t * frame;
+
+    frame = (bentel_bench_frame_t *) arg;
+
+    if (bentel_layer.listen_only)
+    {
+        layer_feed (frame->request, frame->request_len);
+    }
+    layer_feed (frame->response, frame->response_len);
+
+    return NULL;
+}
+
+/*
+ * The deepest the stack goes in a thread running fn: its stack is
+ * painted first, and the paint that is left is looked for from the
+ * bottom.
+ */
+static int
+stack_depth (void * (*fn) (void *), void * arg)
+{
+    static uint8_t stack[BENTEL_BENCH_STACK_SIZE]
+        __attribute__ ((aligned (64)));
+    pthread_attr_t attr;
+    pthread_t thread;
+    int i;
+
+    memset (stack, BENTEL_BENCH_STACK_PAINT, sizeof (stack));
+
+    pthread_attr_init (&attr);
+    pthread_attr_setstack (&attr, stack, sizeof (stack));
+
+    if (pthread_create (&thread, &attr, fn, arg) != 0)
+    {
+        pthread_attr_destroy (&attr);
+        return -1;
+    }
+
+    pthread_join (thread, NULL);
+    pthread_attr_destroy (&attr);
+
+    for (i = 0 ; i < (int) sizeof (stack) &&
+         stack[i] == BENTEL_BENCH_STACK_PAINT ; i++)
+    {
+    }
+
+    return sizeof (stack) - i;
+}
+
+/* the stream through a layer, repeated for about bytes characters */
+static void
+bentel_bench_run (bentel_bench_result_t * result, bool listen_only,
+                  uint64_t bytes)
+{
+    uint64_t start;
+    uint64_t repeat;
+    uint64_t r;
+
+    memset (result, 0, sizeof (*result));
+
+    repeat = (bytes + stream_len - 1) / stream_len;
+
+    layer_start (listen_only);
+    delivered = 0;
+
+    start = now_ns ();
+
+    for (r = 0 ; r < repeat ; r++)
+    {
+        layer_feed (stream, stream_len);
+    }
+
+    result->ns = now_ns () - start;
+    result->bytes = repeat * stream_len;
+    result->frames = delivered;
+    result->expected = repeat * stream_frames;
+    result->resyncs = bentel_layer.resyncs;
+    result->moved = bentel_layer.moved;
+}
+
+/* bentel_message_decode () alone on a whole frame */
+static double
+bentel_bench_decode (bentel_bench_frame_t * frame, uint64_t bytes)
+{
+    static bentel_message_t message;
+    uint64_t start;
+    uint64_t repeat;
+    uint64_t r;
+
+    repeat = bytes / frame->response_len + 1;
+
+    layer_start (false);
+
+    start = now_ns ();
+
+    for (r = 0 ; r < repeat ; r++)
+    {
+        bentel_message_decode (&bentel_layer, &message, frame->response,
+                               frame->response_len);
+    }
+
+    return (double) (now_ns () - start) / repeat;
+}
+
+static bool
+bentel_bench_report (const char * name, bentel_bench_result_t * result,
+                     double threshold)
+{
+    double ns_per_byte;
+    double frames_per_s;
+
+    ns_per_byte = result->ns / result->bytes;
+    frames_per_s = result->frames / (result->ns / 1e9);
+
+    printf ("%-22s %9.1f %11.0f %9.0f %7d %8.1f %7u/%-7u %s\n",
+            name, ns_per_byte, frames_per_s, result->decode_ns,
+            result->stack,
+            result->frames ? (double) result->moved / result->frames : 0.0,
+            result->frames, result->expected,
+            (threshold > 0 && ns_per_byte > threshold) ? "SLOW" : "");
+
+    return threshold <= 0 || ns_per_byte <= threshold;
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr, "usage: %s [-n bytes] [-t ns_per_byte] [-v]\n", name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    bentel_bench_result_t result;
+    uint64_t bytes = BENTEL_BENCH_BYTES;
+    double threshold = 0;
+    double decode_ns;
+    bool verbose = false;
+    bool pass = true;
+    int stack;
+    int opt;
+    int i;
+
+    while ((opt = getopt (argc, argv, "n:t:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': bytes = strtoull (optarg, NULL, 10); break;
+            case 't': threshold = atof (optarg); break;
+            case 'v': verbose = true; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (bytes == 0)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    if (verbose)
+    {
+        /* the log of the stack at debug level, see src/log_ring.h */
+        log_ring_start ();
+        log_ring_set_level (LOG_LEVEL_DEBUG);
+    }
+
+    bentel_bench_frames_init ();
+
+    stack_base = stack_depth (stack_empty, NULL);
+
+    printf ("%-22s %9s %11s %9s %7s %8s %15s\n", "frame",
+            "ns/byte", "frames/s", "decode ns", "stack", "moved", "delivered");
+
+    for (i = 0 ; i < frames_count ; i++)
+    {
+        stream_fill (i, i, 0, false, false);
+        bentel_bench_run (&result, false, bytes);
+
+        result.decode_ns = bentel_bench_decode (&frames[i], bytes);
+
+        layer_start (false);
+        result.stack = stack_depth (stack_frame, &frames[i]) - stack_base;
+
+        pass = bentel_bench_report (frames[i].name, &result,
+                                    threshold) && pass;
+    }
+
+    /* the mixes, for which decode is the mean over all the frames */
+    decode_ns = 0;
+    stack = 0;
+    for (i = 0 ; i < frames_count ; i++)
+    {
+        decode_ns += bentel_bench_decode (&frames[i],
+                                          bytes / frames_count + 1);
+
+        layer_start (false);
+        if (stack_depth (stack_frame, &frames[i]) - stack_base > stack)
+        {
+            stack = stack_depth (stack_frame, &frames[i]) - stack_base;
+        }
+    }
+    decode_ns /= frames_count;
+
+    stream_fill (0, frames_count - 1, 0, false, false);
+    bentel_bench_run (&result, false, bytes);
+    result.decode_ns = decode_ns;
+    result.stack = stack;
+    pass = bentel_bench_report ("mix", &result, threshold) && pass;
+
+    stream_fill (0, frames_count - 1, 15, false, false);
+    bentel_bench_run (&result, false, bytes);
+    result.decode_ns = decode_ns;
+    result.stack = stack;
+    pass = bentel_bench_report ("mix + garbage", &result,
+                                threshold) && pass;
+
+    stream_fill (0, frames_count - 1, 0, true, false);
+    bentel_bench_run (&result, false, bytes);
+    result.decode_ns = decode_ns;
+    result.stack = stack;
+    pass = bentel_bench_report ("mix + truncated", &result,
+                                threshold) && pass;
+
+    /* a listen-only layer skips the commands */
+    for (i = 0 ; i < frames_count &&
+         frames[i].request_type <= BENTEL_GET_LOGGER_28_REQUEST ; i++)
+    {
+    }
+    stream_fill (0, i - 1, 0, false, true);
+    bentel_bench_run (&result, true, bytes);
+    result.decode_ns = decode_ns;
+    layer_start (true);
+    result.stack = stack_depth (stack_frame, &frames[0]) - stack_base;
+    pass = bentel_bench_report ("listen-only", &result,
+                                threshold) && pass;
+
+    log_ring_flush (stderr);
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "event_log.h"
+#include "flash_store.h"
+
+/*
+ * The event log ring on the file-backed flash, run by ctest in the
+ * default host build:
+ *
+ * bentel_event_log_test
+ *
+ * On a ring of a few sectors in bentel_event_log_test.bin (in the
+ * current directory, removed at the end), more records are appended
+ * than the ring holds, and the log is restarted on the same file as
+ * after a reset. Checked: the head and the sequence numbers found at
+ * boot, the oldest sector reclaimed on each wrap, a restart with a
+ * head sector that was started but has no record yet, event_log_read
+ * with since and max, and event_log_sync telling new events from old
+ * ones by content across a restart. Prints the checks that failed, and
+ * exits with 1 if any did.
+ */
+
+#define TEST_FILE "bentel_event_log_test.bin"
+#define TEST_SECTORS 4
+#define TEST_RECORDS ((int) EVENT_LOG_RECORDS)
+/* a wrap and then some, so the head is in the first sector again */
+#define TEST_APPENDS (TEST_SECTORS * TEST_RECORDS + 100)
+
+static event_log_t test_log;
+static event_log_record_t records[TEST_SECTORS * EVENT_LOG_RECORDS];
+static uint8_t logger[BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE];
+
+static int test_failures;
+
+static void
+test_check (bool ok, const char * what)
+{
+    if (!ok)
+    {
+        fprintf (stderr, "%s failed\n", what);
+        test_failures++;
+    }
+}
+
+/* a record of the test, type 1 with its number in the index and date */
+static void
+test_raw (uint32_t n, uint8_t * raw)
+{
+    raw[0] = 1;
+    raw[1] = (uint8_t) n;
+    raw[2] = (uint8_t) (n >> 8);
+    raw[3] = (uint8_t) (n >> 16);
+    raw[4] = 0;
+    raw[5] = 0;
+    raw[6] = 0;
+}
+
+/* the log as after a reset: only the layout is kept */
+static void
+test_restart (void)
+{
+    memset (&test_log, 0, sizeof (test_log));
+    test_log.offset = FLASH_STORE_EVENTS_OFFSET;
+    test_log.sectors = TEST_SECTORS;
+
+    test_check (flash_store_start () == 0 &&
+                event_log_start (&test_log) == 0, "start");
+}
+
+static void
+test_append (int count)
+{
+    uint8_t raw[BENTEL_EVENT_SIZE];
+    int i;
+
+    for (i = 0 ; i < count ; i++)
+    {
+        test_raw (test_log.next_seq, raw);
+        test_check (event_log_append (&test_log, raw) == 0, "append");
+    }
+}
+
+/*
+ * All the records after since are read back, consecutive from first to
+ * last, each with its own content.
+ */
+static void
+test_read (uint32_t since, uint32_t first, uint32_t last, const char * what)
+{
+    uint8_t raw[BENTEL_EVENT_SIZE];
+    bool ok;
+    int count;
+    int i;
+
+    count = event_log_read (&test_log, since, records,
+                            TEST_SECTORS * EVENT_LOG_RECORDS);
+    ok = count == (int) (last - first + 1);
+
+    for (i = 0 ; ok && i < count ; i++)
+    {
+        test_raw (first + i, raw);
+        ok = records[i].seq == first + i &&
+             memcmp (records[i].raw, raw, BENTEL_EVENT_SIZE) == 0;
+    }
+
+    test_check (ok, what);
+}
+
+static void
+test_wrap (void)
+{
+    test_restart ();
+    test_check (test_log.head == 0 && test_log.slot == 0 &&
+                test_log.next_seq == 1, "format");
+
+    test_append (TEST_APPENDS);
+
+    /* the format, then one erase for each sector started after it */
+    test_check (test_log.head == 0 && test_log.slot == 100 &&
+                test_log.head_sequence == TEST_SECTORS + 1 &&
+                test_log.erased == TEST_SECTORS + 1, "wrap");
+    /* the first sector of the first lap was reclaimed */
+    test_read (0, TEST_RECORDS + 1, TEST_APPENDS, "read after the wrap");
+}
+
+static void
+test_boot (void)
+{
+    test_restart ();
+
+    test_check (test_log.head == 0 && test_log.slot == 100 &&
+                test_log.head_sequence == TEST_SECTORS + 1 &&
+                test_log.next_seq == TEST_APPENDS + 1 &&
+                test_log.erased == 0, "head at boot");
+    test_read (0, TEST_RECORDS + 1, TEST_APPENDS, "read after a restart");
+}
+
+static void
+test_since (void)
+{
+    int count;
+
+    test_read (TEST_APPENDS - 10, TEST_APPENDS - 9, TEST_APPENDS,
+               "since in the head");
+    test_read (2 * TEST_RECORDS + 5, 2 * TEST_RECORDS + 6, TEST_APPENDS,
+               "since in an older sector");
+    test_read (TEST_APPENDS, 1, 0, "since the newest");
+
+    /* max takes the oldest */
+    count = event_log_read (&test_log, 3 * TEST_RECORDS, records, 7);
+    test_check (count == 7 && records[0].seq == 3 * TEST_RECORDS + 1 &&
+                records[6].seq == 3 * TEST_RECORDS + 7, "max");
+}
+
+/*
+ * A reset right after the next sector was started: its header is in
+ * flash, its first record is not.
+ */
+static void
+test_empty_head (void)
+{
+    event_log_header_t header;
+    uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t offset;
+    uint32_t last;
+
+    test_append (TEST_RECORDS - 100 + 1);
+    last = test_log.next_seq - 2;
+
+    offset = FLASH_STORE_EVENTS_OFFSET + test_log.head * FLASH_SECTOR_SIZE;
+    memcpy (&header, flash_store_data (offset), sizeof (header));
+    memset (page, 0xff, sizeof (page));
+    memcpy (page, &header, sizeof (header));
+    test_check (flash_store_erase (offset, FLASH_SECTOR_SIZE) == 0 &&
+                flash_store_program (offset, page, sizeof (page)) == 0,
+                "tearing the head");
+
+    test_restart ();
+
+    test_check (test_log.head == 1 && test_log.slot == 0 &&
+                test_log.head_sequence == TEST_SECTORS + 2 &&
+                test_log.next_seq == last + 1, "empty head at boot");
+
+    /* the lost record's number is given again, with no gap */
+    test_append (1);
+    test_read (0, 2 * TEST_RECORDS + 1, last + 1, "read after an empty head");
+}
+
+/* event i of the panel logger, type 2 so it is none of test_raw () */
+static void
+test_event (int i, uint8_t * raw)
+{
+    raw[0] = 2;
+    raw[1] = (uint8_t) i;
+    raw[2] = 1;
+    raw[3] = 1;
+    raw[4] = 24;
+    raw[5] = 0;
+    raw[6] = (uint8_t) i;
+}
+
+static void
+test_sync (void)
+{
+    int i;
+
+    /* an empty slot of the logger does not decode */
+    memset (logger, 0xff, sizeof (logger));
+
+    for (i = 0 ; i < 20 ; i++)
+    {
+        test_event (i, &logger[i * BENTEL_EVENT_SIZE]);
+    }
+
+    test_check (event_log_sync (&test_log, logger) == 20, "first sync");
+    test_check (event_log_sync (&test_log, logger) == 0, "same sync");
+
+    test_restart ();
+
+    /* the newest records in flash are the logger as it was */
+    test_check (event_log_sync (&test_log, logger) == 0,
+                "same sync after a restart");
+
+    for (i = 20 ; i < 25 ; i++)
+    {
+        test_event (i, &logger[i * BENTEL_EVENT_SIZE]);
+    }
+
+    test_check (event_log_sync (&test_log, logger) == 5,
+                "new events after a restart");
+}
+
+int
+main (void)
+{
+    unlink (TEST_FILE);
+
+    if (setenv ("BENTEL_FLASH_FILE", TEST_FILE, 1) != 0)
+    {
+        perror ("setenv");
+        return 1;
+    }
+
+    test_wrap ();
+    test_boot ();
+    test_since ();
+    test_empty_head ();
+    test_sync ();
+
+    unlink (TEST_FILE);
+
+    if (test_failures > 0)
+    {
+        fprintf (stderr, "bentel_event_log_test: %d checks failed\n",
+                 test_failures);
+        return 1;
+    }
+
+    printf ("bentel_event_log_test: the ring is as expected\n");
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bentel_layer.h"
+#include "bentel_layer_private.h"
+#include "bentel_sim.h"
+#include "fault_layer.h"
+#include "log_ring.h"
+
+/*
+ * How well the bentel layer recovers from a damaged link. Every
+ * request the encoder can produce is answered by the simulated panel,
+ * in turn, and the answer goes through a fault layer to the bentel
+ * layer, all in process, on a clock that counts the time the bytes
+ * take on the link at baud (plus the delays of the fault layer):
+ *
+ * bentel_faults [-f spec] [-n frames] [-b baud] [-l] [-v]
+ *
+ * spec is that of fault_layer_parse (). With -l the bentel layer is
+ * listen-only, and the requests go through the fault layer too. -v
+ * prints the log of the stack, at debug level, on stderr after the
+ * report.
+ *
+ * It reports the frames lost, the resync time (from the first damaged
+ * frame to the next frame delivered) and the throughput against the
+ * same run on a clean link.
+ */
+
+#define BENTEL_FAULTS_FRAMES 10000
+#define BENTEL_FAULTS_REQUESTS 64
+
+typedef struct _bentel_faults_run_t bentel_faults_run_t;
+
+struct _bentel_faults_run_t
+{
+    int frames;
+    uint32_t delivered;
+    uint32_t good;
+    uint32_t wrong;
+    uint32_t resyncs;
+    uint32_t episodes;
+    uint64_t resync_us;
+    uint64_t resync_max_us;
+    uint64_t link_us;
+};
+
+static bentel_message_type_t requests[BENTEL_FAULTS_REQUESTS];
+static int requests_count = 0;
+
+/* what the current frame should deliver */
+static bentel_message_type_t expected;
+static bentel_faults_run_t * run;
+
+static int
+on_message (void * layer, void * message)
+{
+    bentel_message_t * bentel_message;
+
+    (void) layer;
+    bentel_message = (bentel_message_t *) message;
+
+    /* a listen-only layer delivers the request too */
+    if (bentel_message->message_type == expected - 1)
+    {
+        return 0;
+    }
+
+    run->delivered++;
+
+    if (bentel_message->message_type == expected)
+    {
+        run->good++;
+    }
+    else
+    {
+        run->wrong++;
+    }
+
+    return 0;
+}
+
+static bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_upper_layer_received_message = on_message,
+};
+
+static uart_layer_ops_t fault_layer_ops =
+{
+    .to_upper_layer_received_message = &bentel_layer_received_message,
+};
+
+/*
+ * The request types, odd since they alternate with their responses.
+ * A listen-only layer skips the commands, so they are left out.
+ */
+static void
+requests_init (bool listen_only)
+{
+    int type;
+    int last;
+
+    last = listen_only ? BENTEL_GET_LOGGER_28_REQUEST :
+        BENTEL_RESET_ALARMS_REQUEST;
+
+    for (type = BENTEL_GET_MODEL_REQUEST ;
+         type <= last &&
+         requests_count < BENTEL_FAULTS_REQUESTS ;
+         type += 2)
+    {
+        requests[requests_count++] = (bentel_message_type_t) type;
+    }
+}
+
+static void
+bentel_faults_run (bentel_faults_run_t * result, fault_layer_t * faults,
+                   int frames, int baud, bool listen_only)
+{
+    static bentel_sim_t sim;
+    static bentel_layer_t bentel_layer;
+    static bentel_message_t request;
+    unsigned char encoded[128];
+    uint8_t response[BENTEL_SIM_FRAME_MAX];
+    uint64_t delayed_us;
+    uint64_t frame_us;
+    uint64_t since = 0;
+    bool pending = false;
+    uint32_t faults_before;
+    uint32_t good_before;
+    int response_len;
+    int encoded_len;
+    int k;
+
+    memset (result, 0, sizeof (*result));
+    result->frames = frames;
+    run = result;
+
+    bentel_sim_init (&sim);
+    bentel_sim_apply (&sim, "events 200");
+
+    memset (&bentel_layer, 0, sizeof (bentel_layer));
+    bentel_layer.ops = &bentel_layer_ops;
+    bentel_layer.upper_layer = &bentel_layer;
+    bentel_layer.listen_only = listen_only;
+    bentel_layer_start (&bentel_layer);
+
+    faults->upper_layer = &bentel_layer;
+    faults->ops = &fault_layer_ops;
+    fault_layer_start (faults);
+
+    for (k = 0 ; k < frames ; k++)
+    {
+        memset (&request, 0, sizeof (request));
+        request.message_type = requests[k % requests_count];
+        expected = request.message_type + 1;
+
+        encoded_len = bentel_message_encode (&request, encoded, sizeof (encoded));
+        bentel_sim_receive (&sim, encoded, encoded_len, response, &response_len);
+
+        faults_before = fault_layer_faults (faults);
+        good_before = result->good;
+        delayed_us = faults->delayed_us;
+
+        if (listen_only)
+        {
+            fault_layer_received_message (faults, encoded, encoded_len);
+        }
+        fault_layer_received_message (faults, response, response_len);
+
+        /* the request is on the line either way */
+        frame_us = (uint64_t) (encoded_len + response_len) * 10000000u / baud;
+        frame_us += faults->delayed_us - delayed_us;
+
+        if (!pending && fault_layer_faults (faults) != faults_before)
+        {
+            pending = true;
+            since = result->link_us;
+        }
+
+        result->link_us += frame_us;
+
+        if (pending && result->good != good_before)
+        {
+            pending = false;
+            result->episodes++;
+            result->resync_us += result->link_us - since;
+
+            if (result->link_us - since > result->resync_max_us)
+            {
+                result->resync_max_us = result->link_us - since;
+            }
+        }
+    }
+
+    result->resyncs = bentel_layer.resyncs;
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr, "usage: %s [-f spec] [-n frames] [-b baud] [-l] [-v]\n",
+             name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    static fault_layer_t clean;
+    static fault_layer_t faults;
+    bentel_faults_run_t clean_run;
+    bentel_faults_run_t faults_run;
+    bool listen_only = false;
+    bool verbose = false;
+    double clean_rate;
+    double faults_rate;
+    int frames = BENTEL_FAULTS_FRAMES;
+    int baud = 9600;
+    int opt;
+
+    faults.drop = 0.001;
+    faults.corrupt = 0.001;
+    faults.seed = 1;
+
+    while ((opt = getopt (argc, argv, "f:n:b:lvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                if (fault_layer_parse (&faults, optarg) != 0)
+                {
+                    fprintf (stderr, "bad fault spec '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+
+            case 'n': frames = atoi (optarg); break;
+            case 'b': baud = atoi (optarg); break;
+            case 'l': listen_only = true; break;
+            case 'v': verbose = true; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (frames <= 0 || baud <= 0)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    if (verbose)
+    {
+        /* the log of the stack at debug level, see src/log_ring.h */
+        log_ring_start ();
+        log_ring_set_level (LOG_LEVEL_DEBUG);
+    }
+
+    requests_init (listen_only);
+
+    bentel_faults_run (&clean_run, &clean, frames, baud, listen_only);
+    bentel_faults_run (&faults_run, &faults, frames, baud, listen_only);
+
+    clean_rate = clean_run.good / (clean_run.link_us / 1e6);
+    faults_rate = faults_run.good / (faults_run.link_us / 1e6);
+
+    printf ("%d frames at %d baud, %s\n", frames, baud,
+            listen_only ? "listen-only" : "master");
+    printf ("faults: %u of %u bytes (drop %u, dup %u, corrupt %u, "
+            "delay %u)\n", fault_layer_faults (&faults), faults.bytes,
+            faults.dropped, faults.duplicated, faults.corrupted,
+            faults.delayed);
+    printf ("delivered: %u, lost %d (%.2f%%), wrong %u, "
+            "resyncs %u\n", faults_run.good, frames - (int) faults_run.good,
+            100.0 * (frames - (int) faults_run.good) / frames,
+            faults_run.wrong, faults_run.resyncs);
+    printf ("resync time: mean %.1f ms, max %.1f ms over %u "
+            "episodes\n",
+            faults_run.episodes ?
+                faults_run.resync_us / 1e3 / faults_run.episodes : 0.0,
+            faults_run.resync_max_us / 1e3, faults_run.episodes);
+    printf ("throughput: %.1f frames/s clean (%u lost), "
+            "%.1f frames/s with faults (%+.1f%%)\n",
+            clean_rate, frames - clean_run.good, faults_rate,
+            100.0 * (faults_rate - clean_rate) / clean_rate);
+
+    log_ring_flush (stderr);
+
+    /* a clean link must not lose anything */
+    return (clean_run.good == (uint32_t) frames) ? 0 : 1;
+}
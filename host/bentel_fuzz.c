@@ -0,0 +1,667 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bentel_layer.h"
+#include "bentel_layer_private.h"
+#include "bentel_sim.h"
+
+/*
+ * A fuzz target for the receive path: any bytes, as a line with noise
+ * or a hostile device on it could send them. Built with the address
+ * and undefined behaviour sanitizers, see BENTEL_FUZZ in
+ * host/CMakeLists.txt.
+ *
+ * The first byte of an input sets how it is fed: bit 0 a listen-only
+ * layer, bits 1-3 the characters per call (1 to 8, the UART gives 1).
+ * The rest goes to bentel_layer_received_message (), and, as a frame in
+ * a buffer of its exact length, to bentel_message_decode () and
+ * bentel_request_decode (), so that a read past the frame is caught.
+ * Before any input, the encoder and the decoders are checked against
+ * the vectors of src/bentel_protocol.h, see bentel_fuzz_vectors ().
+ *
+ * With Clang this is a libFuzzer target, that takes the options of
+ * libFuzzer:
+ *
+ * bentel_fuzz -max_total_time=600 corpus
+ *
+ * Otherwise it has its own main, which runs the files given, one input
+ * each (so AFL can run it with @@), or without files mutates valid
+ * frames from the simulated panel:
+ *
+ * bentel_fuzz [-n runs] [-s seed] [-w corpus] [file ...]
+ *
+ * -w writes the valid frames to the directory corpus, as seeds for
+ * either.
+ */
+
+#define BENTEL_FUZZ_RUNS 1000000
+#define BENTEL_FUZZ_INPUT_MAX 2048
+#define BENTEL_FUZZ_FRAMES 64
+
+static bentel_layer_t bentel_layer;
+static bentel_layer_t listen_layer;
+static bentel_message_t decoded;
+
+static int
+on_message (void * layer, void * message)
+{
+    bentel_message_t * bentel_message;
+
+    (void) layer;
+    bentel_message = (bentel_message_t *) message;
+
+    if (bentel_message->message_type < BENTEL_GET_MODEL_REQUEST ||
+        bentel_message->message_type > BENTEL_RESET_ALARMS_RESPONSE)
+    {
+        fprintf (stderr, "delivered message type %d\n",
+                 bentel_message->message_type);
+        abort ();
+    }
+
+    return 0;
+}
+
+static bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_upper_layer_received_message = on_message,
+};
+
+/*
+ * The vectors of the protocol table, src/bentel_protocol.h, checked
+ * before any input: for each read, that the simulated panel answers it
+ * with as many bytes, and that a response with a single field set (one
+ * bit, a string, a number) decodes to that field alone; for each
+ * command, that a request with a single field set encodes to its bit
+ * alone, and that the simulated panel acknowledges it. Returns the
+ * vectors that failed.
+ */
+
+static uint8_t
+bentel_fuzz_checksum (const uint8_t * buffer, int len)
+{
+    uint8_t sum = 0;
+    int i;
+
+    for (i = 0 ; i < len ; i++)
+    {
+        sum += buffer[i];
+    }
+
+    return sum;
+}
+
+static int vector_failures;
+
+static void
+bentel_fuzz_vector_check (bool ok, const char * frame, const char * field,
+                          int i)
+{
+    if (!ok)
+    {
+        fprintf (stderr, "vector %s %s, i = %d: failed\n", frame, field, i);
+        vector_failures++;
+    }
+}
+
+/* the response of type with data, decoded into message */
+static bool
+bentel_fuzz_vector_decode (bentel_layer_t * layer, bentel_message_type_t type,
+                           const uint8_t * data, int len,
+                           bentel_message_t * message)
+{
+    static bentel_message_t request;
+    uint8_t frame[BENTEL_SIM_FRAME_MAX];
+
+    memset (&request, 0, sizeof (request));
+    request.message_type = type - 1;
+    bentel_message_encode (&request, frame, sizeof (frame));
+
+    memcpy (&frame[BENTEL_HEADER_SIZE], data, len);
+    frame[BENTEL_HEADER_SIZE + len] = bentel_fuzz_checksum (data, len);
+
+    memset (message, 0, sizeof (*message));
+    memset (layer->logger, 0, sizeof (layer->logger));
+
+    return bentel_message_decode (layer, message, frame,
+                                  BENTEL_HEADER_SIZE + len + 1) ==
+        BENTEL_HEADER_SIZE + len + 1 && message->message_type == type;
+}
+
+static int
+bentel_fuzz_vectors (void)
+{
+    static bentel_layer_t layer;
+    static bentel_sim_t sim;
+    static bentel_message_t expected;
+    static bentel_message_t message;
+    static uint8_t logger[sizeof (layer.logger)];
+    uint8_t data[BENTEL_SIM_FRAME_MAX];
+    uint8_t frame[BENTEL_SIM_FRAME_MAX];
+    uint8_t zero[BENTEL_SIM_FRAME_MAX];
+    uint8_t response[BENTEL_SIM_FRAME_MAX];
+    bentel_message_type_t type;
+    const char * name;
+    int response_len;
+    int frame_len;
+    int zero_len;
+    int data_len;
+    int k;
+    int i;
+
+    vector_failures = 0;
+    bentel_sim_init (&sim);
+
+#define BENTEL_FRAME_READ(NAME, member, address, length, fields)            \
+    {                                                                       \
+        __typeof__ (expected.u.member) * r = &expected.u.member;            \
+                                                                            \
+        (void) r;                                                           \
+        name = #NAME;                                                       \
+        type = BENTEL_##NAME##_RESPONSE;                                    \
+        data_len = (length);                                                \
+                                                                            \
+        memset (&message, 0, sizeof (message));                             \
+        message.message_type = type - 1;                                    \
+        frame_len = bentel_message_encode (&message, frame, sizeof (frame));\
+        bentel_fuzz_vector_check (bentel_request_decode (&message, frame,   \
+                                                         frame_len) ==      \
+                                  BENTEL_HEADER_SIZE &&                     \
+                                  message.message_type == type - 1,         \
+                                  name, "request", 0);                      \
+                                                                            \
+        bentel_sim_receive (&sim, frame, frame_len, response,               \
+                            &response_len);                                 \
+        bentel_fuzz_vector_check (response_len ==                           \
+                                  BENTEL_HEADER_SIZE + data_len + 1 &&      \
+                                  bentel_fuzz_vector_decode (&layer, type,  \
+                                      &response[BENTEL_HEADER_SIZE],        \
+                                      data_len, &message),                  \
+                                  name, "length", 0);                       \
+                                                                            \
+        fields                                                              \
+    }
+
+/* the field ends within the data */
+#define BENTEL_VECTOR_WITHIN(field, end)                                    \
+        bentel_fuzz_vector_check ((end) <= data_len, name, #field, -1);
+/* expected, and the logger, as decoded from data all 0 */
+#define BENTEL_VECTOR_ZERO()                                                \
+        memset (data, 0, data_len);                                         \
+        bentel_fuzz_vector_decode (&layer, type, data, data_len, &expected);\
+        memset (logger, 0, sizeof (logger));
+#define BENTEL_VECTOR_DECODE(field, i)                                      \
+        bentel_fuzz_vector_check (bentel_fuzz_vector_decode (&layer, type,  \
+                                      data, data_len, &message) &&          \
+                                  memcmp (&message, &expected,              \
+                                          sizeof (message)) == 0 &&         \
+                                  memcmp (layer.logger, logger,             \
+                                          sizeof (logger)) == 0,            \
+                                  name, #field, (i));
+#define BENTEL_FIELD_BITS(field, offset, bit, count)                        \
+        BENTEL_VECTOR_WITHIN (field, (offset) + 1)                          \
+        for (i = 0 ; i < (count) ; i++)                                     \
+        {                                                                   \
+            BENTEL_VECTOR_ZERO ()                                           \
+            r->field = true;                                                \
+            data[offset] = 0x01 << ((bit) + i);                             \
+            BENTEL_VECTOR_DECODE (field, i)                                 \
+        }
+#define BENTEL_FIELD_BYTE(field, offset)                                    \
+        BENTEL_VECTOR_WITHIN (field, (offset) + 1)                          \
+        BENTEL_VECTOR_ZERO ()                                               \
+        r->field = true;                                                    \
+        data[offset] = 0x80;                                                \
+        BENTEL_VECTOR_DECODE (field, 0)
+#define BENTEL_FIELD_TEXT(field, offset, length)                            \
+        BENTEL_VECTOR_WITHIN (field, (offset) + (length))                   \
+        BENTEL_VECTOR_ZERO ()                                               \
+        /* the last character is a space, padding */                       \
+        for (k = 0 ; k < (length) ; k++)                                    \
+        {                                                                   \
+            data[(offset) + k] = (k < (length) - 1) ? 'a' + k % 26 : ' ';   \
+            r->field[k] = (k < (length) - 1) ? 'a' + k % 26 : 0;            \
+        }                                                                   \
+        BENTEL_VECTOR_DECODE (field, 0)
+#define BENTEL_FIELD_DIGITS(field, offset, count)                           \
+        BENTEL_VECTOR_WITHIN (field, (offset) + (count))                    \
+        BENTEL_VECTOR_ZERO ()                                               \
+        r->field = 0;                                                       \
+        for (k = 0 ; k < (count) ; k++)                                     \
+        {                                                                   \
+            data[(offset) + k] = '1' + k;                                   \
+            r->field = r->field * 10 + 1 + k;                               \
+        }                                                                   \
+        BENTEL_VECTOR_DECODE (field, 0)
+#define BENTEL_FIELD_LOGGER(index, length)                                  \
+        BENTEL_VECTOR_WITHIN (logger, (length))                             \
+        BENTEL_VECTOR_ZERO ()                                               \
+        for (k = 0 ; k < (length) ; k++)                                    \
+        {                                                                   \
+            data[k] = k + 1;                                                \
+        }                                                                   \
+        memcpy (&logger[index], data, (length));                            \
+        BENTEL_VECTOR_DECODE (logger, (index))
+#include "bentel_protocol.h"
+
+#define BENTEL_FRAME_COMMAND(NAME, member, address, count, length, fields)  \
+    {                                                                       \
+        __typeof__ (message.u.member) * r = &message.u.member;              \
+                                                                            \
+        (void) r;                                                           \
+        name = #NAME;                                                       \
+        type = BENTEL_##NAME##_REQUEST;                                     \
+        data_len = (length);                                                \
+                                                                            \
+        memset (&message, 0, sizeof (message));                             \
+        message.message_type = type;                                        \
+        zero_len = bentel_message_encode (&message, zero, sizeof (zero));   \
+        bentel_fuzz_vector_check (zero_len ==                               \
+                                  BENTEL_HEADER_SIZE + data_len + 1 &&      \
+                                  zero[0] == BENTEL_WRITE,                  \
+                                  name, "length", 0);                       \
+                                                                            \
+        bentel_sim_receive (&sim, zero, zero_len, response, &response_len); \
+        memset (&expected, 0, sizeof (expected));                           \
+        bentel_fuzz_vector_check (response_len == BENTEL_HEADER_SIZE &&     \
+                                  bentel_message_decode (&layer, &expected, \
+                                      response, response_len) ==            \
+                                  BENTEL_HEADER_SIZE &&                     \
+                                  expected.message_type == type + 1,        \
+                                  name, "acknowledgement", 0);              \
+                                                                            \
+        fields                                                              \
+    }
+#define BENTEL_FIELD_BITS(field, offset, bit, count)                        \
+        BENTEL_VECTOR_WITHIN (field, (offset) + 1)                          \
+        for (i = 0 ; i < (count) ; i++)                                     \
+        {                                                                   \
+            memset (&message, 0, sizeof (message));                         \
+            message.message_type = type;                                    \
+            r->field = true;                                                \
+            frame_len = bentel_message_encode (&message, frame,             \
+                                               sizeof (frame));             \
+                                                                            \
+            memcpy (data, zero, zero_len);                                  \
+            data[BENTEL_HEADER_SIZE + (offset)] |= 0x01 << ((bit) + i);     \
+            data[BENTEL_HEADER_SIZE + data_len] =                           \
+                bentel_fuzz_checksum (&data[BENTEL_HEADER_SIZE], data_len); \
+                                                                            \
+            bentel_fuzz_vector_check (frame_len == zero_len &&              \
+                                      memcmp (frame, data, frame_len) == 0, \
+                                      name, #field, i);                     \
+        }
+#define BENTEL_FIELD_VALUE(offset, value)                                   \
+        BENTEL_VECTOR_WITHIN (value, (offset) + 1)                          \
+        bentel_fuzz_vector_check (zero[BENTEL_HEADER_SIZE + (offset)] ==    \
+                                  (value), name, "value", (offset));
+#include "bentel_protocol.h"
+
+#undef BENTEL_VECTOR_WITHIN
+#undef BENTEL_VECTOR_ZERO
+#undef BENTEL_VECTOR_DECODE
+
+    return vector_failures;
+}
+
+int LLVMFuzzerInitialize (int * argc, char *** argv);
+int LLVMFuzzerTestOneInput (const uint8_t * data, size_t size);
+
+int
+LLVMFuzzerInitialize (int * argc, char *** argv)
+{
+    (void) argc;
+    (void) argv;
+
+    /* the log of the stack (src/log_ring.h) is not started */
+
+    if (bentel_fuzz_vectors () != 0)
+    {
+        abort ();
+    }
+
+    return 0;
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t * data, size_t size)
+{
+    bentel_layer_t * layer;
+    unsigned char * frame;
+    size_t chunk;
+    size_t i;
+
+    if (size < 1 || size > BENTEL_FUZZ_INPUT_MAX)
+    {
+        return 0;
+    }
+
+    /* exactly the frame, so that the sanitizer sees any read past it */
+    frame = malloc (size - 1 ? size - 1 : 1);
+    memcpy (frame, &data[1], size - 1);
+
+    memset (&decoded, 0, sizeof (decoded));
+    bentel_message_decode (&bentel_layer, &decoded, frame, size - 1);
+    memset (&decoded, 0, sizeof (decoded));
+    bentel_request_decode (&decoded, frame, size - 1);
+
+    free (frame);
+
+    /* a layer that carries on from the inputs before, as on a line */
+    layer = (data[0] & 0x01) ? &listen_layer : &bentel_layer;
+    chunk = ((data[0] >> 1) & 0x07) + 1;
+
+    for (i = 1 ; i < size ; i += chunk)
+    {
+        bentel_layer_received_message (layer, (void *) &data[i],
+                                       (size - i < chunk) ? size - i : chunk);
+
+        if (layer->buffer_index < 0 ||
+            layer->buffer_index > (int) sizeof (layer->buffer))
+        {
+            fprintf (stderr, "buffer_index %d\n", layer->buffer_index);
+            abort ();
+        }
+    }
+
+    return 0;
+}
+
+static void
+bentel_fuzz_start (void)
+{
+    bentel_layer.ops = &bentel_layer_ops;
+    bentel_layer.upper_layer = &bentel_layer;
+    bentel_layer_start (&bentel_layer);
+
+    listen_layer.ops = &bentel_layer_ops;
+    listen_layer.upper_layer = &listen_layer;
+    listen_layer.listen_only = true;
+    bentel_layer_start (&listen_layer);
+}
+
+#ifdef BENTEL_FUZZ_MAIN
+
+static uint8_t frames[BENTEL_FUZZ_FRAMES][BENTEL_SIM_FRAME_MAX];
+static int frames_len[BENTEL_FUZZ_FRAMES];
+static int frames_count = 0;
+
+static uint32_t random_state = 1;
+
+static uint32_t
+bentel_fuzz_random (void)
+{
+    /* xorshift32, as in host/fault_layer.c */
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+/* the requests the encoder can produce, and the answers of the panel */
+static void
+bentel_fuzz_frames_init (void)
+{
+    static bentel_sim_t sim;
+    static bentel_message_t request;
+    uint8_t encoded[BENTEL_HEADER_SIZE + 32];
+    int encoded_len;
+    int type;
+
+    bentel_sim_init (&sim);
+    bentel_sim_apply (&sim, "events 200");
+    bentel_sim_apply (&sim, "zone 3 alarm 1");
+
+    for (type = BENTEL_GET_MODEL_REQUEST ;
+         type <= BENTEL_RESET_ALARMS_REQUEST &&
+         frames_count + 2 <= BENTEL_FUZZ_FRAMES ;
+         type += 2)
+    {
+        memset (&request, 0, sizeof (request));
+        request.message_type = type;
+
+        encoded_len = bentel_message_encode (&request, encoded,
+                                             sizeof (encoded));
+
+        if (encoded_len <= 0)
+        {
+            continue;
+        }
+
+        memcpy (frames[frames_count], encoded, encoded_len);
+        frames_len[frames_count++] = encoded_len;
+
+        bentel_sim_receive (&sim, encoded, encoded_len,
+                            frames[frames_count], &frames_len[frames_count]);
+
+        if (frames_len[frames_count] > 0)
+        {
+            frames_count++;
+        }
+    }
+}
+
+static int
+bentel_fuzz_write_corpus (const char * dir)
+{
+    char path[512];
+    uint8_t input[BENTEL_SIM_FRAME_MAX + 1];
+    FILE * f;
+    int i;
+
+    mkdir (dir, 0755);
+
+    for (i = 0 ; i < frames_count ; i++)
+    {
+        snprintf (path, sizeof (path), "%s/frame%02d", dir, i);
+
+        /* one character per call, as from the UART */
+        input[0] = 0;
+        memcpy (&input[1], frames[i], frames_len[i]);
+
+        f = fopen (path, "wb");
+
+        if (f == NULL || fwrite (input, 1, frames_len[i] + 1, f) !=
+            (size_t) frames_len[i] + 1)
+        {
+            perror (path);
+            if (f != NULL)
+            {
+                fclose (f);
+            }
+            return -1;
+        }
+
+        fclose (f);
+    }
+
+    return 0;
+}
+
+/* a few valid frames, damaged, or nothing but noise */
+static size_t
+bentel_fuzz_generate (uint8_t * input, size_t len)
+{
+    size_t size = 1;
+    size_t n;
+    int k;
+    int f;
+    int i;
+
+    input[0] = bentel_fuzz_random ();
+
+    if (bentel_fuzz_random () % 8 == 0)
+    {
+        n = bentel_fuzz_random () % 256;
+        for (i = 0 ; i < (int) n ; i++)
+        {
+            input[size++] = bentel_fuzz_random ();
+        }
+        return size;
+    }
+
+    for (k = bentel_fuzz_random () % 8 + 1 ; k > 0 ; k--)
+    {
+        f = bentel_fuzz_random () % frames_count;
+
+        if (size + frames_len[f] > len)
+        {
+            break;
+        }
+
+        memcpy (&input[size], frames[f], frames_len[f]);
+        size += frames_len[f];
+    }
+
+    for (k = bentel_fuzz_random () % 8 ; k > 0 && size > 1 ; k--)
+    {
+        i = 1 + bentel_fuzz_random () % (size - 1);
+
+        switch (bentel_fuzz_random () % 5)
+        {
+            case 0:
+                /* flip a bit */
+                input[i] ^= 1 << (bentel_fuzz_random () % 8);
+                break;
+
+            case 1:
+                /* a random character */
+                input[i] = bentel_fuzz_random ();
+                break;
+
+            case 2:
+                /* lose one */
+                memmove (&input[i], &input[i + 1], size - i - 1);
+                size--;
+                break;
+
+            case 3:
+                /* one more, maybe a start of frame */
+                if (size < len)
+                {
+                    memmove (&input[i + 1], &input[i], size - i);
+                    input[i] = (bentel_fuzz_random () & 1) ? BENTEL_READ :
+                        bentel_fuzz_random ();
+                    size++;
+                }
+                break;
+
+            default:
+                /* cut it short */
+                size = i;
+                break;
+        }
+    }
+
+    return size;
+}
+
+static int
+bentel_fuzz_file (const char * path)
+{
+    static uint8_t input[BENTEL_FUZZ_INPUT_MAX];
+    size_t size;
+    FILE * f;
+
+    f = fopen (path, "rb");
+
+    if (f == NULL)
+    {
+        perror (path);
+        return -1;
+    }
+
+    size = fread (input, 1, sizeof (input), f);
+    fclose (f);
+
+    LLVMFuzzerTestOneInput (input, size);
+
+    return 0;
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr, "usage: %s [-n runs] [-s seed] [-w corpus] [file ...]\n",
+             name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    static uint8_t input[BENTEL_FUZZ_INPUT_MAX];
+    const char * corpus = NULL;
+    long runs = BENTEL_FUZZ_RUNS;
+    long run;
+    size_t size;
+    int opt;
+    int i;
+
+    while ((opt = getopt (argc, argv, "n:s:w:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': runs = atol (optarg); break;
+            case 's': random_state = strtoul (optarg, NULL, 0); break;
+            case 'w': corpus = optarg; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (random_state == 0)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    LLVMFuzzerInitialize (&argc, &argv);
+    bentel_fuzz_start ();
+    bentel_fuzz_frames_init ();
+
+    if (corpus != NULL)
+    {
+        return (bentel_fuzz_write_corpus (corpus) == 0) ? 0 : 1;
+    }
+
+    if (optind < argc)
+    {
+        for (i = optind ; i < argc ; i++)
+        {
+            if (bentel_fuzz_file (argv[i]) != 0)
+            {
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    for (run = 0 ; run < runs ; run++)
+    {
+        size = bentel_fuzz_generate (input, sizeof (input));
+        LLVMFuzzerTestOneInput (input, size);
+    }
+
+    fprintf (stderr, "bentel_fuzz: %ld inputs, %u resyncs, %u listen-only\n",
+             runs, bentel_layer.resyncs, listen_layer.resyncs);
+
+    return 0;
+}
+
+#else
+
+/* libFuzzer has the main, start the layers before it runs */
+__attribute__ ((constructor)) static void
+bentel_fuzz_constructor (void)
+{
+    bentel_fuzz_start ();
+}
+
+#endif /* BENTEL_FUZZ_MAIN */
@@ -0,0 +1,327 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bentel_layer.h"
+#include "bentel_layer_private.h"
+
+/*
+ * Golden frames of the panel protocol, run by ctest in the default
+ * host build:
+ *
+ * bentel_golden
+ *
+ * The frames are written out byte by byte from the layouts of the
+ * hand-written encoder and decoder that src/bentel_protocol.h replaced
+ * (and from the frames captured from a KYO32 in their comments), and
+ * the fields they decode to by hand, so that a mistake in the table
+ * cannot hide in both the frame and what it is checked against, as it
+ * could in the vectors of host/bentel_fuzz.c.
+ *
+ * For a read: the request encodes to its header, the response decodes
+ * to the expected fields, and the response is incomplete without its
+ * last byte and refused with a wrong checksum. For a command: the
+ * request encodes to its frame, and the acknowledge decodes. Prints
+ * the frames that failed, and exits with 1 if any did.
+ */
+
+static bentel_layer_t golden_layer;
+static bentel_message_t decoded;
+static bentel_message_t expected;
+
+static int golden_failures;
+
+static void
+golden_check (bool ok, const char * frame, const char * what)
+{
+    if (!ok)
+    {
+        fprintf (stderr, "%s: %s failed\n", frame, what);
+        golden_failures++;
+    }
+}
+
+/* the request of type, as the layer would send it */
+static int
+golden_encode (bentel_message_type_t type, uint8_t * buffer, int len)
+{
+    static bentel_message_t request;
+
+    memset (&request, 0, sizeof (request));
+    request.message_type = type;
+
+    return bentel_message_encode (&request, buffer, len);
+}
+
+/* expected is filled in by the caller, over all 0 */
+static void
+golden_expect (bentel_message_type_t type)
+{
+    memset (&expected, 0, sizeof (expected));
+    expected.message_type = type;
+}
+
+static void
+golden_read (const char * name, bentel_message_type_t type,
+             const uint8_t * frame, int len)
+{
+    uint8_t buffer[128];
+
+    golden_check (golden_encode (type - 1, buffer, sizeof (buffer)) ==
+                  BENTEL_HEADER_SIZE &&
+                  memcmp (buffer, frame, BENTEL_HEADER_SIZE) == 0,
+                  name, "request");
+
+    memcpy (buffer, frame, len);
+
+    memset (&decoded, 0, sizeof (decoded));
+    golden_check (bentel_message_decode (&golden_layer, &decoded,
+                                         buffer, len) == len &&
+                  memcmp (&decoded, &expected, sizeof (decoded)) == 0,
+                  name, "response");
+
+    memset (&decoded, 0, sizeof (decoded));
+    golden_check (bentel_message_decode (&golden_layer, &decoded,
+                                         buffer, len - 1) == 0,
+                  name, "incomplete response");
+
+    buffer[len - 1] ^= 0x01;
+    golden_check (bentel_message_decode (&golden_layer, &decoded,
+                                         buffer, len) == -2,
+                  name, "bad checksum");
+}
+
+static void
+golden_command (const char * name, const bentel_message_t * request,
+                const uint8_t * frame, int len)
+{
+    static bentel_message_t command;
+    uint8_t buffer[128];
+
+    command = *request;
+    golden_check (bentel_message_encode (&command, buffer,
+                                         sizeof (buffer)) == len &&
+                  memcmp (buffer, frame, len) == 0,
+                  name, "request");
+
+    /* the panel acknowledges with the header of the request */
+    memcpy (buffer, frame, BENTEL_HEADER_SIZE);
+    memset (&decoded, 0, sizeof (decoded));
+    golden_check (bentel_message_decode (&golden_layer, &decoded, buffer,
+                                         BENTEL_HEADER_SIZE) ==
+                  BENTEL_HEADER_SIZE &&
+                  decoded.message_type == request->message_type + 1,
+                  name, "acknowledge");
+}
+
+static void
+golden_model (void)
+{
+    /* a KYO32 with firmware 2.12 */
+    static const uint8_t frame[] =
+    {
+        0xf0, 0x00, 0x00, 0x0b, 0x00, 0xfb,
+        0x4b, 0x59, 0x4f, 0x33, 0x32, 0x20, 0x20, 0x20,
+        0x32, 0x2e, 0x31, 0x32,
+        0x7b,
+    };
+
+    golden_expect (BENTEL_GET_MODEL_RESPONSE);
+    strcpy (expected.u.get_model_response.model, "KYO32");
+    expected.u.get_model_response.fw_major = 2;
+    expected.u.get_model_response.fw_minor = 12;
+
+    golden_read ("model", BENTEL_GET_MODEL_RESPONSE, frame, sizeof (frame));
+}
+
+static void
+golden_peripherals (void)
+{
+    /* one reader and one keyboard, both alive */
+    static const uint8_t frame[] =
+    {
+        0xf0, 0x09, 0xf0, 0x0b, 0x00, 0xf4,
+        0x00, 0x01, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x01, 0x02, 0x01,
+        0x08,
+    };
+
+    golden_expect (BENTEL_GET_PERIPHERALS_RESPONSE);
+    expected.u.get_peripherals_response.readers[0].present = true;
+    expected.u.get_peripherals_response.readers[0].alive = true;
+    expected.u.get_peripherals_response.keyboards[1].present = true;
+    expected.u.get_peripherals_response.keyboards[1].alive = true;
+
+    golden_read ("peripherals", BENTEL_GET_PERIPHERALS_RESPONSE, frame,
+                 sizeof (frame));
+}
+
+static void
+golden_zones_names (void)
+{
+    /* four names of 16 characters, padded with spaces */
+    static const uint8_t frame[] =
+    {
+        0xf0, 0xb0, 0x19, 0x3f, 0x00, 0xf8,
+        /* "INGRESSO        " */
+        0x49, 0x4e, 0x47, 0x52, 0x45, 0x53, 0x53, 0x4f,
+        0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+        /* "FINESTRA CUCINA " */
+        0x46, 0x49, 0x4e, 0x45, 0x53, 0x54, 0x52, 0x41,
+        0x20, 0x43, 0x55, 0x43, 0x49, 0x4e, 0x41, 0x20,
+        /* "                " */
+        0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+        0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+        /* "PORTA GARAGE BOX" */
+        0x50, 0x4f, 0x52, 0x54, 0x41, 0x20, 0x47, 0x41,
+        0x52, 0x41, 0x47, 0x45, 0x20, 0x42, 0x4f, 0x58,
+        0x0f,
+    };
+
+    golden_expect (BENTEL_GET_ZONES_NAMES_0_3_RESPONSE);
+    strcpy (expected.u.get_zones_names_0_3_response.zones[0].name,
+            "INGRESSO");
+    strcpy (expected.u.get_zones_names_0_3_response.zones[1].name,
+            "FINESTRA CUCINA");
+    strcpy (expected.u.get_zones_names_0_3_response.zones[3].name,
+            "PORTA GARAGE BOX");
+
+    golden_read ("zones names 0-3", BENTEL_GET_ZONES_NAMES_0_3_RESPONSE,
+                 frame, sizeof (frame));
+}
+
+static void
+golden_status (void)
+{
+    /*
+     * zones alarm (25-32 first), zones sabotage, faults, partitions
+     * alarm, sabotages
+     */
+    static const uint8_t frame[] =
+    {
+        0xf0, 0x04, 0xf0, 0x0a, 0x00, 0xee,
+        0x01, 0x00, 0x02, 0x80,
+        0x00, 0x00, 0x00, 0x01,
+        0x09, 0x04, 0x84,
+        0x15,
+    };
+
+    golden_expect (BENTEL_GET_STATUS_AND_FAULTS_RESPONSE);
+    expected.u.get_status_and_faults_response.alarm_zone[24] = true;
+    expected.u.get_status_and_faults_response.alarm_zone[9] = true;
+    expected.u.get_status_and_faults_response.alarm_zone[7] = true;
+    expected.u.get_status_and_faults_response.sabotage_zone[0] = true;
+    expected.u.get_status_and_faults_response.alarm_power = true;
+    expected.u.get_status_and_faults_response.alarm_battery_low = true;
+    expected.u.get_status_and_faults_response.alarm_partition[2] = true;
+    expected.u.get_status_and_faults_response.sabotage_partition = true;
+    expected.u.get_status_and_faults_response.sabotage_wireless = true;
+
+    golden_read ("status", BENTEL_GET_STATUS_AND_FAULTS_RESPONSE, frame,
+                 sizeof (frame));
+}
+
+static void
+golden_armed (void)
+{
+    /*
+     * 3 bytes ignored, partitions armed, siren, outputs 9-16, outputs
+     * 1-8, then the zones (25-32 first) included, in alarm memory and
+     * in sabotage memory
+     */
+    static const uint8_t frame[] =
+    {
+        0xf0, 0x02, 0x15, 0x12, 0x00, 0x19,
+        0x00, 0x00, 0x00,
+        0x05, 0x01, 0x01, 0x80,
+        0x80, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x02,
+        0x0e,
+    };
+
+    golden_expect (BENTEL_GET_ARMED_PARTITIONS_RESPONSE);
+    expected.u.get_armed_partitions_response.partition_armed_state[0] = true;
+    expected.u.get_armed_partitions_response.partition_armed_state[2] = true;
+    expected.u.get_armed_partitions_response.siren_state = true;
+    expected.u.get_armed_partitions_response.digital_output_state[8] = true;
+    expected.u.get_armed_partitions_response.digital_output_state[7] = true;
+    expected.u.get_armed_partitions_response.zone_inclusion[31] = true;
+    expected.u.get_armed_partitions_response.zone_inclusion[0] = true;
+    expected.u.get_armed_partitions_response.zone_alarm_memory[10] = true;
+    expected.u.get_armed_partitions_response.zone_sabotage_memory[1] = true;
+
+    golden_read ("armed", BENTEL_GET_ARMED_PARTITIONS_RESPONSE, frame,
+                 sizeof (frame));
+}
+
+static void
+golden_commands (void)
+{
+    static bentel_message_t request;
+    /* total 1 and 3, stay 2, disarm 8 */
+    static const uint8_t arm[] =
+    {
+        0x0f, 0x00, 0xf0, 0x03, 0x00, 0x02,
+        0x05, 0x02, 0x00, 0x80,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x87,
+    };
+    /* exclude 1 and 32, include 10, zones 25-32 first */
+    static const uint8_t bypass[] =
+    {
+        0x0f, 0x01, 0xf0, 0x07, 0x00, 0x07,
+        0x80, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x02, 0x00,
+        0x83,
+    };
+    static const uint8_t reset[] =
+    {
+        0x0f, 0x05, 0xf0, 0x01, 0x00, 0x05,
+        0x07, 0x00,
+        0x07,
+    };
+
+    memset (&request, 0, sizeof (request));
+    request.message_type = BENTEL_ARM_PARTITIONS_REQUEST;
+    request.u.arm_partitions_request.arm[0] = true;
+    request.u.arm_partitions_request.arm[2] = true;
+    request.u.arm_partitions_request.stay[1] = true;
+    request.u.arm_partitions_request.disarm[7] = true;
+    golden_command ("arm", &request, arm, sizeof (arm));
+
+    memset (&request, 0, sizeof (request));
+    request.message_type = BENTEL_BYPASS_ZONES_REQUEST;
+    request.u.bypass_zones_request.exclude[0] = true;
+    request.u.bypass_zones_request.exclude[31] = true;
+    request.u.bypass_zones_request.include[9] = true;
+    golden_command ("bypass", &request, bypass, sizeof (bypass));
+
+    memset (&request, 0, sizeof (request));
+    request.message_type = BENTEL_RESET_ALARMS_REQUEST;
+    golden_command ("reset", &request, reset, sizeof (reset));
+}
+
+int
+main (void)
+{
+    golden_model ();
+    golden_peripherals ();
+    golden_zones_names ();
+    golden_status ();
+    golden_armed ();
+    golden_commands ();
+
+    if (golden_failures > 0)
+    {
+        fprintf (stderr, "bentel_golden: %d checks failed\n",
+                 golden_failures);
+        return 1;
+    }
+
+    printf ("bentel_golden: all frames as expected\n");
+
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pico/time.h>
+
+#include "configuration.h"
+#include "bentel_layer.h"
+#include "capture.h"
+#include "state_machine.h"
+#include "logic.h"
+#include "event_log.h"
+#include "flash_store.h"
+#include "log_ring.h"
+#include "panel.h"
+#include "render.h"
+#include "trace.h"
+#include "tty_layer.h"
+
+/*
+ * The panel protocol stack on Linux: one panel on a tty, wired as in
+ * src/variables.c, polled as core1 polls it in src/main.c. Each change
+ * of the configuration is printed as a line of JSON, as /delta renders
+ * it.
+ *
+ * bentel_host <tty> [seconds]
+ *
+ * The identity cache and the event log go to BENTEL_FLASH_FILE, see
+ * host/flash_store_file.c. If BENTEL_CAPTURE_FILE is set, the link is
+ * captured as /capture does it on the device (see src/capture.h), and
+ * the capture is written there at the end, for bentel_replay. If
+ * BENTEL_TRACE_FILE is set, the stack is traced as /trace does it (see
+ * src/trace.h), for bentel_trace. The log of the stack goes to stderr,
+ * at the level in BENTEL_LOG_LEVEL if set (see src/log_ring.h).
+ */
+
+#define BENTEL_HOST_DELTA_MAX_LEN 16384
+
+/* a few hours of polling at 9600 baud */
+#define BENTEL_HOST_CAPTURE_SIZE (1u << 24)
+
+/* records per core, as many */
+#define BENTEL_HOST_TRACE_SIZE (1u << 20)
+
+configuration_t configuration =
+{
+    .identity_offset = FLASH_STORE_IDENTITY_OFFSET (0),
+};
+
+event_log_t event_log =
+{
+    .offset = FLASH_STORE_EVENTS_OFFSET,
+    .sectors = FLASH_STORE_EVENTS_SECTORS,
+};
+
+/* forward declaration of tty_layer */
+tty_layer_t tty_layer;
+
+bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_lower_layer_start_layer = tty_layer_start,
+    .to_lower_layer_stop_layer = tty_layer_stop,
+    .to_lower_layer_send_message = tty_layer_send_message,
+    .to_upper_layer_received_message = handle_bentel_message,
+};
+
+bentel_layer_t bentel_layer =
+{
+    .ops = &bentel_layer_ops,
+    .lower_layer = &tty_layer,
+    .upper_layer = &configuration,
+};
+
+state_machine_t state_machine =
+{
+    .bentel_layer = &bentel_layer,
+    .configuration = &configuration,
+    .event_log = &event_log,
+};
+
+uart_layer_ops_t tty_layer_ops =
+{
+    .to_upper_layer_received_message = &bentel_layer_received_message,
+};
+
+tty_layer_t tty_layer =
+{
+    .speed = 9600,
+    .upper_layer = &bentel_layer,
+    .ops = &tty_layer_ops,
+    .fd = -1,
+};
+
+panel_t panels[] =
+{
+    {
+        .name = "panel0",
+        .configuration = &configuration,
+        .bentel_layer = &bentel_layer,
+        .state_machine = &state_machine,
+        .event_log = &event_log,
+    },
+};
+
+const int panels_count = sizeof (panels) / sizeof (panels[0]);
+
+capture_t capture =
+{
+    .size = BENTEL_HOST_CAPTURE_SIZE,
+};
+
+trace_t trace_rings[TRACE_CORES] =
+{
+    { .size = BENTEL_HOST_TRACE_SIZE, },
+    { .size = BENTEL_HOST_TRACE_SIZE, },
+};
+
+static char delta[BENTEL_HOST_DELTA_MAX_LEN];
+
+/* print what changed after generation since, and return the new one */
+static uint32_t
+bentel_host_print (configuration_t * configuration, uint32_t since)
+{
+    uint32_t generation;
+    int len;
+
+    sem_acquire_blocking (&configuration->semaphore);
+
+    generation = configuration->generation;
+
+    len = (generation != since) ?
+        render_delta (delta, sizeof (delta), configuration, since) : 0;
+
+    sem_release (&configuration->semaphore);
+
+    if (len < 0)
+    {
+        fprintf (stderr, "delta exceeds %d bytes\n", BENTEL_HOST_DELTA_MAX_LEN);
+    }
+    else if (len > 0)
+    {
+        fprintf (stdout, "{%.*s}\n", len, delta);
+        fflush (stdout);
+    }
+
+    return generation;
+}
+
+static int
+bentel_host_write (const char * path, const uint8_t * buffer, int len)
+{
+    FILE * f;
+
+    f = fopen (path, "wb");
+
+    if (f == NULL || fwrite (buffer, 1, len, f) != (size_t) len)
+    {
+        perror (path);
+        if (f != NULL)
+        {
+            fclose (f);
+        }
+        return -1;
+    }
+
+    fclose (f);
+
+    return 0;
+}
+
+static int
+bentel_host_save_capture (capture_t * capture, const char * path)
+{
+    uint8_t * buffer;
+    int len;
+
+    len = sizeof (capture_header_t) + capture->size;
+    buffer = malloc (len);
+
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+
+    len = capture_read (capture, buffer, len);
+
+    if (len < 0 || bentel_host_write (path, buffer, len) != 0)
+    {
+        free (buffer);
+        return -1;
+    }
+
+    free (buffer);
+
+    return 0;
+}
+
+static int
+bentel_host_save_trace (const char * path)
+{
+    uint8_t * buffer;
+    int len;
+
+    len = sizeof (trace_header_t) +
+        TRACE_CORES * BENTEL_HOST_TRACE_SIZE * sizeof (trace_record_t);
+    buffer = malloc (len);
+
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+
+    len = trace_read (buffer, len);
+
+    if (len < 0 || bentel_host_write (path, buffer, len) != 0)
+    {
+        free (buffer);
+        return -1;
+    }
+
+    free (buffer);
+
+    return 0;
+}
+
+int
+main (int argc, char * argv[])
+{
+    absolute_time_t end;
+    const char * capture_file;
+    const char * trace_file;
+    const char * log_level;
+    uint32_t generation;
+    uint32_t wait;
+    uint32_t w;
+    int seconds;
+    int i;
+
+    if (argc < 2)
+    {
+        fprintf (stderr, "usage: %s <tty> [seconds]\n", argv[0]);
+        return 2;
+    }
+
+    tty_layer.path = argv[1];
+    seconds = (argc > 2) ? atoi (argv[2]) : 0;
+
+    log_ring_start ();
+
+    log_level = getenv ("BENTEL_LOG_LEVEL");
+
+    if (log_level != NULL && log_ring_set_level (atoi (log_level)) != 0)
+    {
+        fprintf (stderr, "BENTEL_LOG_LEVEL: 0 to %d\n", LOG_LEVELS - 1);
+        return 2;
+    }
+
+    if (flash_store_start () != 0)
+    {
+        return 1;
+    }
+
+    capture_file = getenv ("BENTEL_CAPTURE_FILE");
+
+    if (capture_file != NULL)
+    {
+        capture.ring = malloc (capture.size);
+
+        if (capture.ring == NULL)
+        {
+            return 1;
+        }
+
+        tty_layer.capture = &capture;
+        panels[0].capture = &capture;
+    }
+
+    trace_file = getenv ("BENTEL_TRACE_FILE");
+
+    if (trace_file != NULL)
+    {
+        for (i = 0 ; i < TRACE_CORES ; i++)
+        {
+            trace_rings[i].records = calloc (trace_rings[i].size,
+                                             sizeof (trace_record_t));
+
+            if (trace_rings[i].records == NULL)
+            {
+                return 1;
+            }
+        }
+
+        trace_start (trace_rings);
+    }
+
+    for (i = 0 ; i < panel_count () ; i++)
+    {
+        if (panel_start (panel_get (i)) != 0)
+        {
+            return 1;
+        }
+    }
+
+    end = make_timeout_time_ms (seconds * 1000u);
+    generation = 0;
+
+    while (seconds == 0 || absolute_time_diff_us (get_absolute_time (), end) > 0)
+    {
+        wait = STATE_MACHINE_POLL_MS;
+
+        for (i = 0 ; i < panel_count () ; i++)
+        {
+            w = state_machine_next (panel_get (i)->state_machine);
+
+            if (w < wait)
+            {
+                wait = w;
+            }
+        }
+
+        state_machine_wait (wait);
+
+        generation = bentel_host_print (&configuration, generation);
+        log_ring_flush (stderr);
+    }
+
+    log_ring_flush (stderr);
+
+    for (i = 0 ; i < panel_count () ; i++)
+    {
+        panel_stop (panel_get (i));
+    }
+
+    if (capture_file != NULL &&
+        bentel_host_save_capture (&capture, capture_file) != 0)
+    {
+        return 1;
+    }
+
+    if (trace_file != NULL &&
+        bentel_host_save_trace (trace_file) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,619 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bentel_layer.h"
+#include "bentel_layer_private.h"
+#include "bentel_sim.h"
+#include "configuration.h"
+#include "event_log.h"
+#include "flash_store.h"
+#include "log_ring.h"
+#include "logic.h"
+#include "render.h"
+#include "state_machine.h"
+
+/*
+ * How long an alarm takes from the panel to /ha and to the push
+ * channel. The simulated panel, the state machine, the bentel layer,
+ * the configuration and the rendering run in process, in real time,
+ * with the link in between paced at baud as a UART would:
+ *
+ * bentel_latency [-n flips] [-b baud] [-d latency_ms] [-x] [-v]
+ *
+ * Once the identity sweep is over, a zone alarm or a partition armed bit is
+ * flipped in the panel every 1 to 3 s, and the time until the change
+ * is seen is split into stages:
+ *
+ * poll     flip to the request that reads it (0 if one was on its way)
+ * wire     the request, the panel latency and the response at baud
+ * framing  last character to the start of the decode that succeeds
+ * decode   bentel_message_decode ()
+ * config   handle_bentel_message () to the end of configuration_commit ()
+ * render   commit to the end of render_ha () in another thread, as /ha
+ * push     commit to the next MQTT publish (MQTT_PUBLISH_INTVL_MS
+ *          ticks) and its render_delta ()
+ *
+ * with p50, p99 and max of each. The decode and the commit are timed
+ * with the linker's --wrap, so the stack is unchanged. -x leaves out
+ * the event log, as for a panel other than the first (no logger
+ * sweeps in between the polls). -v prints the log of the stack, at
+ * debug level, on stderr after the report.
+ */
+
+#define BENTEL_LATENCY_FLIPS 50
+#define BENTEL_LATENCY_MAX_FLIPS 1000
+#define BENTEL_LATENCY_TIMEOUT_US 60000000u
+/* as in src/mqtt_publisher.c */
+#define BENTEL_LATENCY_PUSH_US 100000u
+#define BENTEL_LATENCY_RENDER_MAX_LEN (8 * 1024)
+
+enum
+{
+    STAGE_POLL = 0,
+    STAGE_WIRE,
+    STAGE_FRAMING,
+    STAGE_DECODE,
+    STAGE_CONFIG,
+    STAGE_RENDER,
+    STAGE_HA,
+    STAGE_PUSH,
+    STAGES,
+};
+
+static const char * stage_names[STAGES] =
+{
+    "poll", "wire", "framing", "decode", "config", "render",
+    "total /ha", "total push",
+};
+
+/* the timestamps of one flip, in us */
+typedef struct _bentel_latency_sample_t bentel_latency_sample_t;
+
+struct _bentel_latency_sample_t
+{
+    uint64_t flip;
+    uint64_t sent;
+    uint64_t last_byte;
+    uint64_t decode_start;
+    uint64_t decode_end;
+    uint64_t committed;
+    uint64_t rendered;
+    uint64_t pushed;
+};
+
+int __real_bentel_message_decode (bentel_layer_t * bentel_layer,
+                                  bentel_message_t * bentel_message,
+                                  unsigned char * buffer, int len);
+int __wrap_bentel_message_decode (bentel_layer_t * bentel_layer,
+                                  bentel_message_t * bentel_message,
+                                  unsigned char * buffer, int len);
+void __real_configuration_commit (configuration_t * configuration);
+void __wrap_configuration_commit (configuration_t * configuration);
+
+static configuration_t configuration =
+{
+    .identity_offset = FLASH_STORE_IDENTITY_OFFSET (0),
+};
+
+static event_log_t event_log =
+{
+    .offset = FLASH_STORE_EVENTS_OFFSET,
+    .sectors = FLASH_STORE_EVENTS_SECTORS,
+};
+
+static bentel_layer_t bentel_layer;
+static state_machine_t state_machine;
+
+static bentel_sim_t sim;
+static int baud = 9600;
+static int latency_ms = 0;
+static uint64_t start_us;
+
+/* the link: one request at a time, as the state machine sends them */
+static pthread_mutex_t link_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t link_cond = PTHREAD_COND_INITIALIZER;
+static uint8_t link_request[BENTEL_SIM_FRAME_MAX];
+static int link_request_len = 0;
+static uint64_t link_sent;
+static volatile bool running = true;
+
+/* the frame going through the stack, only touched by the link thread */
+static uint64_t frame_sent;
+static uint64_t frame_last_byte;
+static uint64_t frame_decode_start;
+static uint64_t frame_decode_end;
+
+/* the flip waiting to be seen, and what is expected */
+static pthread_mutex_t flip_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flip_cond;
+static bool flip_pending = false;
+static bool flip_committed = false;
+static bool flip_zone;
+static int flip_index;
+static bool flip_value;
+static bentel_latency_sample_t flip_sample;
+
+static bentel_latency_sample_t samples[BENTEL_LATENCY_MAX_FLIPS];
+static int samples_count = 0;
+
+static char render_buffer[BENTEL_LATENCY_RENDER_MAX_LEN];
+
+static uint64_t
+now_us (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void
+sleep_until_us (uint64_t us)
+{
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000u;
+    ts.tv_nsec = (us % 1000000u) * 1000;
+
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+static uint64_t
+char_us (int count)
+{
+    /* start bit, 8 data bits, stop bit */
+    return (baud > 0) ? (uint64_t) count * 10000000u / baud : 0;
+}
+
+int
+__wrap_bentel_message_decode (bentel_layer_t * bentel_layer,
+                              bentel_message_t * bentel_message,
+                              unsigned char * buffer, int len)
+{
+    uint64_t decode_start;
+    int i;
+
+    decode_start = now_us ();
+
+    i = __real_bentel_message_decode (bentel_layer, bentel_message,
+                                      buffer, len);
+
+    if (i > 0)
+    {
+        frame_decode_start = decode_start;
+        frame_decode_end = now_us ();
+    }
+
+    return i;
+}
+
+/* with the semaphore held, after handle_bentel_message () updated it */
+void
+__wrap_configuration_commit (configuration_t * configuration)
+{
+    bool value;
+
+    __real_configuration_commit (configuration);
+
+    pthread_mutex_lock (&flip_mutex);
+
+    if (flip_pending && !flip_committed)
+    {
+        value = flip_zone ?
+            configuration->zones[flip_index].alarm :
+            configuration->partitions[flip_index].armed;
+
+        if (value == flip_value)
+        {
+            flip_sample.committed = now_us ();
+            flip_sample.sent = frame_sent;
+            flip_sample.last_byte = frame_last_byte;
+            flip_sample.decode_start = frame_decode_start;
+            flip_sample.decode_end = frame_decode_end;
+            flip_committed = true;
+            pthread_cond_broadcast (&flip_cond);
+        }
+    }
+
+    pthread_mutex_unlock (&flip_mutex);
+}
+
+static int
+link_start (void * layer)
+{
+    (void) layer;
+
+    return 0;
+}
+
+static void
+link_stop (void * layer)
+{
+    (void) layer;
+}
+
+static int
+link_send (void * layer, void * message, int len)
+{
+    (void) layer;
+
+    pthread_mutex_lock (&link_mutex);
+
+    if (len <= (int) sizeof (link_request))
+    {
+        memcpy (link_request, message, len);
+        link_request_len = len;
+        link_sent = now_us ();
+        pthread_cond_signal (&link_cond);
+    }
+
+    pthread_mutex_unlock (&link_mutex);
+
+    return 0;
+}
+
+/* the panel end of the link, and the UART interrupt of the stack */
+static void *
+link_run (void * arg)
+{
+    uint8_t request[BENTEL_SIM_FRAME_MAX];
+    uint8_t response[BENTEL_SIM_FRAME_MAX];
+    uint64_t at;
+    int request_len;
+    int response_len;
+    int i;
+
+    (void) arg;
+
+    while (running)
+    {
+        pthread_mutex_lock (&link_mutex);
+
+        while (running && link_request_len == 0)
+        {
+            pthread_cond_wait (&link_cond, &link_mutex);
+        }
+
+        memcpy (request, link_request, link_request_len);
+        request_len = link_request_len;
+        frame_sent = link_sent;
+        link_request_len = 0;
+
+        pthread_mutex_unlock (&link_mutex);
+
+        if (!running)
+        {
+            break;
+        }
+
+        at = frame_sent + char_us (request_len) + latency_ms * 1000ull;
+        sleep_until_us (at);
+
+        response_len = 0;
+        pthread_mutex_lock (&flip_mutex);
+        bentel_sim_receive (&sim, request, request_len, response,
+                            &response_len);
+        pthread_mutex_unlock (&flip_mutex);
+
+        for (i = 0 ; i < response_len ; i++)
+        {
+            at += char_us (1);
+            sleep_until_us (at);
+
+            frame_last_byte = now_us ();
+            bentel_layer_received_message (&bentel_layer, &response[i], 1);
+        }
+    }
+
+    return NULL;
+}
+
+static bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_lower_layer_start_layer = link_start,
+    .to_lower_layer_stop_layer = link_stop,
+    .to_lower_layer_send_message = link_send,
+    .to_upper_layer_received_message = handle_bentel_message,
+};
+
+/*
+ * Flip, wait for the commit, then render as /ha would in core0, and
+ * as the MQTT publisher would at its next tick.
+ */
+static int
+bentel_latency_flip (int n)
+{
+    bentel_latency_sample_t * sample;
+    struct timespec deadline;
+    uint64_t tick;
+    uint64_t t;
+    int len;
+
+    pthread_mutex_lock (&flip_mutex);
+
+    flip_zone = (n % 2) == 0;
+    flip_index = (n / 2) % (flip_zone ? 32 : 8);
+
+    if (flip_zone)
+    {
+        sim.zone_alarm ^= 1u << flip_index;
+        flip_value = (sim.zone_alarm >> flip_index) & 1;
+    }
+    else
+    {
+        sim.partition_armed ^= 1u << flip_index;
+        flip_value = (sim.partition_armed >> flip_index) & 1;
+    }
+
+    memset (&flip_sample, 0, sizeof (flip_sample));
+    flip_sample.flip = now_us ();
+    flip_pending = true;
+    flip_committed = false;
+
+    t = flip_sample.flip + BENTEL_LATENCY_TIMEOUT_US;
+    deadline.tv_sec = t / 1000000u;
+    deadline.tv_nsec = (t % 1000000u) * 1000;
+
+    while (!flip_committed &&
+           pthread_cond_timedwait (&flip_cond, &flip_mutex, &deadline) !=
+           ETIMEDOUT)
+    {
+    }
+
+    flip_pending = false;
+
+    if (!flip_committed)
+    {
+        pthread_mutex_unlock (&flip_mutex);
+        return -1;
+    }
+
+    sample = &samples[samples_count++];
+    *sample = flip_sample;
+
+    pthread_mutex_unlock (&flip_mutex);
+
+    /* /ha */
+    sem_acquire_blocking (&configuration.semaphore);
+    len = render_ha (render_buffer, sizeof (render_buffer), &configuration);
+    sem_release (&configuration.semaphore);
+    sample->rendered = now_us ();
+
+    /* the next publish, and what it renders */
+    tick = start_us + ((sample->committed - start_us) / BENTEL_LATENCY_PUSH_US + 1) *
+        BENTEL_LATENCY_PUSH_US;
+    sleep_until_us (tick);
+    sem_acquire_blocking (&configuration.semaphore);
+    len = render_delta (render_buffer, sizeof (render_buffer), &configuration,
+                        configuration.generation - 1);
+    sem_release (&configuration.semaphore);
+    sample->pushed = now_us ();
+
+    return (len < 0) ? -1 : 0;
+}
+
+static void *
+bentel_latency_flipper (void * arg)
+{
+    int flips;
+    int n;
+
+    flips = *(int *) arg;
+
+    /*
+     * The identity sweep first, the flips are about the polls (its
+     * requests go in between them, as the logger's).
+     */
+    while (running && (state_machine.state == STATE_START ||
+                       state_machine.identity >= 0))
+    {
+        usleep (100000);
+    }
+
+    for (n = 0 ; running && n < flips ; n++)
+    {
+        usleep (1000000 + rand () % 2000000);
+
+        if (bentel_latency_flip (n) != 0)
+        {
+            fprintf (stderr, "flip %d not seen in %u s\n", n,
+                     BENTEL_LATENCY_TIMEOUT_US / 1000000u);
+        }
+    }
+
+    running = false;
+
+    return NULL;
+}
+
+static uint64_t
+stage_us (bentel_latency_sample_t * sample, int stage)
+{
+    uint64_t from;
+
+    /* a request already on its way when the flip came carries it */
+    from = (sample->sent > sample->flip) ? sample->sent : sample->flip;
+
+    switch (stage)
+    {
+        case STAGE_POLL: return from - sample->flip;
+        case STAGE_WIRE: return sample->last_byte - from;
+        case STAGE_FRAMING: return sample->decode_start - sample->last_byte;
+        case STAGE_DECODE: return sample->decode_end - sample->decode_start;
+        case STAGE_CONFIG: return sample->committed - sample->decode_end;
+        case STAGE_RENDER: return sample->rendered - sample->committed;
+        case STAGE_HA: return sample->rendered - sample->flip;
+        default: return sample->pushed - sample->flip;
+    }
+}
+
+static int
+compare_us (const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void
+bentel_latency_report (void)
+{
+    static uint64_t values[BENTEL_LATENCY_MAX_FLIPS];
+    int stage;
+    int i;
+
+    printf ("%-11s %12s %12s %12s\n", "stage (us)", "p50", "p99",
+            "max");
+
+    for (stage = 0 ; stage < STAGES ; stage++)
+    {
+        for (i = 0 ; i < samples_count ; i++)
+        {
+            values[i] = stage_us (&samples[i], stage);
+        }
+
+        qsort (values, samples_count, sizeof (values[0]), compare_us);
+
+        printf ("%-11s %12llu %12llu %12llu\n", stage_names[stage],
+                (unsigned long long) values[(samples_count - 1) / 2],
+                (unsigned long long) values[(samples_count - 1) * 99 / 100],
+                (unsigned long long) values[samples_count - 1]);
+    }
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr, "usage: %s [-n flips] [-b baud] [-d latency_ms] [-x] [-v]\n",
+             name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    char flash[] = "/tmp/bentel_latency.XXXXXX";
+    pthread_condattr_t condattr;
+    pthread_t link_thread;
+    pthread_t flipper_thread;
+    int flips = BENTEL_LATENCY_FLIPS;
+    bool events = true;
+    bool verbose = false;
+    uint32_t wait;
+    int fd;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "n:b:d:xvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': flips = atoi (optarg); break;
+            case 'b': baud = atoi (optarg); break;
+            case 'd': latency_ms = atoi (optarg); break;
+            case 'x': events = false; break;
+            case 'v': verbose = true; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (flips <= 0 || flips > BENTEL_LATENCY_MAX_FLIPS)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    /* an empty flash of its own, gone when we exit */
+    fd = mkstemp (flash);
+
+    if (fd < 0)
+    {
+        perror (flash);
+        return 1;
+    }
+
+    close (fd);
+    setenv ("BENTEL_FLASH_FILE", flash, 1);
+
+    if (flash_store_start () != 0)
+    {
+        unlink (flash);
+        return 1;
+    }
+
+    unlink (flash);
+
+    if (verbose)
+    {
+        /* the log of the stack at debug level, see src/log_ring.h */
+        log_ring_start ();
+        log_ring_set_level (LOG_LEVEL_DEBUG);
+    }
+
+    bentel_sim_init (&sim);
+    bentel_sim_apply (&sim, "events 20");
+
+    bentel_layer.ops = &bentel_layer_ops;
+    bentel_layer.lower_layer = &bentel_layer;
+    bentel_layer.upper_layer = &configuration;
+
+    state_machine.bentel_layer = &bentel_layer;
+    state_machine.configuration = &configuration;
+    state_machine.event_log = events ? &event_log : NULL;
+
+    configuration_start (&configuration);
+    if (events)
+    {
+        event_log_start (&event_log);
+    }
+    state_machine_start (&state_machine);
+    bentel_layer_start (&bentel_layer);
+
+    /* the deadlines of the flips are on CLOCK_MONOTONIC */
+    pthread_condattr_init (&condattr);
+    pthread_condattr_setclock (&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init (&flip_cond, &condattr);
+
+    start_us = now_us ();
+    srand (1);
+
+    pthread_create (&link_thread, NULL, link_run, NULL);
+    pthread_create (&flipper_thread, NULL, bentel_latency_flipper, &flips);
+
+    /* core1 */
+    while (running)
+    {
+        wait = state_machine_next (&state_machine);
+        state_machine_wait (wait);
+    }
+
+    pthread_join (flipper_thread, NULL);
+
+    pthread_mutex_lock (&link_mutex);
+    pthread_cond_signal (&link_cond);
+    pthread_mutex_unlock (&link_mutex);
+    pthread_join (link_thread, NULL);
+
+    printf ("%d flips seen of %d, %d baud, panel latency %d ms, "
+            "%s\n", samples_count, flips, baud, latency_ms,
+            events ? "with the logger sweeps" : "no event log");
+
+    if (samples_count > 0)
+    {
+        bentel_latency_report ();
+    }
+
+    log_ring_flush (stderr);
+
+    return (samples_count == flips) ? 0 : 1;
+}
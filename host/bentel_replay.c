@@ -0,0 +1,399 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bentel_layer.h"
+#include "capture.h"
+#include "configuration.h"
+#include "crc32.h"
+#include "flash_store.h"
+#include "log_ring.h"
+#include "logic.h"
+#include "render.h"
+
+/*
+ * A capture (see src/capture.h, from /capture or BENTEL_CAPTURE_FILE)
+ * played back through the bentel layer, the decoder and the
+ * configuration, in process:
+ *
+ * bentel_replay [-m] [-l] [-n repeat] [-c digest] [-v] capture
+ *
+ * The received bytes go to a bentel layer as the UART hands them over,
+ * one per call, at the time they were received, or as fast as they can
+ * be taken with -m. With -l the layer is listen-only and gets the sent
+ * bytes too, as if it were on the bus of another master. Each repeat
+ * starts from an empty configuration and flash, so that all of them
+ * end the same.
+ *
+ * It reports the frames, the resyncs and the replay time, and a digest
+ * of the configuration at the end: the CRC-32 of its rendering, as
+ * /delta renders it in full. With -c it fails if that differs, for a
+ * regression check of a capture against a known good build. -v prints
+ * the log of the stack, at debug level, on stderr after the report.
+ */
+
+#define BENTEL_REPLAY_DELTA_MAX_LEN 16384
+
+typedef struct _bentel_replay_record_t bentel_replay_record_t;
+
+struct _bentel_replay_record_t
+{
+    uint64_t at_us;
+    int direction;
+    const uint8_t * data;
+    int len;
+};
+
+static bentel_replay_record_t * records;
+static int records_count = 0;
+
+static configuration_t configuration;
+static bentel_layer_t bentel_layer;
+static uint32_t frames;
+
+static char delta[BENTEL_REPLAY_DELTA_MAX_LEN];
+
+static int
+on_message (void * layer, void * message)
+{
+    frames++;
+
+    return handle_bentel_message (layer, message);
+}
+
+static bentel_layer_ops_t bentel_layer_ops =
+{
+    .to_upper_layer_received_message = on_message,
+};
+
+static uint64_t
+now_us (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void
+sleep_until_us (uint64_t us)
+{
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000u;
+    ts.tv_nsec = (us % 1000000u) * 1000;
+
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+/* the capture, whole, or NULL */
+static uint8_t *
+bentel_replay_read (const char * path, long * len)
+{
+    uint8_t * data;
+    FILE * f;
+
+    f = fopen (path, "rb");
+
+    if (f == NULL)
+    {
+        perror (path);
+        return NULL;
+    }
+
+    fseek (f, 0, SEEK_END);
+    *len = ftell (f);
+    fseek (f, 0, SEEK_SET);
+
+    data = malloc (*len > 0 ? *len : 1);
+
+    if (data == NULL || fread (data, 1, *len, f) != (size_t) *len)
+    {
+        perror (path);
+        free (data);
+        data = NULL;
+    }
+
+    fclose (f);
+
+    return data;
+}
+
+/* split the records after the header, return -1 if they are damaged */
+static int
+bentel_replay_parse (const uint8_t * data, uint32_t len)
+{
+    uint64_t at_us = 0;
+    uint64_t tagged;
+    uint32_t position = 0;
+    int shift;
+    int count;
+
+    /* a record takes 3 bytes at least */
+    records = calloc (len / 3 + 1, sizeof (bentel_replay_record_t));
+
+    if (records == NULL)
+    {
+        return -1;
+    }
+
+    while (position < len)
+    {
+        tagged = 0;
+        shift = 0;
+
+        do
+        {
+            if (position == len || shift >= 64)
+            {
+                return -1;
+            }
+
+            tagged |= (uint64_t) (data[position] & 0x7f) << shift;
+            shift += 7;
+        }
+        while (data[position++] & 0x80);
+
+        if (position == len)
+        {
+            return -1;
+        }
+
+        count = data[position++] + 1;
+
+        if (count > (int) (len - position))
+        {
+            return -1;
+        }
+
+        at_us += tagged >> 1;
+
+        records[records_count].at_us = at_us;
+        records[records_count].direction = tagged & 1;
+        records[records_count].data = &data[position];
+        records[records_count].len = count;
+        records_count++;
+
+        position += count;
+    }
+
+    return 0;
+}
+
+/* one pass over the capture, return the digest of the configuration */
+static uint32_t
+bentel_replay_run (bool max_speed, bool listen_only)
+{
+    uint64_t start;
+    int len;
+    int i;
+    int j;
+
+    memset (&configuration, 0, sizeof (configuration));
+    configuration.identity_offset = FLASH_STORE_IDENTITY_OFFSET (0);
+    configuration_start (&configuration);
+
+    memset (&bentel_layer, 0, sizeof (bentel_layer));
+    bentel_layer.ops = &bentel_layer_ops;
+    bentel_layer.upper_layer = &configuration;
+    bentel_layer.listen_only = listen_only;
+    bentel_layer_start (&bentel_layer);
+
+    start = now_us ();
+
+    for (i = 0 ; i < records_count ; i++)
+    {
+        if (records[i].direction == CAPTURE_TX && !listen_only)
+        {
+            continue;
+        }
+
+        if (!max_speed)
+        {
+            sleep_until_us (start + records[i].at_us);
+        }
+
+        for (j = 0 ; j < records[i].len ; j++)
+        {
+            bentel_layer_received_message (&bentel_layer,
+                                           (void *) &records[i].data[j], 1);
+        }
+    }
+
+    bentel_layer_stop (&bentel_layer);
+
+    len = render_delta (delta, sizeof (delta), &configuration, 0);
+    configuration_stop (&configuration);
+
+    return (len < 0) ? 0 : crc32 (delta, len);
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr,
+             "usage: %s [-m] [-l] [-n repeat] [-c digest] [-v] capture\n",
+             name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    char flash[] = "/tmp/bentel_replay.XXXXXX";
+    capture_header_t header;
+    uint64_t start;
+    uint64_t elapsed;
+    uint64_t rx_bytes = 0;
+    uint64_t tx_bytes = 0;
+    uint32_t digest = 0;
+    uint32_t first = 0;
+    uint32_t expected = 0;
+    uint32_t resyncs = 0;
+    bool check = false;
+    bool max_speed = false;
+    bool listen_only = false;
+    bool verbose = false;
+    bool stable = true;
+    uint8_t * data;
+    long len;
+    int repeat = 1;
+    int fd;
+    int opt;
+    int i;
+
+    while ((opt = getopt (argc, argv, "mln:c:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': max_speed = true; break;
+            case 'l': listen_only = true; break;
+            case 'n': repeat = atoi (optarg); break;
+            case 'c': expected = strtoul (optarg, NULL, 16); check = true; break;
+            case 'v': verbose = true; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind != argc - 1 || repeat <= 0)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    data = bentel_replay_read (argv[optind], &len);
+
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    if (len < (long) sizeof (header))
+    {
+        fprintf (stderr, "%s: too short for a capture\n", argv[optind]);
+        return 1;
+    }
+
+    memcpy (&header, data, sizeof (header));
+
+    if (memcmp (header.magic, CAPTURE_MAGIC, sizeof (header.magic)) != 0 ||
+        header.version != CAPTURE_VERSION ||
+        header.len > len - sizeof (header) ||
+        bentel_replay_parse (&data[sizeof (header)], header.len) != 0)
+    {
+        fprintf (stderr, "%s: not a capture, or damaged\n", argv[optind]);
+        return 1;
+    }
+
+    for (i = 0 ; i < records_count ; i++)
+    {
+        if (records[i].direction == CAPTURE_RX)
+        {
+            rx_bytes += records[i].len;
+        }
+        else
+        {
+            tx_bytes += records[i].len;
+        }
+    }
+
+    /* an empty flash of its own, gone when we exit */
+    fd = mkstemp (flash);
+
+    if (fd < 0)
+    {
+        perror (flash);
+        return 1;
+    }
+
+    close (fd);
+    setenv ("BENTEL_FLASH_FILE", flash, 1);
+
+    if (flash_store_start () != 0)
+    {
+        unlink (flash);
+        return 1;
+    }
+
+    unlink (flash);
+
+    if (verbose)
+    {
+        /* the log of the stack at debug level, see src/log_ring.h */
+        log_ring_start ();
+        log_ring_set_level (LOG_LEVEL_DEBUG);
+    }
+
+    frames = 0;
+    start = now_us ();
+
+    for (i = 0 ; i < repeat ; i++)
+    {
+        digest = bentel_replay_run (max_speed, listen_only);
+        resyncs += bentel_layer.resyncs;
+
+        if (i == 0)
+        {
+            first = digest;
+        }
+        else if (digest != first)
+        {
+            stable = false;
+        }
+    }
+
+    elapsed = now_us () - start;
+
+    printf ("capture: %d records, %llu bytes received, %llu sent, "
+            "%.3f s, %u records dropped\n", records_count,
+            (unsigned long long) rx_bytes, (unsigned long long) tx_bytes,
+            records_count ? records[records_count - 1].at_us / 1e6 : 0.0,
+            header.dropped);
+    printf ("replay: %d x %s%s, %u frames, %u resyncs\n", repeat,
+            max_speed ? "max speed" : "original speed",
+            listen_only ? ", listen-only" : "", frames, resyncs);
+    printf ("time: %.3f s, %.2f MB/s, %.0f frames/s\n",
+            elapsed / 1e6,
+            (listen_only ? rx_bytes + tx_bytes : rx_bytes) * repeat /
+                (elapsed > 0 ? (double) elapsed : 1.0),
+            frames / (elapsed > 0 ? elapsed / 1e6 : 1.0));
+    printf ("digest: %08x%s\n", digest,
+            stable ? "" : " (differs between repeats)");
+
+    log_ring_flush (stderr);
+
+    if (!stable || (check && digest != expected))
+    {
+        return 1;
+    }
+
+    return 0;
+}
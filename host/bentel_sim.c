@@ -0,0 +1,755 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bentel_sim.h"
+
+/* the names of /delta, in the order of bentel_sim_t.faults */
+static const char * bentel_sim_faults[] =
+{
+    "alarm_power",
+    "alarm_bpi",
+    "alarm_fuse",
+    "alarm_battery_low",
+    "alarm_telephone_line",
+    "alarm_default_codes",
+    "alarm_wireless",
+    "sabotage_partition",
+    "sabotage_fake_key",
+    "sabotage_bpi",
+    "sabotage_system",
+    "sabotage_jam",
+    "sabotage_wireless",
+};
+
+#define BENTEL_SIM_FAULTS \
+    (int) (sizeof (bentel_sim_faults) / sizeof (bentel_sim_faults[0]))
+
+/* the warnings come first, the sabotages from bit 2 of their byte */
+#define BENTEL_SIM_WARNINGS 7
+
+typedef struct _bentel_sim_region_t bentel_sim_region_t;
+
+struct _bentel_sim_region_t
+{
+    uint16_t address;
+    uint16_t size;
+    void (*render) (bentel_sim_t * sim, uint8_t * data);
+};
+
+/* the three commands: address, and bytes after the header */
+typedef struct _bentel_sim_command_t bentel_sim_command_t;
+
+struct _bentel_sim_command_t
+{
+    uint16_t address;
+    int size;
+    void (*apply) (bentel_sim_t * sim, const uint8_t * data);
+};
+
+static uint8_t
+bentel_sim_checksum (const uint8_t * buffer, int len)
+{
+    int i;
+    uint8_t to_return = 0;
+
+    for (i = 0 ; i < len ; i++)
+    {
+        to_return += buffer[i];
+    }
+
+    return to_return;
+}
+
+/* 32 zones in 4 bytes, zones 25-32 first */
+static void
+bentel_sim_put_zones (uint8_t * data, uint32_t mask)
+{
+    data[0] = (mask >> 24) & 0xff;
+    data[1] = (mask >> 16) & 0xff;
+    data[2] = (mask >> 8) & 0xff;
+    data[3] = mask & 0xff;
+}
+
+static uint32_t
+bentel_sim_get_zones (const uint8_t * data)
+{
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+           ((uint32_t) data[2] << 8) | data[3];
+}
+
+/* names are 16 characters, padded with spaces, not NUL terminated */
+static void
+bentel_sim_put_name (uint8_t * data, const char * name)
+{
+    size_t len;
+
+    len = strlen (name);
+    memset (data, ' ', 16);
+    memcpy (data, name, len < 16 ? len : 16);
+}
+
+static void
+bentel_sim_render_model (bentel_sim_t * sim, uint8_t * data)
+{
+    /* room for a negative version, "-9.-99" */
+    char fw[8];
+    size_t len;
+
+    /* KYO32   2.12 */
+    len = strlen (sim->model);
+    memset (data, ' ', 8);
+    memcpy (data, sim->model, len < 8 ? len : 8);
+    snprintf (fw, sizeof (fw), "%d.%02d", sim->fw_major % 10,
+              sim->fw_minor % 100);
+    memcpy (&data[8], fw, 4);
+}
+
+static void
+bentel_sim_render_peripherals (bentel_sim_t * sim, uint8_t * data)
+{
+    data[0] = sim->readers_present >> 8;
+    data[1] = sim->readers_present & 0xff;
+    data[2] = sim->keyboards_present;
+    data[4] = sim->readers_sabotage >> 8;
+    data[5] = sim->readers_sabotage & 0xff;
+    data[6] = sim->keyboards_sabotage;
+    data[8] = sim->readers_alive >> 8;
+    data[9] = sim->readers_alive & 0xff;
+    data[10] = sim->keyboards_alive;
+}
+
+static void
+bentel_sim_render_zone_names (bentel_sim_t * sim, uint8_t * data)
+{
+    int i;
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        bentel_sim_put_name (&data[i * 16], sim->zone_names[i]);
+    }
+}
+
+static void
+bentel_sim_render_partition_names (bentel_sim_t * sim, uint8_t * data)
+{
+    int i;
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        bentel_sim_put_name (&data[i * 16], sim->partition_names[i]);
+    }
+}
+
+static void
+bentel_sim_render_status (bentel_sim_t * sim, uint8_t * data)
+{
+    bentel_sim_put_zones (&data[0], sim->zone_alarm);
+    bentel_sim_put_zones (&data[4], sim->zone_sabotage);
+    data[8] = sim->faults & ((1u << BENTEL_SIM_WARNINGS) - 1);
+    data[9] = sim->partition_alarm;
+    data[10] = (sim->faults >> BENTEL_SIM_WARNINGS) << 2;
+}
+
+static void
+bentel_sim_render_armed (bentel_sim_t * sim, uint8_t * data)
+{
+    data[3] = sim->partition_armed;
+    data[4] = sim->siren ? 1 : 0;
+    data[5] = sim->outputs >> 8;
+    data[6] = sim->outputs & 0xff;
+    bentel_sim_put_zones (&data[7], sim->zone_inclusion);
+    bentel_sim_put_zones (&data[11], sim->zone_alarm_memory);
+    bentel_sim_put_zones (&data[15], sim->zone_sabotage_memory);
+}
+
+static void
+bentel_sim_render_logger (bentel_sim_t * sim, uint8_t * data)
+{
+    memcpy (data, sim->logger, sizeof (sim->logger));
+}
+
+static const bentel_sim_region_t bentel_sim_regions[] =
+{
+    { 0x0000, 12, bentel_sim_render_model },
+    { 0xf009, 12, bentel_sim_render_peripherals },
+    { 0x19b0, 32 * 16, bentel_sim_render_zone_names },
+    { 0x1750, 8 * 16, bentel_sim_render_partition_names },
+    { 0xf004, 11, bentel_sim_render_status },
+    { 0x1502, 19, bentel_sim_render_armed },
+    { 0x0d3d, BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE, bentel_sim_render_logger },
+};
+
+#define BENTEL_SIM_REGIONS \
+    (int) (sizeof (bentel_sim_regions) / sizeof (bentel_sim_regions[0]))
+
+/* len bytes of the memory map from address */
+static void
+bentel_sim_read (bentel_sim_t * sim, uint16_t address, uint8_t * data, int len)
+{
+    static uint8_t region[BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE];
+    const bentel_sim_region_t * r;
+    int i;
+    int j;
+
+    memset (data, 0, len);
+
+    for (i = 0 ; i < BENTEL_SIM_REGIONS ; i++)
+    {
+        r = &bentel_sim_regions[i];
+
+        if (address + len <= r->address || address >= r->address + r->size)
+        {
+            continue;
+        }
+
+        memset (region, 0, r->size);
+        r->render (sim, region);
+
+        for (j = 0 ; j < len ; j++)
+        {
+            if (address + j >= r->address && address + j < r->address + r->size)
+            {
+                data[j] = region[address + j - r->address];
+            }
+        }
+    }
+}
+
+static void
+bentel_sim_apply_arm (bentel_sim_t * sim, const uint8_t * data)
+{
+    uint8_t arm;
+    uint8_t disarm;
+    int i;
+
+    /* total and stay both arm, the panel tells them apart */
+    arm = data[0] | data[1];
+    disarm = data[3];
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        if ((arm & ~sim->partition_armed) & (1u << i))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_PARTITION_INCLUSION, i);
+        }
+        if ((disarm & sim->partition_armed) & (1u << i))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_PARTITION_EXCLUSION, i);
+        }
+    }
+
+    sim->partition_armed = (sim->partition_armed | arm) & ~disarm;
+}
+
+static void
+bentel_sim_apply_bypass (bentel_sim_t * sim, const uint8_t * data)
+{
+    uint32_t exclude;
+    uint32_t include;
+    int i;
+
+    exclude = bentel_sim_get_zones (&data[0]);
+    include = bentel_sim_get_zones (&data[4]);
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        if ((exclude & sim->zone_inclusion) & (1u << i))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_ZONE_EXCLUSION, i);
+        }
+        if ((include & ~sim->zone_inclusion) & (1u << i))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_ZONE_REINCLUSION, i);
+        }
+    }
+
+    sim->zone_inclusion = (sim->zone_inclusion & ~exclude) | include;
+}
+
+static void
+bentel_sim_apply_reset (bentel_sim_t * sim, const uint8_t * data)
+{
+    int i;
+
+    (void) data;
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        if (sim->partition_alarm & (1u << i))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_RESET_MEMORY_PARTITION, i);
+        }
+    }
+
+    sim->zone_alarm_memory = 0;
+    sim->zone_sabotage_memory = 0;
+    sim->partition_alarm = 0;
+    sim->siren = false;
+}
+
+static const bentel_sim_command_t bentel_sim_commands[] =
+{
+    { 0xf000, 20, bentel_sim_apply_arm },
+    { 0xf001, 9, bentel_sim_apply_bypass },
+    { 0xf005, 3, bentel_sim_apply_reset },
+};
+
+#define BENTEL_SIM_COMMANDS \
+    (int) (sizeof (bentel_sim_commands) / sizeof (bentel_sim_commands[0]))
+
+void
+bentel_sim_init (bentel_sim_t * sim)
+{
+    int i;
+
+    memset (sim, 0, sizeof (*sim));
+
+    snprintf (sim->model, sizeof (sim->model), "KYO32");
+    sim->fw_major = 2;
+    sim->fw_minor = 12;
+
+    sim->readers_present = 0x0001;
+    sim->readers_alive = 0x0001;
+    sim->keyboards_present = 0x01;
+    sim->keyboards_alive = 0x01;
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        snprintf (sim->zone_names[i], sizeof (sim->zone_names[i]),
+                  "Zone %d", i + 1);
+    }
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        snprintf (sim->partition_names[i], sizeof (sim->partition_names[i]),
+                  "Partition %d", i + 1);
+    }
+
+    sim->zone_inclusion = 0xffffffff;
+}
+
+void
+bentel_sim_log (bentel_sim_t * sim, bentel_event_type_t type, int index)
+{
+    uint8_t * raw;
+    struct tm tm;
+    time_t now;
+
+    now = time (NULL);
+    localtime_r (&now, &tm);
+
+    raw = &sim->logger[sim->logger_next * BENTEL_EVENT_SIZE];
+
+    raw[0] = (uint8_t) type;
+    raw[1] = (uint8_t) index;
+    raw[2] = tm.tm_mday;
+    raw[3] = tm.tm_mon + 1;
+    raw[4] = tm.tm_year % 100;
+    raw[5] = tm.tm_hour;
+    raw[6] = tm.tm_min;
+
+    sim->logger_next = (sim->logger_next + 1) % BENTEL_LOGGER_EVENTS;
+    sim->logged++;
+}
+
+int
+bentel_sim_receive (bentel_sim_t * sim, const uint8_t * buffer, int len,
+                    uint8_t * response, int * response_len)
+{
+    const bentel_sim_command_t * command;
+    uint16_t address;
+    int size;
+    int i;
+
+    *response_len = 0;
+
+    /* the panel ignores whatever is not a request */
+    if (buffer[0] != BENTEL_READ && buffer[0] != BENTEL_WRITE)
+    {
+        sim->skipped++;
+        return 1;
+    }
+
+    if (len < BENTEL_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    if (buffer[5] != bentel_sim_checksum (buffer, 5) || buffer[4] != 0)
+    {
+        sim->skipped++;
+        return 1;
+    }
+
+    address = buffer[1] | (buffer[2] << 8);
+    size = buffer[3] + 1;
+
+    memcpy (response, buffer, BENTEL_HEADER_SIZE);
+
+    if (buffer[0] == BENTEL_READ)
+    {
+        if (BENTEL_HEADER_SIZE + size + 1 > BENTEL_SIM_FRAME_MAX)
+        {
+            sim->skipped++;
+            return 1;
+        }
+
+        bentel_sim_read (sim, address, &response[BENTEL_HEADER_SIZE], size);
+        response[BENTEL_HEADER_SIZE + size] =
+            bentel_sim_checksum (&response[BENTEL_HEADER_SIZE], size);
+
+        *response_len = BENTEL_HEADER_SIZE + size + 1;
+        sim->reads++;
+
+        return BENTEL_HEADER_SIZE;
+    }
+
+    for (i = 0 ; i < BENTEL_SIM_COMMANDS ; i++)
+    {
+        command = &bentel_sim_commands[i];
+
+        if (command->address != address)
+        {
+            continue;
+        }
+
+        if (len < BENTEL_HEADER_SIZE + command->size)
+        {
+            return 0;
+        }
+
+        /* a command with a bad checksum is not acknowledged */
+        if (buffer[BENTEL_HEADER_SIZE + command->size - 1] !=
+            bentel_sim_checksum (&buffer[BENTEL_HEADER_SIZE],
+                                 command->size - 1))
+        {
+            sim->skipped++;
+            return 1;
+        }
+
+        command->apply (sim, &buffer[BENTEL_HEADER_SIZE]);
+
+        *response_len = BENTEL_HEADER_SIZE;
+        sim->writes++;
+
+        return BENTEL_HEADER_SIZE + command->size;
+    }
+
+    sim->skipped++;
+    return 1;
+}
+
+/* set or clear bit n of *mask, n < bits; -1 if the value is not 0 or 1 */
+static int
+bentel_sim_set_bit (uint32_t * mask, int n, int bits, const char * value)
+{
+    if (n < 0 || n >= bits || value == NULL ||
+        (strcmp (value, "0") != 0 && strcmp (value, "1") != 0))
+    {
+        return -1;
+    }
+
+    if (value[0] == '1')
+    {
+        *mask |= 1u << n;
+    }
+    else
+    {
+        *mask &= ~(1u << n);
+    }
+
+    return 0;
+}
+
+static int
+bentel_sim_apply_zone (bentel_sim_t * sim, int n, const char * what,
+                       const char * value, const char * rest)
+{
+    uint32_t before;
+    int ret;
+
+    if (n < 0 || n >= 32)
+    {
+        return -1;
+    }
+
+    if (strcmp (what, "name") == 0)
+    {
+        snprintf (sim->zone_names[n], sizeof (sim->zone_names[n]), "%s", rest);
+        return 0;
+    }
+
+    if (strcmp (what, "toggle") == 0)
+    {
+        value = (sim->zone_alarm & (1u << n)) ? "0" : "1";
+        what = "alarm";
+    }
+
+    if (strcmp (what, "alarm") == 0)
+    {
+        before = sim->zone_alarm;
+        ret = bentel_sim_set_bit (&sim->zone_alarm, n, 32, value);
+
+        /* the memory stays until the reset command */
+        if (ret == 0 && (sim->zone_alarm & ~before))
+        {
+            sim->zone_alarm_memory |= 1u << n;
+            bentel_sim_log (sim, BENTEL_EVENT_ZONE_ALARM, n);
+        }
+        else if (ret == 0 && (before & ~sim->zone_alarm))
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_ZONE_RESTORATION, n);
+        }
+
+        return ret;
+    }
+
+    if (strcmp (what, "sabotage") == 0)
+    {
+        before = sim->zone_sabotage;
+        ret = bentel_sim_set_bit (&sim->zone_sabotage, n, 32, value);
+
+        if (ret == 0 && (sim->zone_sabotage & ~before))
+        {
+            sim->zone_sabotage_memory |= 1u << n;
+            bentel_sim_log (sim, BENTEL_EVENT_ZONE_SABOTAGE, n);
+        }
+
+        return ret;
+    }
+
+    if (strcmp (what, "included") == 0)
+    {
+        return bentel_sim_set_bit (&sim->zone_inclusion, n, 32, value);
+    }
+
+    return -1;
+}
+
+static int
+bentel_sim_apply_partition (bentel_sim_t * sim, int n, const char * what,
+                            const char * value, const char * rest)
+{
+    uint32_t mask;
+    int ret;
+
+    if (n < 0 || n >= 8)
+    {
+        return -1;
+    }
+
+    if (strcmp (what, "name") == 0)
+    {
+        snprintf (sim->partition_names[n], sizeof (sim->partition_names[n]),
+                  "%s", rest);
+        return 0;
+    }
+
+    if (strcmp (what, "armed") == 0)
+    {
+        mask = sim->partition_armed;
+        ret = bentel_sim_set_bit (&mask, n, 8, value);
+        sim->partition_armed = mask;
+        return ret;
+    }
+
+    if (strcmp (what, "alarm") == 0)
+    {
+        mask = sim->partition_alarm;
+        ret = bentel_sim_set_bit (&mask, n, 8, value);
+
+        if (ret == 0 && (mask & ~sim->partition_alarm))
+        {
+            sim->siren = true;
+            bentel_sim_log (sim, BENTEL_EVENT_PARTITON_ALARM, n);
+        }
+
+        sim->partition_alarm = mask;
+        return ret;
+    }
+
+    return -1;
+}
+
+static int
+bentel_sim_apply_peripheral (uint16_t * present, uint16_t * sabotage,
+                             uint16_t * alive, int n, int count,
+                             const char * what, const char * value)
+{
+    uint32_t mask;
+    uint16_t * target;
+    int ret;
+
+    if (strcmp (what, "present") == 0)
+    {
+        target = present;
+    }
+    else if (strcmp (what, "sabotage") == 0)
+    {
+        target = sabotage;
+    }
+    else if (strcmp (what, "alive") == 0)
+    {
+        target = alive;
+    }
+    else
+    {
+        return -1;
+    }
+
+    mask = *target;
+    ret = bentel_sim_set_bit (&mask, n, count, value);
+    *target = mask;
+
+    return ret;
+}
+
+int
+bentel_sim_apply (bentel_sim_t * sim, const char * line)
+{
+    char command[16] = "";
+    char what[32] = "";
+    char value[32] = "";
+    uint16_t present;
+    uint16_t sabotage;
+    uint16_t alive;
+    uint32_t mask;
+    int consumed = 0;
+    int ret;
+    int n;
+    int i;
+
+    if (sscanf (line, " %15s%n", command, &consumed) != 1)
+    {
+        return -1;
+    }
+    line += consumed;
+
+    if (strcmp (command, "model") == 0)
+    {
+        if (sscanf (line, " %8s %d.%d", sim->model, &sim->fw_major,
+                    &sim->fw_minor) != 3)
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    if (strcmp (command, "siren") == 0)
+    {
+        if (sscanf (line, " %31s", value) != 1 ||
+            (strcmp (value, "0") != 0 && strcmp (value, "1") != 0))
+        {
+            return -1;
+        }
+        sim->siren = (value[0] == '1');
+        return 0;
+    }
+
+    if (strcmp (command, "events") == 0)
+    {
+        if (sscanf (line, " %d", &n) != 1 || n < 0)
+        {
+            return -1;
+        }
+
+        /* a different code each time, so that no two look the same */
+        for (i = 0 ; i < n ; i++)
+        {
+            bentel_sim_log (sim, BENTEL_EVENT_CODE_ACKNOWLEDGEMENT,
+                            sim->logged % 256);
+        }
+        return 0;
+    }
+
+    if (strcmp (command, "reset") == 0)
+    {
+        bentel_sim_apply_reset (sim, NULL);
+        return 0;
+    }
+
+    if (strcmp (command, "fault") == 0)
+    {
+        if (sscanf (line, " %31s %31s", what, value) != 2)
+        {
+            return -1;
+        }
+
+        for (i = 0 ; i < BENTEL_SIM_FAULTS ; i++)
+        {
+            if (strcmp (what, bentel_sim_faults[i]) == 0)
+            {
+                mask = sim->faults;
+                ret = bentel_sim_set_bit (&mask, i, BENTEL_SIM_FAULTS, value);
+                sim->faults = mask;
+                return ret;
+            }
+        }
+        return -1;
+    }
+
+    if (strcmp (command, "output") == 0)
+    {
+        if (sscanf (line, " %d %31s", &n, value) != 2)
+        {
+            return -1;
+        }
+
+        mask = sim->outputs;
+        ret = bentel_sim_set_bit (&mask, n, 16, value);
+        sim->outputs = mask;
+        return ret;
+    }
+
+    /* the rest are <command> <n> <what> [value] */
+    consumed = 0;
+    if (sscanf (line, " %d %31s%n", &n, what, &consumed) != 2)
+    {
+        return -1;
+    }
+    line += consumed;
+    sscanf (line, " %31s", value);
+
+    /* a name is the rest of the line */
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+
+    if (strcmp (command, "zone") == 0)
+    {
+        return bentel_sim_apply_zone (sim, n, what, value, line);
+    }
+
+    if (strcmp (command, "partition") == 0)
+    {
+        return bentel_sim_apply_partition (sim, n, what, value, line);
+    }
+
+    if (strcmp (command, "reader") == 0)
+    {
+        return bentel_sim_apply_peripheral (&sim->readers_present,
+                                            &sim->readers_sabotage,
+                                            &sim->readers_alive,
+                                            n, 16, what, value);
+    }
+
+    if (strcmp (command, "keyboard") == 0)
+    {
+        present = sim->keyboards_present;
+        sabotage = sim->keyboards_sabotage;
+        alive = sim->keyboards_alive;
+
+        ret = bentel_sim_apply_peripheral (&present, &sabotage, &alive,
+                                           n, 8, what, value);
+
+        sim->keyboards_present = present;
+        sim->keyboards_sabotage = sabotage;
+        sim->keyboards_alive = alive;
+        return ret;
+    }
+
+    return -1;
+}
@@ -0,0 +1,108 @@
+#ifndef _bentel_sim_h_
+#define _bentel_sim_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bentel_layer.h"
+
+/*
+ * A KYO32 as seen from its serial port, for the host build.
+ *
+ * To the bus the panel is a memory map: a read request
+ *
+ * -> f0 aa AA nn 00 cc
+ *
+ * is answered with its own header, the nn + 1 bytes at address AAaa
+ * and the checksum of those bytes. The regions that the state machine
+ * reads (model, peripherals, names, status, armed partitions, logger)
+ * are rendered from the state below, everything else reads as 0. The
+ * three commands (0f frames) change the state and are answered with
+ * their header, see bentel_message_encode ().
+ *
+ * The state is changed by script lines, see bentel_sim_apply ().
+ * Zones, partitions, outputs, readers and keyboards are numbered from
+ * 0, as in /delta.
+ */
+
+#define BENTEL_SIM_FRAME_MAX 512
+
+typedef struct _bentel_sim_t bentel_sim_t;
+
+struct _bentel_sim_t
+{
+    char model[9];
+    int fw_major;
+    int fw_minor;
+
+    uint16_t readers_present;
+    uint16_t readers_sabotage;
+    uint16_t readers_alive;
+    uint8_t keyboards_present;
+    uint8_t keyboards_sabotage;
+    uint8_t keyboards_alive;
+
+    char zone_names[32][17];
+    char partition_names[8][17];
+
+    uint32_t zone_alarm;
+    uint32_t zone_sabotage;
+    uint32_t zone_inclusion;
+    uint32_t zone_alarm_memory;
+    uint32_t zone_sabotage_memory;
+
+    /** @brief bit n is fault n of bentel_sim_faults[], warnings first */
+    uint16_t faults;
+    uint8_t partition_alarm;
+    uint8_t partition_armed;
+    bool siren;
+    uint16_t outputs;
+
+    uint8_t logger[BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE];
+    /** @brief slot of the next event, the logger is a ring */
+    int logger_next;
+    /** @brief events logged, for the index of the generated ones */
+    uint32_t logged;
+
+    /* counters, since bentel_sim_init () */
+    uint32_t reads;
+    uint32_t writes;
+    /** @brief bytes skipped: bad header checksum, unknown command, junk */
+    uint32_t skipped;
+};
+
+/* A KYO32 with 32 included zones, one reader, one keyboard, no events. */
+void bentel_sim_init (bentel_sim_t * sim);
+
+/*
+ * Look for a request at the start of buffer. Returns the number of
+ * bytes consumed (0 when more are needed), and the answer, if any, in
+ * response (of at least BENTEL_SIM_FRAME_MAX bytes) and *response_len.
+ */
+int bentel_sim_receive (bentel_sim_t * sim, const uint8_t * buffer, int len,
+                        uint8_t * response, int * response_len);
+
+/*
+ * Apply one script command:
+ *
+ * model <name> <major>.<minor>
+ * zone <n> alarm|sabotage|included <0|1>
+ * zone <n> toggle                     (the alarm)
+ * zone <n> name <text>
+ * partition <n> armed|alarm <0|1>
+ * partition <n> name <text>
+ * output <n> <0|1>
+ * siren <0|1>
+ * fault <name> <0|1>                  (the names of /delta)
+ * reader|keyboard <n> present|sabotage|alive <0|1>
+ * events <count>                      (code acknowledgements)
+ * reset                               (as the reset command)
+ *
+ * Returns -1 for a line that is not understood.
+ */
+int bentel_sim_apply (bentel_sim_t * sim, const char * line);
+
+/* Log one event in the logger ring, stamped with the local time. */
+void bentel_sim_log (bentel_sim_t * sim, bentel_event_type_t type, int index);
+
+#endif /* _bentel_sim_h_ */
@@ -0,0 +1,492 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bentel_sim.h"
+#include "fault_layer.h"
+
+/*
+ * The simulated panel on a pseudo-terminal, for bentel_host or any
+ * other master:
+ *
+ * bentel_sim [-l link] [-b baud] [-d latency_ms] [-t seconds]
+ *            [-f faults] [-s script] [-e 'seconds command'] ...
+ *
+ * The name of the pty is printed on stdout, and linked from link if
+ * given. Every answer is sent latency_ms after the request has been
+ * received, one byte every 10 bit times at baud (0 sends at once); the
+ * request itself is taken to have arrived at baud too. With -f the
+ * answers go through a fault layer first, see fault_layer_parse ().
+ *
+ * A script line is the time in seconds from the start, and one command
+ * of bentel_sim_apply ():
+ *
+ * # zone 5 in alarm at 3 s, back at 4 s, then 20 events
+ * 3 zone 5 alarm 1
+ * 4 zone 5 toggle
+ * 5 events 20
+ */
+
+#define BENTEL_SIM_SCRIPT_MAX 256
+#define BENTEL_SIM_LINE_MAX 128
+
+typedef struct _bentel_sim_step_t bentel_sim_step_t;
+
+struct _bentel_sim_step_t
+{
+    uint64_t at_us;
+    char command[BENTEL_SIM_LINE_MAX];
+};
+
+static bentel_sim_t sim;
+
+/* the pty, and when its next byte may go at baud */
+static int master;
+static int baud = 9600;
+static uint64_t next_byte_us = 0;
+
+static bentel_sim_step_t script[BENTEL_SIM_SCRIPT_MAX];
+static int script_count = 0;
+static int script_next = 0;
+
+static volatile sig_atomic_t stopping = 0;
+
+static uint64_t
+now_us (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void
+sleep_until_us (uint64_t us)
+{
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000u;
+    ts.tv_nsec = (us % 1000000u) * 1000;
+
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR &&
+           !stopping)
+    {
+    }
+}
+
+static void
+on_signal (int sig)
+{
+    (void) sig;
+    stopping = 1;
+}
+
+/* add "seconds command" to the script, kept in time order */
+static int
+script_add (const char * line)
+{
+    char * end;
+    double seconds;
+    int i;
+
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+
+    if (*line == '#' || *line == '\n' || *line == 0)
+    {
+        return 0;
+    }
+
+    seconds = strtod (line, &end);
+
+    if (end == line || seconds < 0 || script_count == BENTEL_SIM_SCRIPT_MAX)
+    {
+        return -1;
+    }
+
+    for (i = script_count ; i > 0 && script[i - 1].at_us > seconds * 1e6 ; i--)
+    {
+        script[i] = script[i - 1];
+    }
+
+    script[i].at_us = (uint64_t) (seconds * 1e6);
+    snprintf (script[i].command, sizeof (script[i].command), "%s", end);
+    script[i].command[strcspn (script[i].command, "\r\n")] = 0;
+    script_count++;
+
+    return 0;
+}
+
+static int
+script_load (const char * path)
+{
+    char line[BENTEL_SIM_LINE_MAX];
+    FILE * f;
+    int n = 0;
+
+    f = fopen (path, "r");
+
+    if (f == NULL)
+    {
+        perror (path);
+        return -1;
+    }
+
+    while (fgets (line, sizeof (line), f) != NULL)
+    {
+        n++;
+
+        if (script_add (line) != 0)
+        {
+            fprintf (stderr, "%s:%d: bad line\n", path, n);
+            fclose (f);
+            return -1;
+        }
+    }
+
+    fclose (f);
+
+    return 0;
+}
+
+/* apply the steps that are due, and return the time of the next one */
+static uint64_t
+script_run (uint64_t start)
+{
+    uint64_t now;
+
+    now = now_us ();
+
+    while (script_next < script_count &&
+           start + script[script_next].at_us <= now)
+    {
+        if (bentel_sim_apply (&sim, script[script_next].command) != 0)
+        {
+            fprintf (stderr, "bentel_sim: cannot apply '%s'\n",
+                     script[script_next].command);
+        }
+        else
+        {
+            fprintf (stderr, "bentel_sim: %.3f s:%s\n",
+                     (now - start) / 1e6, script[script_next].command);
+        }
+
+        script_next++;
+    }
+
+    return (script_next < script_count) ?
+        start + script[script_next].at_us : UINT64_MAX;
+}
+
+/* send bytes, one per character time */
+static void
+send_paced (const uint8_t * data, int len)
+{
+    int written;
+    int i;
+
+    if (baud <= 0)
+    {
+        for (i = 0 ; i < len ; i += (written > 0) ? written : 0)
+        {
+            written = write (master, &data[i], len - i);
+
+            if (written < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                return;
+            }
+        }
+        return;
+    }
+
+    if (next_byte_us < now_us ())
+    {
+        next_byte_us = now_us ();
+    }
+
+    for (i = 0 ; i < len && !stopping ; )
+    {
+        sleep_until_us (next_byte_us);
+
+        if (write (master, &data[i], 1) == 1)
+        {
+            i++;
+            /* start bit, 8 data bits, stop bit */
+            next_byte_us += 10000000u / baud;
+        }
+        else if (errno != EAGAIN && errno != EINTR)
+        {
+            return;
+        }
+    }
+}
+
+static void
+on_faulted (void * layer, void * message, int len)
+{
+    (void) layer;
+
+    send_paced ((const uint8_t *) message, len);
+}
+
+static uart_layer_ops_t fault_layer_ops =
+{
+    .to_upper_layer_received_message = on_faulted,
+};
+
+static fault_layer_t fault_layer =
+{
+    .realtime = true,
+    .seed = 1,
+    .upper_layer = &fault_layer,
+    .ops = &fault_layer_ops,
+};
+
+static int
+open_pty (const char * link)
+{
+    struct termios tio;
+    const char * name;
+    int fd;
+    int slave;
+
+    fd = posix_openpt (O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt (fd) != 0 || unlockpt (fd) != 0)
+    {
+        perror ("posix_openpt");
+        return -1;
+    }
+
+    name = ptsname (fd);
+
+    /*
+     * Raw mode lives on the slave side. Keep the slave open, so that
+     * the master does not see a hangup between two clients.
+     */
+    slave = open (name, O_RDWR | O_NOCTTY);
+
+    if (slave < 0 || tcgetattr (slave, &tio) != 0)
+    {
+        perror (name);
+        return -1;
+    }
+
+    cfmakeraw (&tio);
+    tcsetattr (slave, TCSANOW, &tio);
+
+    if (link != NULL)
+    {
+        unlink (link);
+
+        if (symlink (name, link) != 0)
+        {
+            perror (link);
+            return -1;
+        }
+    }
+
+    fprintf (stdout, "%s\n", name);
+    fflush (stdout);
+
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+    return fd;
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr,
+             "usage: %s [-l link] [-b baud] [-d latency_ms] [-t seconds]\n"
+             "          [-f faults] [-s script] [-e 'seconds command'] ...\n",
+             name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    static uint8_t buffer[BENTEL_SIM_FRAME_MAX * 2];
+    uint8_t response[BENTEL_SIM_FRAME_MAX];
+    struct pollfd pfd;
+    const char * link = NULL;
+    uint64_t start;
+    uint64_t end;
+    uint64_t next;
+    uint64_t now;
+    int buffer_len = 0;
+    int response_len;
+    bool faults = false;
+    int latency_ms = 0;
+    int seconds = 0;
+    int timeout;
+    int n;
+    int opt;
+
+    bentel_sim_init (&sim);
+
+    while ((opt = getopt (argc, argv, "l:b:d:t:f:s:e:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l': link = optarg; break;
+            case 'b': baud = atoi (optarg); break;
+            case 'd': latency_ms = atoi (optarg); break;
+            case 't': seconds = atoi (optarg); break;
+
+            case 'f':
+                if (fault_layer_parse (&fault_layer, optarg) != 0)
+                {
+                    fprintf (stderr, "bad fault spec '%s'\n", optarg);
+                    return 1;
+                }
+                faults = true;
+                break;
+
+            case 's':
+                if (script_load (optarg) != 0)
+                {
+                    return 1;
+                }
+                break;
+
+            case 'e':
+                if (script_add (optarg) != 0)
+                {
+                    fprintf (stderr, "bad step '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    master = open_pty (link);
+
+    if (master < 0)
+    {
+        return 1;
+    }
+
+    fault_layer_start (&fault_layer);
+
+    signal (SIGINT, on_signal);
+    signal (SIGTERM, on_signal);
+
+    start = now_us ();
+    end = (seconds > 0) ? start + seconds * 1000000ull : UINT64_MAX;
+
+    pfd.fd = master;
+    pfd.events = POLLIN;
+
+    while (!stopping)
+    {
+        next = script_run (start);
+        now = now_us ();
+
+        if (now >= end)
+        {
+            break;
+        }
+
+        if (end < next)
+        {
+            next = end;
+        }
+
+        timeout = (next == UINT64_MAX) ? 1000 :
+            (int) ((next - now + 999) / 1000);
+
+        if (poll (&pfd, 1, timeout) <= 0 || !(pfd.revents & POLLIN))
+        {
+            continue;
+        }
+
+        n = read (master, &buffer[buffer_len], sizeof (buffer) - buffer_len);
+
+        if (n <= 0)
+        {
+            continue;
+        }
+
+        buffer_len += n;
+
+        while (buffer_len > 0)
+        {
+            n = bentel_sim_receive (&sim, buffer, buffer_len, response,
+                                    &response_len);
+
+            if (n == 0)
+            {
+                break;
+            }
+
+            memmove (buffer, &buffer[n], buffer_len - n);
+            buffer_len -= n;
+
+            if (response_len == 0)
+            {
+                continue;
+            }
+
+            /* the request took this long on the wire */
+            now = now_us ();
+            if (baud > 0)
+            {
+                now += (uint64_t) n * 10000000u / baud;
+            }
+            sleep_until_us (now + latency_ms * 1000ull);
+
+            if (faults)
+            {
+                fault_layer_received_message (&fault_layer, response,
+                                              response_len);
+            }
+            else
+            {
+                send_paced (response, response_len);
+            }
+        }
+
+        /* junk without a request in it */
+        if (buffer_len == sizeof (buffer))
+        {
+            sim.skipped += buffer_len;
+            buffer_len = 0;
+        }
+    }
+
+    fprintf (stderr, "bentel_sim: %u reads, %u commands, %u bytes skipped\n",
+             sim.reads, sim.writes, sim.skipped);
+
+    if (faults)
+    {
+        fprintf (stderr, "bentel_sim: %u faults in %u bytes (drop %u, "
+                 "dup %u, corrupt %u, delay %u)\n",
+                 fault_layer_faults (&fault_layer), fault_layer.bytes,
+                 fault_layer.dropped, fault_layer.duplicated,
+                 fault_layer.corrupted, fault_layer.delayed);
+    }
+
+    if (link != NULL)
+    {
+        unlink (link);
+    }
+
+    return 0;
+}
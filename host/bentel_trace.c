@@ -0,0 +1,350 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "perf.h"
+#include "trace.h"
+
+/*
+ * A trace (see src/trace.h, from /trace or BENTEL_TRACE_FILE) in the
+ * Chrome trace event format, for chrome://tracing or ui.perfetto.dev:
+ *
+ * bentel_trace [-o json] trace
+ *
+ * Each core is a thread. Frames (first character to delivery), HTTP
+ * handlers and semaphore waits are spans, decodes and requests are
+ * instants; a frame that is not delivered, or an end without its begin
+ * (older than the ring), is left out. The longest span of each kind is
+ * reported on stderr.
+ */
+
+enum
+{
+    SPAN_FRAME = 0,
+    SPAN_HANDLER,
+    SPAN_SEM_WAIT,
+    SPANS,
+};
+
+static const char * span_names[SPANS] = { "frame", "handler", "sem wait" };
+
+typedef struct _bentel_trace_span_t bentel_trace_span_t;
+
+struct _bentel_trace_span_t
+{
+    bool open;
+    uint64_t begin;
+    uint16_t arg;
+
+    uint32_t count;
+    uint64_t longest;
+};
+
+static FILE * out;
+static bool first = true;
+
+static uint8_t *
+bentel_trace_read (const char * path, long * len)
+{
+    uint8_t * data;
+    FILE * f;
+
+    f = fopen (path, "rb");
+
+    if (f == NULL)
+    {
+        perror (path);
+        return NULL;
+    }
+
+    fseek (f, 0, SEEK_END);
+    *len = ftell (f);
+    fseek (f, 0, SEEK_SET);
+
+    data = malloc (*len > 0 ? *len : 1);
+
+    if (data == NULL || fread (data, 1, *len, f) != (size_t) *len)
+    {
+        perror (path);
+        free (data);
+        data = NULL;
+    }
+
+    fclose (f);
+
+    return data;
+}
+
+static void
+bentel_trace_event (const char * format, ...)
+    __attribute__ ((format (printf, 1, 2)));
+
+static void
+bentel_trace_event (const char * format, ...)
+{
+    va_list args;
+
+    fprintf (out, "%s\n", first ? "" : ",");
+    first = false;
+
+    va_start (args, format);
+    vfprintf (out, format, args);
+    va_end (args);
+}
+
+static void
+bentel_trace_span_begin (bentel_trace_span_t * span, uint64_t ts,
+                         uint16_t arg)
+{
+    span->open = true;
+    span->begin = ts;
+    span->arg = arg;
+}
+
+static void
+bentel_trace_span_end (bentel_trace_span_t * span, int kind, int core,
+                       uint64_t ts, uint16_t arg)
+{
+    uint64_t dur;
+
+    if (!span->open)
+    {
+        return;
+    }
+
+    span->open = false;
+    dur = ts - span->begin;
+
+    switch (kind)
+    {
+        case SPAN_FRAME:
+            bentel_trace_event ("{\"name\":\"frame\",\"cat\":\"link\","
+                                "\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                                "\"ts\":%llu,\"dur\":%llu,"
+                                "\"args\":{\"first\":%u,\"type\":%u}}",
+                                core, (unsigned long long) span->begin,
+                                (unsigned long long) dur, span->arg, arg);
+            break;
+
+        case SPAN_HANDLER:
+            bentel_trace_event ("{\"name\":\"%s\",\"cat\":\"http\","
+                                "\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                                "\"ts\":%llu,\"dur\":%llu}",
+                                perf_name (arg), core,
+                                (unsigned long long) span->begin,
+                                (unsigned long long) dur);
+            break;
+
+        default:
+            bentel_trace_event ("{\"name\":\"sem wait\",\"cat\":\"sync\","
+                                "\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                                "\"ts\":%llu,\"dur\":%llu,"
+                                "\"args\":{\"sem\":\"0x%04x\"}}",
+                                core, (unsigned long long) span->begin,
+                                (unsigned long long) dur, arg);
+            break;
+    }
+
+    span->count++;
+
+    if (dur > span->longest)
+    {
+        span->longest = dur;
+    }
+}
+
+static void
+bentel_trace_instant (const char * name, const char * key, int core,
+                      uint64_t ts, int value)
+{
+    bentel_trace_event ("{\"name\":\"%s\",\"cat\":\"link\",\"ph\":\"i\","
+                        "\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%llu,"
+                        "\"args\":{\"%s\":%d}}",
+                        name, core, (unsigned long long) ts, key, value);
+}
+
+/* the records of one core, oldest first */
+static void
+bentel_trace_core (int core, const trace_record_t * records, uint32_t count,
+                   uint32_t now_us, bentel_trace_span_t * spans)
+{
+    const trace_record_t * record;
+    uint64_t ts;
+    uint32_t i;
+
+    bentel_trace_event ("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                        "\"tid\":%d,\"args\":{\"name\":\"core%d\"}}",
+                        core, core);
+
+    for (i = 0 ; i < count ; i++)
+    {
+        record = &records[i];
+
+        /* the ring holds less than 2^32 us before now_us */
+        ts = (uint64_t) UINT32_MAX - (uint32_t) (now_us - record->us);
+
+        switch (record->event)
+        {
+            case TRACE_FRAME_START:
+                bentel_trace_span_begin (&spans[SPAN_FRAME], ts, record->arg);
+                break;
+
+            case TRACE_FRAME_END:
+                bentel_trace_span_end (&spans[SPAN_FRAME], SPAN_FRAME, core,
+                                       ts, record->arg);
+                break;
+
+            case TRACE_DECODE:
+                bentel_trace_instant ("decode", "result", core, ts,
+                                      (int16_t) record->arg);
+                break;
+
+            case TRACE_SEM_WAIT_BEGIN:
+                bentel_trace_span_begin (&spans[SPAN_SEM_WAIT], ts,
+                                         record->arg);
+                break;
+
+            case TRACE_SEM_WAIT_END:
+                bentel_trace_span_end (&spans[SPAN_SEM_WAIT], SPAN_SEM_WAIT,
+                                       core, ts, record->arg);
+                break;
+
+            case TRACE_HANDLER_BEGIN:
+                bentel_trace_span_begin (&spans[SPAN_HANDLER], ts,
+                                         record->arg);
+                break;
+
+            case TRACE_HANDLER_END:
+                bentel_trace_span_end (&spans[SPAN_HANDLER], SPAN_HANDLER,
+                                       core, ts, record->arg);
+                break;
+
+            case TRACE_REQUEST_SENT:
+                bentel_trace_instant ("request", "type", core, ts,
+                                      record->arg);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static void
+usage (const char * name)
+{
+    fprintf (stderr, "usage: %s [-o json] trace\n", name);
+}
+
+int
+main (int argc, char * argv[])
+{
+    bentel_trace_span_t spans[TRACE_CORES][SPANS];
+    const trace_record_t * records;
+    const char * output = NULL;
+    trace_header_t header;
+    uint8_t * data;
+    uint64_t expected;
+    long len;
+    int core;
+    int kind;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': output = optarg; break;
+
+            default:
+                usage (argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    data = bentel_trace_read (argv[optind], &len);
+
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    if (len < (long) sizeof (header))
+    {
+        fprintf (stderr, "%s: not a trace\n", argv[optind]);
+        return 1;
+    }
+
+    memcpy (&header, data, sizeof (header));
+
+    expected = sizeof (header);
+    for (core = 0 ; core < TRACE_CORES ; core++)
+    {
+        expected += (uint64_t) header.count[core] * sizeof (trace_record_t);
+    }
+
+    if (memcmp (header.magic, TRACE_MAGIC, sizeof (header.magic)) != 0 ||
+        header.version != TRACE_VERSION ||
+        header.cores != TRACE_CORES ||
+        expected > (uint64_t) len)
+    {
+        fprintf (stderr, "%s: not a trace, or damaged\n", argv[optind]);
+        return 1;
+    }
+
+    out = stdout;
+
+    if (output != NULL && (out = fopen (output, "w")) == NULL)
+    {
+        perror (output);
+        return 1;
+    }
+
+    memset (spans, 0, sizeof (spans));
+
+    fprintf (out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    records = (const trace_record_t *) &data[sizeof (header)];
+
+    for (core = 0 ; core < TRACE_CORES ; core++)
+    {
+        bentel_trace_core (core, records, header.count[core], header.now_us,
+                           spans[core]);
+        records += header.count[core];
+    }
+
+    fprintf (out, "\n]}\n");
+
+    if (out != stdout)
+    {
+        fclose (out);
+    }
+
+    for (core = 0 ; core < TRACE_CORES ; core++)
+    {
+        fprintf (stderr, "core%d: %u records, %u dropped", core,
+                 header.count[core], header.dropped[core]);
+
+        for (kind = 0 ; kind < SPANS ; kind++)
+        {
+            fprintf (stderr, ", %u %s (longest %llu us)",
+                     spans[core][kind].count, span_names[kind],
+                     (unsigned long long) spans[core][kind].longest);
+        }
+
+        fprintf (stderr, "\n");
+    }
+
+    free (data);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "fault_layer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* xorshift32, in [0, 1) */
+static double
+fault_layer_draw (fault_layer_t * fault_layer)
+{
+    uint32_t x;
+
+    x = fault_layer->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fault_layer->random = x;
+
+    return x / 4294967296.0;
+}
+
+static void
+fault_layer_forward (fault_layer_t * fault_layer, uint8_t ch)
+{
+    fault_layer->ops->to_upper_layer_received_message (fault_layer->upper_layer,
+                                                       &ch, 1);
+}
+
+int
+fault_layer_start (void * layer)
+{
+    fault_layer_t * fault_layer;
+
+    fault_layer = (fault_layer_t *) layer;
+
+    /* xorshift never leaves 0 */
+    fault_layer->random = (fault_layer->seed != 0) ? fault_layer->seed : 1;
+
+    fault_layer->bytes = 0;
+    fault_layer->dropped = 0;
+    fault_layer->duplicated = 0;
+    fault_layer->corrupted = 0;
+    fault_layer->delayed = 0;
+    fault_layer->delayed_us = 0;
+
+    return 0;
+}
+
+void
+fault_layer_stop (void * layer)
+{
+    (void) layer;
+}
+
+void
+fault_layer_received_message (void * layer, void * message, int len)
+{
+    fault_layer_t * fault_layer;
+    const uint8_t * buffer;
+    uint8_t ch;
+    int i;
+
+    fault_layer = (fault_layer_t *) layer;
+    buffer = (const uint8_t *) message;
+
+    if (fault_layer->upper_layer == NULL ||
+        fault_layer->ops == NULL ||
+        fault_layer->ops->to_upper_layer_received_message == NULL)
+    {
+        return;
+    }
+
+    for (i = 0 ; i < len ; i++)
+    {
+        ch = buffer[i];
+        fault_layer->bytes++;
+
+        if (fault_layer_draw (fault_layer) < fault_layer->drop)
+        {
+            fault_layer->dropped++;
+            continue;
+        }
+
+        if (fault_layer_draw (fault_layer) < fault_layer->corrupt)
+        {
+            ch ^= 1u << (int) (fault_layer_draw (fault_layer) * 8);
+            fault_layer->corrupted++;
+        }
+
+        if (fault_layer_draw (fault_layer) < fault_layer->delay)
+        {
+            fault_layer->delayed++;
+            fault_layer->delayed_us += fault_layer->delay_us;
+
+            if (fault_layer->realtime)
+            {
+                usleep (fault_layer->delay_us);
+            }
+        }
+
+        fault_layer_forward (fault_layer, ch);
+
+        if (fault_layer_draw (fault_layer) < fault_layer->duplicate)
+        {
+            fault_layer->duplicated++;
+            fault_layer_forward (fault_layer, ch);
+        }
+    }
+}
+
+uint32_t
+fault_layer_faults (fault_layer_t * fault_layer)
+{
+    return fault_layer->dropped + fault_layer->duplicated +
+           fault_layer->corrupted + fault_layer->delayed;
+}
+
+int
+fault_layer_parse (fault_layer_t * fault_layer, const char * spec)
+{
+    char key[16];
+    double value;
+    int consumed;
+
+    while (*spec != 0)
+    {
+        if (sscanf (spec, "%15[a-z_]=%lf%n", key, &value, &consumed) != 2 ||
+            value < 0)
+        {
+            return -1;
+        }
+
+        if (strcmp (key, "drop") == 0)
+        {
+            fault_layer->drop = value;
+        }
+        else if (strcmp (key, "dup") == 0)
+        {
+            fault_layer->duplicate = value;
+        }
+        else if (strcmp (key, "corrupt") == 0)
+        {
+            fault_layer->corrupt = value;
+        }
+        else if (strcmp (key, "delay") == 0)
+        {
+            fault_layer->delay = value;
+        }
+        else if (strcmp (key, "delay_us") == 0)
+        {
+            fault_layer->delay_us = (uint32_t) value;
+        }
+        else if (strcmp (key, "seed") == 0)
+        {
+            fault_layer->seed = (uint32_t) value;
+        }
+        else
+        {
+            return -1;
+        }
+
+        spec += consumed;
+
+        if (*spec == ',')
+        {
+            spec++;
+        }
+        else if (*spec != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef _fault_layer_h_
+#define _fault_layer_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "uart_layer.h"
+
+/*
+ * A byte stream layer of the host build that damages what goes
+ * through it: each byte is dropped, duplicated, corrupted (one bit
+ * flipped) or delayed, each with its own probability. It takes and
+ * hands bytes with the uart_layer_ops_t call, so it fits between a
+ * link (tty_layer_t, the simulator's output) and its upper layer.
+ *
+ * The draws come from a generator seeded with seed, so that a run can
+ * be repeated. A delayed byte is held delay_us before it is passed on
+ * when realtime is set; otherwise the delay is only added to
+ * delayed_us, for a caller that keeps its own clock.
+ */
+
+typedef struct _fault_layer_t fault_layer_t;
+
+struct _fault_layer_t
+{
+    /* probabilities per byte, 0 to 1 */
+    double drop;
+    double duplicate;
+    double corrupt;
+    double delay;
+    uint32_t delay_us;
+    bool realtime;
+    uint32_t seed;
+
+    void * upper_layer;
+    uart_layer_ops_t *ops;
+
+    /* set by fault_layer_start () */
+    uint32_t random;
+
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t duplicated;
+    uint32_t corrupted;
+    uint32_t delayed;
+    uint64_t delayed_us;
+};
+
+int fault_layer_start (void * layer);
+
+void fault_layer_stop (void * layer);
+
+void fault_layer_received_message (void * layer, void * message, int len);
+
+/* drops + duplicates + corruptions + delays so far */
+uint32_t fault_layer_faults (fault_layer_t * fault_layer);
+
+/*
+ * Set the rates from "drop=0.001,dup=0.001,corrupt=0.001,delay=0.01,
+ * delay_us=5000,seed=1", any subset. Returns -1 on a bad spec.
+ */
+int fault_layer_parse (fault_layer_t * fault_layer, const char * spec);
+
+#endif /* _fault_layer_h_ */
@@ -0,0 +1,117 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flash_store.h"
+
+/*
+ * flash_store.h on Linux: the flash is a file of PICO_FLASH_SIZE_BYTES,
+ * mapped in memory, named by the environment variable BENTEL_FLASH_FILE
+ * (bentel_flash.bin by default). A new file reads as erased flash.
+ *
+ * Erase and program behave as NOR flash does, so that code that works
+ * here works on the device: erase sets whole sectors to 0xff, and
+ * program can only clear bits, never set them.
+ */
+
+#define FLASH_STORE_FILE_DEFAULT "bentel_flash.bin"
+
+static uint8_t * flash_store_file = NULL;
+
+int
+flash_store_start (void)
+{
+    const char * path;
+    struct stat st;
+    int fd;
+
+    path = getenv ("BENTEL_FLASH_FILE");
+
+    if (path == NULL)
+    {
+        path = FLASH_STORE_FILE_DEFAULT;
+    }
+
+    fd = open (path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        perror (path);
+        return -1;
+    }
+
+    if (fstat (fd, &st) != 0 ||
+        (st.st_size != PICO_FLASH_SIZE_BYTES &&
+         ftruncate (fd, PICO_FLASH_SIZE_BYTES) != 0))
+    {
+        perror (path);
+        close (fd);
+        return -1;
+    }
+
+    flash_store_file = mmap (NULL, PICO_FLASH_SIZE_BYTES,
+                             PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close (fd);
+
+    if (flash_store_file == MAP_FAILED)
+    {
+        perror (path);
+        flash_store_file = NULL;
+        return -1;
+    }
+
+    /* a new file is all zeros, which is not what erased flash reads */
+    if (st.st_size == 0)
+    {
+        memset (flash_store_file, 0xff, PICO_FLASH_SIZE_BYTES);
+    }
+
+    return 0;
+}
+
+const void *
+flash_store_data (uint32_t offset)
+{
+    return &flash_store_file[offset];
+}
+
+int
+flash_store_erase (uint32_t offset, size_t len)
+{
+    if (offset % FLASH_SECTOR_SIZE != 0 || len % FLASH_SECTOR_SIZE != 0 ||
+        offset + len > PICO_FLASH_SIZE_BYTES)
+    {
+        return -1;
+    }
+
+    memset (&flash_store_file[offset], 0xff, len);
+
+    return 0;
+}
+
+int
+flash_store_program (uint32_t offset, const void * data, size_t len)
+{
+    const uint8_t * bytes;
+    size_t i;
+
+    if (offset % FLASH_PAGE_SIZE != 0 || len % FLASH_PAGE_SIZE != 0 ||
+        offset + len > PICO_FLASH_SIZE_BYTES)
+    {
+        return -1;
+    }
+
+    bytes = (const uint8_t *) data;
+
+    for (i = 0 ; i < len ; i++)
+    {
+        flash_store_file[offset + i] &= bytes[i];
+    }
+
+    return 0;
+}
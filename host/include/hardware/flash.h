@@ -0,0 +1,16 @@
+#ifndef _hardware_flash_h_
+#define _hardware_flash_h_
+
+/*
+ * Host build: just the geometry of the Pico W flash. The flash itself
+ * is a file, see host/flash_store_file.c.
+ */
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+
+#endif /* _hardware_flash_h_ */
@@ -0,0 +1,18 @@
+#ifndef _hardware_uart_h_
+#define _hardware_uart_h_
+
+/*
+ * Host build: just the types that uart_layer.h names. The link to the
+ * panel is a tty, see host/tty_layer.c.
+ */
+
+typedef struct uart_inst uart_inst_t;
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+#endif /* _hardware_uart_h_ */
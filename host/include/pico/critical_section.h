@@ -0,0 +1,26 @@
+#ifndef _pico_critical_section_h_
+#define _pico_critical_section_h_
+
+/*
+ * Host build: a critical section is a pthread mutex. There are no
+ * interrupts to disable.
+ */
+
+#include <pthread.h>
+
+typedef struct _critical_section_t critical_section_t;
+
+struct _critical_section_t
+{
+    pthread_mutex_t mutex;
+};
+
+void critical_section_init (critical_section_t * crit_sec);
+
+void critical_section_enter_blocking (critical_section_t * crit_sec);
+
+void critical_section_exit (critical_section_t * crit_sec);
+
+void critical_section_deinit (critical_section_t * crit_sec);
+
+#endif /* _pico_critical_section_h_ */
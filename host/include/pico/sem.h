@@ -0,0 +1,33 @@
+#ifndef _pico_sem_h_
+#define _pico_sem_h_
+
+/*
+ * Host build: pico/sem.h on a pthread mutex and condition variable,
+ * with the SDK's counting semantics (permits up to max_permits).
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _semaphore_t semaphore_t;
+
+struct _semaphore_t
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int16_t permits;
+    int16_t max_permits;
+};
+
+void sem_init (semaphore_t * sem, int16_t initial_permits, int16_t max_permits);
+
+int sem_available (semaphore_t * sem);
+
+bool sem_release (semaphore_t * sem);
+
+void sem_acquire_blocking (semaphore_t * sem);
+
+bool sem_acquire_timeout_ms (semaphore_t * sem, uint32_t timeout_ms);
+
+#endif /* _pico_sem_h_ */
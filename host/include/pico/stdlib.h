@@ -0,0 +1,20 @@
+#ifndef _pico_stdlib_h_
+#define _pico_stdlib_h_
+
+/*
+ * Host build: the part of the Pico SDK's pico/stdlib.h that the panel
+ * protocol stack uses. There is no RAM to place code in.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <pico/time.h>
+
+#define __time_critical_func(func_name) func_name
+
+/* One core: the threads of a host tool all trace as core 0. */
+unsigned int get_core_num (void);
+
+#endif /* _pico_stdlib_h_ */
@@ -0,0 +1,26 @@
+#ifndef _pico_time_h_
+#define _pico_time_h_
+
+/*
+ * Host build: pico/time.h on CLOCK_MONOTONIC. An absolute_time_t is
+ * microseconds, as on the device, and the time since boot is the time
+ * since the first call.
+ */
+
+#include <stdint.h>
+
+typedef uint64_t absolute_time_t;
+
+absolute_time_t get_absolute_time (void);
+
+int64_t absolute_time_diff_us (absolute_time_t from, absolute_time_t to);
+
+absolute_time_t make_timeout_time_ms (uint32_t ms);
+
+uint32_t to_ms_since_boot (absolute_time_t t);
+
+uint64_t to_us_since_boot (absolute_time_t t);
+
+void sleep_ms (uint32_t ms);
+
+#endif /* _pico_time_h_ */
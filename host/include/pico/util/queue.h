@@ -0,0 +1,40 @@
+#ifndef _pico_util_queue_h_
+#define _pico_util_queue_h_
+
+/*
+ * Host build: pico/util/queue.h, a fixed size ring of elements copied
+ * in and out under a mutex. Only the non blocking calls are provided.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _queue_t queue_t;
+
+struct _queue_t
+{
+    pthread_mutex_t mutex;
+    uint8_t * data;
+    uint16_t wptr;
+    uint16_t rptr;
+    uint16_t element_size;
+    uint16_t element_count;
+};
+
+void queue_init (queue_t * q, unsigned int element_size,
+                 unsigned int element_count);
+
+void queue_free (queue_t * q);
+
+unsigned int queue_get_level (queue_t * q);
+
+bool queue_is_empty (queue_t * q);
+
+bool queue_is_full (queue_t * q);
+
+bool queue_try_add (queue_t * q, const void * data);
+
+bool queue_try_remove (queue_t * q, void * data);
+
+#endif /* _pico_util_queue_h_ */
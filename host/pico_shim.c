@@ -0,0 +1,301 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pico/critical_section.h>
+#include <pico/sem.h>
+#include <pico/stdlib.h>
+#include <pico/time.h>
+#include <pico/util/queue.h>
+
+/*
+ * The Pico SDK calls used by the panel protocol stack, on Linux. See
+ * the headers in host/include/pico.
+ */
+
+static absolute_time_t
+pico_shim_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (absolute_time_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static absolute_time_t pico_shim_boot = 0;
+
+absolute_time_t
+get_absolute_time (void)
+{
+    absolute_time_t now;
+
+    now = pico_shim_now ();
+
+    if (pico_shim_boot == 0)
+    {
+        pico_shim_boot = now;
+    }
+
+    return now - pico_shim_boot;
+}
+
+int64_t
+absolute_time_diff_us (absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t) (to - from);
+}
+
+absolute_time_t
+make_timeout_time_ms (uint32_t ms)
+{
+    return get_absolute_time () + (absolute_time_t) ms * 1000u;
+}
+
+uint32_t
+to_ms_since_boot (absolute_time_t t)
+{
+    return (uint32_t) (t / 1000u);
+}
+
+uint64_t
+to_us_since_boot (absolute_time_t t)
+{
+    return t;
+}
+
+void
+sleep_ms (uint32_t ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long) (ms % 1000) * 1000000L;
+
+    while (nanosleep (&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+unsigned int
+get_core_num (void)
+{
+    return 0;
+}
+
+void
+sem_init (semaphore_t * sem, int16_t initial_permits, int16_t max_permits)
+{
+    pthread_mutex_init (&sem->mutex, NULL);
+    pthread_cond_init (&sem->cond, NULL);
+    sem->permits = initial_permits;
+    sem->max_permits = max_permits;
+}
+
+int
+sem_available (semaphore_t * sem)
+{
+    int permits;
+
+    pthread_mutex_lock (&sem->mutex);
+    permits = sem->permits;
+    pthread_mutex_unlock (&sem->mutex);
+
+    return permits;
+}
+
+bool
+sem_release (semaphore_t * sem)
+{
+    bool released = false;
+
+    pthread_mutex_lock (&sem->mutex);
+
+    if (sem->permits < sem->max_permits)
+    {
+        sem->permits++;
+        released = true;
+        pthread_cond_signal (&sem->cond);
+    }
+
+    pthread_mutex_unlock (&sem->mutex);
+
+    return released;
+}
+
+void
+sem_acquire_blocking (semaphore_t * sem)
+{
+    pthread_mutex_lock (&sem->mutex);
+
+    while (sem->permits <= 0)
+    {
+        pthread_cond_wait (&sem->cond, &sem->mutex);
+    }
+
+    sem->permits--;
+
+    pthread_mutex_unlock (&sem->mutex);
+}
+
+bool
+sem_acquire_timeout_ms (semaphore_t * sem, uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    bool acquired = false;
+
+    /* the condition variable waits on CLOCK_REALTIME */
+    clock_gettime (CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock (&sem->mutex);
+
+    while (sem->permits <= 0)
+    {
+        if (pthread_cond_timedwait (&sem->cond, &sem->mutex, &deadline) ==
+            ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    if (sem->permits > 0)
+    {
+        sem->permits--;
+        acquired = true;
+    }
+
+    pthread_mutex_unlock (&sem->mutex);
+
+    return acquired;
+}
+
+void
+critical_section_init (critical_section_t * crit_sec)
+{
+    pthread_mutex_init (&crit_sec->mutex, NULL);
+}
+
+void
+critical_section_enter_blocking (critical_section_t * crit_sec)
+{
+    pthread_mutex_lock (&crit_sec->mutex);
+}
+
+void
+critical_section_exit (critical_section_t * crit_sec)
+{
+    pthread_mutex_unlock (&crit_sec->mutex);
+}
+
+void
+critical_section_deinit (critical_section_t * crit_sec)
+{
+    pthread_mutex_destroy (&crit_sec->mutex);
+}
+
+/* one slot is left empty, so that a full queue is not an empty one */
+void
+queue_init (queue_t * q, unsigned int element_size,
+            unsigned int element_count)
+{
+    pthread_mutex_init (&q->mutex, NULL);
+    q->data = calloc (element_count + 1, element_size);
+    q->wptr = 0;
+    q->rptr = 0;
+    q->element_size = (uint16_t) element_size;
+    q->element_count = (uint16_t) element_count;
+}
+
+void
+queue_free (queue_t * q)
+{
+    free (q->data);
+    q->data = NULL;
+    pthread_mutex_destroy (&q->mutex);
+}
+
+static unsigned int
+queue_level (queue_t * q)
+{
+    int level;
+
+    level = q->wptr - q->rptr;
+
+    if (level < 0)
+    {
+        level += q->element_count + 1;
+    }
+
+    return (unsigned int) level;
+}
+
+unsigned int
+queue_get_level (queue_t * q)
+{
+    unsigned int level;
+
+    pthread_mutex_lock (&q->mutex);
+    level = queue_level (q);
+    pthread_mutex_unlock (&q->mutex);
+
+    return level;
+}
+
+bool
+queue_is_empty (queue_t * q)
+{
+    return queue_get_level (q) == 0;
+}
+
+bool
+queue_is_full (queue_t * q)
+{
+    return queue_get_level (q) == q->element_count;
+}
+
+bool
+queue_try_add (queue_t * q, const void * data)
+{
+    bool added = false;
+
+    pthread_mutex_lock (&q->mutex);
+
+    if (queue_level (q) < q->element_count)
+    {
+        memcpy (&q->data[q->wptr * q->element_size], data, q->element_size);
+        q->wptr = (q->wptr + 1) % (q->element_count + 1);
+        added = true;
+    }
+
+    pthread_mutex_unlock (&q->mutex);
+
+    return added;
+}
+
+bool
+queue_try_remove (queue_t * q, void * data)
+{
+    bool removed = false;
+
+    pthread_mutex_lock (&q->mutex);
+
+    if (queue_level (q) > 0)
+    {
+        memcpy (data, &q->data[q->rptr * q->element_size], q->element_size);
+        q->rptr = (q->rptr + 1) % (q->element_count + 1);
+        removed = true;
+    }
+
+    pthread_mutex_unlock (&q->mutex);
+
+    return removed;
+}
@@ -0,0 +1,186 @@
+#include "tty_layer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t
+tty_layer_speed (int speed)
+{
+    switch (speed)
+    {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        default: return B9600;
+    }
+}
+
+static void *
+tty_layer_read (void * layer)
+{
+    tty_layer_t * tty_layer;
+    struct pollfd pfd;
+    uint8_t buffer[64];
+    ssize_t n;
+    ssize_t i;
+
+    tty_layer = (tty_layer_t *) layer;
+
+    pfd.fd = tty_layer->fd;
+    pfd.events = POLLIN;
+
+    /* wake up now and then to see if we are stopped */
+    while (tty_layer->running)
+    {
+        if (poll (&pfd, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        n = read (tty_layer->fd, buffer, sizeof (buffer));
+
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            /* the other end of a pty closed, wait for it to reopen */
+            usleep (100000);
+            continue;
+        }
+
+        if (tty_layer->capture != NULL)
+        {
+            capture_write (tty_layer->capture, CAPTURE_RX, buffer, n);
+        }
+
+        for (i = 0 ; i < n ; i++)
+        {
+            tty_layer->ops->to_upper_layer_received_message (tty_layer->upper_layer,
+                                                             &buffer[i], 1);
+        }
+    }
+
+    return NULL;
+}
+
+int
+tty_layer_start (void * layer)
+{
+    tty_layer_t * tty_layer;
+    struct termios tio;
+
+    tty_layer = (tty_layer_t *) layer;
+
+    tty_layer->fd = open (tty_layer->path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (tty_layer->fd < 0)
+    {
+        perror (tty_layer->path);
+        return -1;
+    }
+
+    /* a pty is not a serial port, the speed is kept but means nothing */
+    if (tcgetattr (tty_layer->fd, &tio) == 0)
+    {
+        cfmakeraw (&tio);
+        tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+        tio.c_cflag |= CS8 | CLOCAL | CREAD;
+        cfsetispeed (&tio, tty_layer_speed (tty_layer->speed));
+        cfsetospeed (&tio, tty_layer_speed (tty_layer->speed));
+        tcsetattr (tty_layer->fd, TCSANOW, &tio);
+    }
+
+    if (tty_layer->upper_layer == NULL ||
+        tty_layer->ops == NULL ||
+        tty_layer->ops->to_upper_layer_received_message == NULL)
+    {
+        return 0;
+    }
+
+    tty_layer->running = true;
+
+    if (pthread_create (&tty_layer->reader, NULL, tty_layer_read,
+                        tty_layer) != 0)
+    {
+        tty_layer->running = false;
+        close (tty_layer->fd);
+        tty_layer->fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+tty_layer_stop (void * layer)
+{
+    tty_layer_t * tty_layer;
+
+    tty_layer = (tty_layer_t *) layer;
+
+    if (tty_layer->running)
+    {
+        tty_layer->running = false;
+        pthread_join (tty_layer->reader, NULL);
+    }
+
+    if (tty_layer->fd >= 0)
+    {
+        close (tty_layer->fd);
+        tty_layer->fd = -1;
+    }
+}
+
+int
+tty_layer_send_message (void * layer, void * message, int len)
+{
+    tty_layer_t * tty_layer;
+    const uint8_t * buffer;
+    struct pollfd pfd;
+    ssize_t n;
+
+    tty_layer = (tty_layer_t *) layer;
+    buffer = (const uint8_t *) message;
+
+    pfd.fd = tty_layer->fd;
+    pfd.events = POLLOUT;
+
+    if (tty_layer->capture != NULL)
+    {
+        capture_write (tty_layer->capture, CAPTURE_TX, buffer, len);
+    }
+
+    /* blocking, like uart_write_blocking () */
+    while (len > 0)
+    {
+        n = write (tty_layer->fd, buffer, len);
+
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+            {
+                return -1;
+            }
+
+            poll (&pfd, 1, 100);
+            continue;
+        }
+
+        buffer += n;
+        len -= n;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef _tty_layer_h_
+#define _tty_layer_h_
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "uart_layer.h"
+
+/*
+ * The panel link of the host build: a tty (a USB serial adapter on the
+ * panel bus, or a pty) set to raw 8N1 at speed. It has the same
+ * start/stop/send functions as uart_layer_t, and hands the received
+ * bytes to the same uart_layer_ops_t, one byte per call as the UART
+ * interrupt does, from a reader thread.
+ */
+
+typedef struct _tty_layer_t tty_layer_t;
+
+struct _tty_layer_t
+{
+    const char * path;
+    int speed;
+    void * upper_layer;
+    uart_layer_ops_t *ops;
+    /* the bytes both ways are written here, if not NULL */
+    capture_t * capture;
+
+    /* set by tty_layer_start () */
+    int fd;
+    pthread_t reader;
+    volatile bool running;
+};
+
+int tty_layer_start (void * layer);
+
+void tty_layer_stop (void * layer);
+
+int tty_layer_send_message (void * layer, void * message, int len);
+
+#endif /* _tty_layer_h_ */
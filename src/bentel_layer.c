@@ -1,10 +1,11 @@
 #include <pico/stdlib.h>
 #include <string.h>
 
-#include <stdio.h>
-
 #include "bentel_layer.h"
 #include "bentel_layer_private.h"
+#include "log_ring.h"
+#include "perf.h"
+#include "trace.h"
 
 int
 bentel_layer_start (void * layer)
@@ -63,6 +64,8 @@ bentel_layer_send_message (void * layer, void * message)
 
         len = bentel_message_encode (bentel_message, buffer, 128);
 
+        trace_write (TRACE_REQUEST_SENT, bentel_message->message_type);
+
         i = bentel_layer->ops->to_lower_layer_send_message
             (bentel_layer->lower_layer, buffer, len);
     }
@@ -70,18 +73,126 @@ bentel_layer_send_message (void * layer, void * message)
     return i;
 }
 
-void
-bentel_layer_received_message (void * layer, void * message, int len)
+/*
+ * Drop the first n characters of the receive buffer.
+ */
+static void
+bentel_layer_consume (bentel_layer_t * bentel_layer, int n)
+{
+    memmove (bentel_layer->buffer, &bentel_layer->buffer[n],
+             bentel_layer->buffer_index - n);
+    bentel_layer->moved += bentel_layer->buffer_index - n;
+    bentel_layer->buffer_index -= n;
+}
+
+static void
+bentel_layer_deliver (bentel_layer_t * bentel_layer,
+                      bentel_message_t * bentel_message)
+{
+    if (bentel_layer->upper_layer != NULL &&
+        bentel_layer->ops != NULL &&
+        bentel_layer->ops->to_upper_layer_received_message != NULL)
+    {
+        trace_write (TRACE_FRAME_END, bentel_message->message_type);
+        bentel_layer->ops->to_upper_layer_received_message
+            (bentel_layer->upper_layer, bentel_message);
+    }
+}
+
+/*
+ * Listen-only framing. The line carries the requests of another
+ * master as well as the panel's responses, and every response starts
+ * with a copy of the 6 characters of its request. So a valid header
+ * that is repeated right after itself is a request, and any other
+ * valid header starts a response, whose length is known from the
+ * header. There is no way to ask again, so on a bad frame the first
+ * character is dropped and the framer resyncs on the next 0xf0.
+ * Commands of the other master (0f frames) are skipped that way too.
+ */
+static void
+bentel_layer_sniff (bentel_layer_t * bentel_layer,
+                    bentel_message_t * bentel_message)
 {
+    perf_stamp_t start;
     int i;
-    bentel_layer_t *bentel_layer;
-    const unsigned char * buffer;
-    bentel_message_t bentel_message;
 
-    bentel_layer = (bentel_layer_t *) layer;
-    buffer = (const unsigned char *) message;
+    while (bentel_layer->buffer_index > 0)
+    {
+        for (i = 0 ; i < bentel_layer->buffer_index ; i++)
+        {
+            if (bentel_layer->buffer[i] == BENTEL_READ)
+            {
+                break;
+            }
+        }
+
+        if (i > 0)
+        {
+            bentel_layer_consume (bentel_layer, i);
+            continue;
+        }
+
+        /* a request, and the start of its response */
+        if (bentel_layer->buffer_index < 2 * BENTEL_HEADER_SIZE)
+        {
+            return;
+        }
+
+        memset (bentel_message, 0, sizeof (bentel_message_t));
 
-    fprintf (stdout, "bentel_layer_received_message: %d characters %02X\n", len, buffer[0]);
+        if (memcmp (bentel_layer->buffer,
+                    &bentel_layer->buffer[BENTEL_HEADER_SIZE],
+                    BENTEL_HEADER_SIZE) == 0)
+        {
+            i = bentel_request_decode (bentel_message, bentel_layer->buffer,
+                                       bentel_layer->buffer_index);
+        }
+        else
+        {
+            perf_begin (&start);
+            i = bentel_message_decode (bentel_layer, bentel_message,
+                                       bentel_layer->buffer,
+                                       bentel_layer->buffer_index);
+            if (i != 0)
+            {
+                perf_end (PERF_BENTEL_DECODE, &start);
+                trace_write (TRACE_DECODE, (uint16_t) i);
+            }
+        }
+
+        if (i == 0)
+        {
+            return;
+        }
+
+        if (i < 0)
+        {
+            bentel_layer->resyncs++;
+            bentel_layer_consume (bentel_layer, 1);
+            continue;
+        }
+
+        bentel_layer_consume (bentel_layer, i);
+        bentel_layer_deliver (bentel_layer, bentel_message);
+    }
+}
+
+static void
+bentel_layer_receive (bentel_layer_t * bentel_layer,
+                      const unsigned char * buffer, int len)
+{
+    perf_stamp_t start;
+    int i;
+    /* static: bentel_message_t is too large for the interrupt stack */
+    static bentel_message_t bentel_message;
+
+    LOG_RING_DEBUG ("bentel_layer_received_message: %d characters %02X",
+                    len, buffer[0]);
+
+    if (bentel_layer->buffer_index == 0 && len > 0)
+    {
+        trace_write (TRACE_FRAME_START, buffer[0]);
+    }
 
     for (i = 0 ;
          i < len && bentel_layer->buffer_index < sizeof (bentel_layer->buffer) ;
@@ -90,64 +201,95 @@ bentel_layer_received_message (void * layer, void * message, int len)
         bentel_layer->buffer[bentel_layer->buffer_index] = buffer[i];
     }
 
+    if (bentel_layer->listen_only)
+    {
+        bentel_layer_sniff (bentel_layer, &bentel_message);
+        return;
+    }
+
     /*
-     * the buffer should start with 0xf0, if not, we need to hift data to
-     * align the incoming message
+     * the buffer should start with 0xf0 (or 0x0f, the acknowledge of a
+     * command), if not, we need to hift data to align the incoming
+     * message. A frame that does not decode (bad checksum, unknown
+     * command) is not going to get better with more characters, so its
+     * first character is dropped and the next frame is looked for in
+     * what is left.
      */
-    for (i = 0 ; i < bentel_layer->buffer_index ; i++)
+    while (bentel_layer->buffer_index > 0)
     {
-        if (bentel_layer->buffer[i] == 0xf0)
+        for (i = 0 ; i < bentel_layer->buffer_index ; i++)
         {
-            break;
+            if (bentel_layer->buffer[i] == BENTEL_READ ||
+                bentel_layer->buffer[i] == BENTEL_WRITE)
+            {
+                break;
+            }
         }
-    }
 
-    if (i > 0)
-    {
-        memmove (bentel_layer->buffer, &bentel_layer->buffer[i],
-                 sizeof (bentel_layer->buffer) - i);
+        if (i > 0)
+        {
+            bentel_layer_consume (bentel_layer, i);
+            continue;
+        }
 
-        bentel_layer->buffer_index -= i;
-    }
+        memset (&bentel_message, 0, sizeof (bentel_message));
 
-    memset (&bentel_message, 0, sizeof (bentel_message));
+        perf_begin (&start);
+        i = bentel_message_decode (bentel_layer, &bentel_message,
+                                   bentel_layer->buffer,
+                                   bentel_layer->buffer_index);
 
-    i = bentel_message_decode (bentel_layer, &bentel_message,
-                               bentel_layer->buffer,
-                               bentel_layer->buffer_index);
+        /* not the calls that only find the frame incomplete */
+        if (i == 0)
+        {
+            return;
+        }
 
-    if (i > 0 && bentel_layer->upper_layer != NULL &&
-        bentel_layer->ops != NULL &&
-        bentel_layer->ops->to_upper_layer_received_message != NULL)
-    {
-        bentel_layer->ops->to_upper_layer_received_message
-            (bentel_layer->upper_layer, &bentel_message);
+        perf_end (PERF_BENTEL_DECODE, &start);
+        trace_write (TRACE_DECODE, (uint16_t) i);
 
-        memmove (bentel_layer->buffer, &bentel_layer[i],
-                 sizeof (bentel_layer->buffer) - i);
-        bentel_layer->buffer_index -= i;
+        if (i < 0)
+        {
+            bentel_layer->resyncs++;
+            bentel_layer_consume (bentel_layer, 1);
+            continue;
+        }
+
+        bentel_layer_consume (bentel_layer, i);
+        bentel_layer_deliver (bentel_layer, &bentel_message);
     }
 }
 
+void
+bentel_layer_received_message (void * layer, void * message, int len)
+{
+    perf_stamp_t start;
+
+    perf_begin (&start);
+    bentel_layer_receive ((bentel_layer_t *) layer,
+                          (const unsigned char *) message, len);
+    perf_end (PERF_BENTEL_RECEIVED, &start);
+}
+
 void
 bentel_layer_dump_message (bentel_message_t * message)
 {
     switch (message->message_type)
     {
         case  BENTEL_GET_MODEL_REQUEST:
-            fprintf (stdout, "message_type: BENTEL_GET_MODEL_REQUEST\n");
+            LOG_RING_DEBUG ("message_type: BENTEL_GET_MODEL_REQUEST");
             break;
 
         case  BENTEL_GET_MODEL_RESPONSE:
-            fprintf (stdout, "message_type: BENTEL_GET_MODEL_RESPONSE\n");
-            fprintf (stdout, "model: %s\n",
-                     message->u.get_model_response.model);
-            fprintf (stdout, "fw: %d.%d\n",
-                     message->u.get_model_response.fw_major,
-                     message->u.get_model_response.fw_minor);
+            LOG_RING_DEBUG ("message_type: BENTEL_GET_MODEL_RESPONSE");
+            LOG_RING_DEBUG ("model: %s",
+                            message->u.get_model_response.model);
+            LOG_RING_DEBUG ("fw: %d.%d",
+                            message->u.get_model_response.fw_major,
+                            message->u.get_model_response.fw_minor);
             break;
 
         default:
-            fprintf (stdout, "message_type: unknown\n");
+            LOG_RING_DEBUG ("message_type: unknown");
     }
 }
@@ -8,90 +8,19 @@ typedef enum _bentel_message_type_t bentel_message_type_t;
 
 enum _bentel_message_type_t
 {
-    BENTEL_GET_MODEL_REQUEST = 1,
-    BENTEL_GET_MODEL_RESPONSE,
-    BENTEL_GET_PERIPHERALS_REQUEST,
-    BENTEL_GET_PERIPHERALS_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_0_3_REQUEST,
-    BENTEL_GET_ZONES_NAMES_0_3_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_4_7_REQUEST,
-    BENTEL_GET_ZONES_NAMES_4_7_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_8_11_REQUEST,
-    BENTEL_GET_ZONES_NAMES_8_11_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_12_15_REQUEST,
-    BENTEL_GET_ZONES_NAMES_12_15_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_16_19_REQUEST,
-    BENTEL_GET_ZONES_NAMES_16_19_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_20_23_REQUEST,
-    BENTEL_GET_ZONES_NAMES_20_23_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_24_27_REQUEST,
-    BENTEL_GET_ZONES_NAMES_24_27_RESPONSE,
-    BENTEL_GET_ZONES_NAMES_28_31_REQUEST,
-    BENTEL_GET_ZONES_NAMES_28_31_RESPONSE,
-    BENTEL_GET_PARTITIONS_NAMES_0_3_REQUEST,
-    BENTEL_GET_PARTITIONS_NAMES_0_3_RESPONSE,
-    BENTEL_GET_PARTITIONS_NAMES_4_7_REQUEST,
-    BENTEL_GET_PARTITIONS_NAMES_4_7_RESPONSE,
-    BENTEL_GET_STATUS_AND_FAULTS_REQUEST,
-    BENTEL_GET_STATUS_AND_FAULTS_RESPONSE,
-    BENTEL_GET_ARMED_PARTITIONS_REQUEST,
-    BENTEL_GET_ARMED_PARTITIONS_RESPONSE,
-    BENTEL_GET_LOGGER_1_REQUEST,
-    BENTEL_GET_LOGGER_1_RESPONSE,
-    BENTEL_GET_LOGGER_2_REQUEST,
-    BENTEL_GET_LOGGER_2_RESPONSE,
-    BENTEL_GET_LOGGER_3_REQUEST,
-    BENTEL_GET_LOGGER_3_RESPONSE,
-    BENTEL_GET_LOGGER_4_REQUEST,
-    BENTEL_GET_LOGGER_4_RESPONSE,
-    BENTEL_GET_LOGGER_5_REQUEST,
-    BENTEL_GET_LOGGER_5_RESPONSE,
-    BENTEL_GET_LOGGER_6_REQUEST,
-    BENTEL_GET_LOGGER_6_RESPONSE,
-    BENTEL_GET_LOGGER_7_REQUEST,
-    BENTEL_GET_LOGGER_7_RESPONSE,
-    BENTEL_GET_LOGGER_8_REQUEST,
-    BENTEL_GET_LOGGER_8_RESPONSE,
-    BENTEL_GET_LOGGER_9_REQUEST,
-    BENTEL_GET_LOGGER_9_RESPONSE,
-    BENTEL_GET_LOGGER_10_REQUEST,
-    BENTEL_GET_LOGGER_10_RESPONSE,
-    BENTEL_GET_LOGGER_11_REQUEST,
-    BENTEL_GET_LOGGER_11_RESPONSE,
-    BENTEL_GET_LOGGER_12_REQUEST,
-    BENTEL_GET_LOGGER_12_RESPONSE,
-    BENTEL_GET_LOGGER_13_REQUEST,
-    BENTEL_GET_LOGGER_13_RESPONSE,
-    BENTEL_GET_LOGGER_14_REQUEST,
-    BENTEL_GET_LOGGER_14_RESPONSE,
-    BENTEL_GET_LOGGER_15_REQUEST,
-    BENTEL_GET_LOGGER_15_RESPONSE,
-    BENTEL_GET_LOGGER_16_REQUEST,
-    BENTEL_GET_LOGGER_16_RESPONSE,
-    BENTEL_GET_LOGGER_17_REQUEST,
-    BENTEL_GET_LOGGER_17_RESPONSE,
-    BENTEL_GET_LOGGER_18_REQUEST,
-    BENTEL_GET_LOGGER_18_RESPONSE,
-    BENTEL_GET_LOGGER_19_REQUEST,
-    BENTEL_GET_LOGGER_19_RESPONSE,
-    BENTEL_GET_LOGGER_20_REQUEST,
-    BENTEL_GET_LOGGER_20_RESPONSE,
-    BENTEL_GET_LOGGER_21_REQUEST,
-    BENTEL_GET_LOGGER_21_RESPONSE,
-    BENTEL_GET_LOGGER_22_REQUEST,
-    BENTEL_GET_LOGGER_22_RESPONSE,
-    BENTEL_GET_LOGGER_23_REQUEST,
-    BENTEL_GET_LOGGER_23_RESPONSE,
-    BENTEL_GET_LOGGER_24_REQUEST,
-    BENTEL_GET_LOGGER_24_RESPONSE,
-    BENTEL_GET_LOGGER_25_REQUEST,
-    BENTEL_GET_LOGGER_25_RESPONSE,
-    BENTEL_GET_LOGGER_26_REQUEST,
-    BENTEL_GET_LOGGER_26_RESPONSE,
-    BENTEL_GET_LOGGER_27_REQUEST,
-    BENTEL_GET_LOGGER_27_RESPONSE,
-    BENTEL_GET_LOGGER_28_REQUEST,
-    BENTEL_GET_LOGGER_28_RESPONSE,
+    /* nothing decoded */
+    BENTEL_NO_MESSAGE = 0,
+    /*
+     * each request followed by its response, in the order of
+     * bentel_protocol.h: the reads, then the commands
+     */
+#define BENTEL_FRAME_READ(NAME, member, address, length, fields)            \
+    BENTEL_##NAME##_REQUEST,                                                \
+    BENTEL_##NAME##_RESPONSE,
+#define BENTEL_FRAME_COMMAND(NAME, member, address, count, length, fields)  \
+    BENTEL_##NAME##_REQUEST,                                                \
+    BENTEL_##NAME##_RESPONSE,
+#include "bentel_protocol.h"
 };
 
 typedef enum _bentel_event_type_t bentel_event_type_t;
@@ -131,6 +60,10 @@ struct _bentel_event_t
     uint8_t minute;
 };
 
+/** @brief size of an event in the panel logger, see bentel_event_decode() */
+#define BENTEL_EVENT_SIZE 7
+#define BENTEL_LOGGER_EVENTS 256
+
 typedef struct _bentel_message_t bentel_message_t;
 
 struct _bentel_message_t
@@ -297,71 +230,8 @@ struct _bentel_message_t
 
         struct
         {
-            bool alarm_zone_0;
-            bool alarm_zone_1;
-            bool alarm_zone_2;
-            bool alarm_zone_3;
-            bool alarm_zone_4;
-            bool alarm_zone_5;
-            bool alarm_zone_6;
-            bool alarm_zone_7;
-            bool alarm_zone_8;
-            bool alarm_zone_9;
-            bool alarm_zone_10;
-            bool alarm_zone_11;
-            bool alarm_zone_12;
-            bool alarm_zone_13;
-            bool alarm_zone_14;
-            bool alarm_zone_15;
-            bool alarm_zone_16;
-            bool alarm_zone_17;
-            bool alarm_zone_18;
-            bool alarm_zone_19;
-            bool alarm_zone_20;
-            bool alarm_zone_21;
-            bool alarm_zone_22;
-            bool alarm_zone_23;
-            bool alarm_zone_24;
-            bool alarm_zone_25;
-            bool alarm_zone_26;
-            bool alarm_zone_27;
-            bool alarm_zone_28;
-            bool alarm_zone_29;
-            bool alarm_zone_30;
-            bool alarm_zone_31;
-
-            bool sabotage_zone_0;
-            bool sabotage_zone_1;
-            bool sabotage_zone_2;
-            bool sabotage_zone_3;
-            bool sabotage_zone_4;
-            bool sabotage_zone_5;
-            bool sabotage_zone_6;
-            bool sabotage_zone_7;
-            bool sabotage_zone_8;
-            bool sabotage_zone_9;
-            bool sabotage_zone_10;
-            bool sabotage_zone_11;
-            bool sabotage_zone_12;
-            bool sabotage_zone_13;
-            bool sabotage_zone_14;
-            bool sabotage_zone_15;
-            bool sabotage_zone_16;
-            bool sabotage_zone_17;
-            bool sabotage_zone_18;
-            bool sabotage_zone_19;
-            bool sabotage_zone_20;
-            bool sabotage_zone_21;
-            bool sabotage_zone_22;
-            bool sabotage_zone_23;
-            bool sabotage_zone_24;
-            bool sabotage_zone_25;
-            bool sabotage_zone_26;
-            bool sabotage_zone_27;
-            bool sabotage_zone_28;
-            bool sabotage_zone_29;
-            bool sabotage_zone_30;
-            bool sabotage_zone_31;
+            bool alarm_zone[32];
+            bool sabotage_zone[32];
 
             bool alarm_power;
             bool alarm_bpi;
@@ -371,14 +241,7 @@ struct _bentel_message_t
             bool alarm_default_codes;
             bool alarm_wireless;
 
-            bool alarm_partition_0;
-            bool alarm_partition_1;
-            bool alarm_partition_2;
-            bool alarm_partition_3;
-            bool alarm_partition_4;
-            bool alarm_partition_5;
-            bool alarm_partition_6;
-            bool alarm_partition_7;
+            bool alarm_partition[8];
 
             bool sabotage_partition;
             bool sabotage_fake_key;
@@ -417,9 +280,34 @@ struct _bentel_message_t
             bentel_event_t events[256];
         } get_logger_27_response;
 
+        struct
+        {
+            bool arm[8];
+            bool stay[8];
+            bool disarm[8];
+        } arm_partitions_request;
+
+        struct
+        {
+            bool exclude[32];
+            bool include[32];
+        } bypass_zones_request;
+
+        struct
+        {
+        } reset_alarms_request;
+
     } u;
 };
 
+/*
+ * every frame starts with f0 (a read) or 0f (a command) and 4 bytes of
+ * address, plus a checksum
+ */
+#define BENTEL_HEADER_SIZE 6
+#define BENTEL_READ 0xf0
+#define BENTEL_WRITE 0x0f
+
 typedef struct _bentel_layer_ops_t bentel_layer_ops_t;
 
 struct _bentel_layer_ops_t
@@ -438,7 +326,18 @@ struct _bentel_layer_t
     void * lower_layer;
     bentel_layer_ops_t * ops;
 
-    uint8_t logger[1792];
+    /*
+     * Only listen to the traffic between the panel and another master
+     * (a keypad or a vendor module): requests are decoded too, and
+     * nothing is ever sent. See bentel_layer_received_message ().
+     */
+    bool listen_only;
+    /** @brief frames that did not decode, each costs a character */
+    uint32_t resyncs;
+    /** @brief characters moved down the buffer as frames are consumed */
+    uint32_t moved;
+
+    uint8_t logger[BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE];
     unsigned char buffer[524];
     int buffer_index;
 };
@@ -451,4 +350,10 @@ int bentel_layer_send_message (void * layer, void * message);
 
 void bentel_layer_received_message (void * layer, void * message, int len);
 
+/*
+ * Decode one event of the logger mirror (bentel_layer_t.logger).
+ * Returns -1 for an empty slot.
+ */
+int bentel_event_decode (const uint8_t * raw, bentel_event_t * event);
+
 #endif /* _bentel_layer_h_ */
@@ -10,4 +10,12 @@ int bentel_message_decode (bentel_layer_t * bental_layer,
                            bentel_message_t * bentel_message,
                            unsigned char * buffer, int len);
 
+/*
+ * Decode a request frame, as sent by another master on the line.
+ * Returns the length of the frame, 0 if more characters are needed,
+ * -1 on a bad header checksum and -4 for an unknown request.
+ */
+int bentel_request_decode (bentel_message_t * bentel_message,
+                           unsigned char * buffer, int len);
+
 #endif /* _bentel_layer_private_h_ */
@@ -0,0 +1,297 @@
+/*
+ * The protocol of the KYO32, as a table of the frames and of the fields
+ * in their data. This is not an ordinary header: it is included with
+ * some of the macros below defined, and expands to what each of them
+ * makes of the rows, as lwip/priv/memp_std.h does for the lwIP pools.
+ * Of it, bentel_layer.h makes bentel_message_type_t,
+ * bentel_layer_private.c the encoder and the decoders, and
+ * host/bentel_fuzz.c the vectors the two are checked against.
+ *
+ * BENTEL_FRAME_READ (NAME, member, address, length, fields)
+ *
+ *   -> f0 aa AA nn 00 cc
+ *   <- f0 aa AA nn 00 cc d0 ... dn cc
+ *
+ *   the length (nn + 1) bytes at the address AAaa of the panel,
+ *   requested by BENTEL_NAME_REQUEST and answered with
+ *   BENTEL_NAME_RESPONSE, whose data the fields decode into
+ *   bentel_message_t.u.member
+ *
+ * BENTEL_FRAME_COMMAND (NAME, member, address, count, length, fields)
+ *
+ *   -> 0f aa AA nn 00 cc d0 ... cc
+ *   <- 0f aa AA nn 00 cc
+ *
+ *   a command of length bytes, which the fields encode from
+ *   bentel_message_t.u.member, acknowledged by the panel with its
+ *   header. nn is count, not always the length.
+ *
+ * The fields, at offset in the data (d0 is at 0), where i is the
+ * index of the bit:
+ *
+ * BENTEL_FIELD_BITS (field, offset, bit, count)
+ *   the count booleans field, for i from 0, in the bits from bit
+ * BENTEL_FIELD_ZONES (field, offset)
+ *   the 32 booleans field in 4 bytes, zones 25-32 first
+ * BENTEL_FIELD_BYTE (field, offset)
+ *   a boolean, true if the byte is not 0
+ * BENTEL_FIELD_TEXT (field, offset, length)
+ *   a string of length characters, padded with spaces
+ * BENTEL_FIELD_DIGITS (field, offset, count)
+ *   a number of count ASCII digits
+ * BENTEL_FIELD_LOGGER (index, length)
+ *   length bytes of the logger, to bentel_layer_t.logger[index]
+ * BENTEL_FIELD_VALUE (offset, value)
+ *   a byte of a command that is always value
+ *
+ * The macros that are not defined expand to nothing, and all of them
+ * are undefined at the end.
+ */
+
+#ifndef BENTEL_FRAME_READ
+#define BENTEL_FRAME_READ(NAME, member, address, length, fields)
+#endif
+
+#ifndef BENTEL_FRAME_COMMAND
+#define BENTEL_FRAME_COMMAND(NAME, member, address, count, length, fields)
+#endif
+
+#ifndef BENTEL_FIELD_BITS
+#define BENTEL_FIELD_BITS(field, offset, bit, count)
+#endif
+
+#ifndef BENTEL_FIELD_BYTE
+#define BENTEL_FIELD_BYTE(field, offset)
+#endif
+
+#ifndef BENTEL_FIELD_TEXT
+#define BENTEL_FIELD_TEXT(field, offset, length)
+#endif
+
+#ifndef BENTEL_FIELD_DIGITS
+#define BENTEL_FIELD_DIGITS(field, offset, count)
+#endif
+
+#ifndef BENTEL_FIELD_LOGGER
+#define BENTEL_FIELD_LOGGER(index, length)
+#endif
+
+#ifndef BENTEL_FIELD_VALUE
+#define BENTEL_FIELD_VALUE(offset, value)
+#endif
+
+#define BENTEL_FIELD_ZONES(field, offset)                       \
+    BENTEL_FIELD_BITS (field[24 + i], (offset), 0, 8)           \
+    BENTEL_FIELD_BITS (field[16 + i], (offset) + 1, 0, 8)       \
+    BENTEL_FIELD_BITS (field[8 + i], (offset) + 2, 0, 8)        \
+    BENTEL_FIELD_BITS (field[i], (offset) + 3, 0, 8)
+
+/* KYO32   2.12 */
+BENTEL_FRAME_READ (GET_MODEL, get_model_response, 0x0000, 12,
+    BENTEL_FIELD_TEXT (model, 0, 8)
+    BENTEL_FIELD_DIGITS (fw_major, 8, 1)
+    BENTEL_FIELD_DIGITS (fw_minor, 10, 2))
+
+/* readers 9-16, 1-8, keyboards: present, sabotage, alive */
+BENTEL_FRAME_READ (GET_PERIPHERALS, get_peripherals_response, 0xf009, 12,
+    BENTEL_FIELD_BITS (readers[8 + i].present, 0, 0, 8)
+    BENTEL_FIELD_BITS (readers[i].present, 1, 0, 8)
+    BENTEL_FIELD_BITS (keyboards[i].present, 2, 0, 8)
+    BENTEL_FIELD_BITS (readers[8 + i].sabotage, 4, 0, 8)
+    BENTEL_FIELD_BITS (readers[i].sabotage, 5, 0, 8)
+    BENTEL_FIELD_BITS (keyboards[i].sabotage, 6, 0, 8)
+    BENTEL_FIELD_BITS (readers[8 + i].alive, 8, 0, 8)
+    BENTEL_FIELD_BITS (readers[i].alive, 9, 0, 8)
+    BENTEL_FIELD_BITS (keyboards[i].alive, 10, 0, 8))
+
+/* 4 names of 16 characters each, not NULL terminated */
+BENTEL_FRAME_READ (GET_ZONES_NAMES_0_3, get_zones_names_0_3_response,
+                   0x19b0, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_4_7, get_zones_names_4_7_response,
+                   0x19f0, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_8_11, get_zones_names_8_11_response,
+                   0x1a30, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_12_15, get_zones_names_12_15_response,
+                   0x1a70, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_16_19, get_zones_names_16_19_response,
+                   0x1ab0, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_20_23, get_zones_names_20_23_response,
+                   0x1af0, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_24_27, get_zones_names_24_27_response,
+                   0x1b30, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_ZONES_NAMES_28_31, get_zones_names_28_31_response,
+                   0x1b70, 64,
+    BENTEL_FIELD_TEXT (zones[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (zones[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (zones[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (zones[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_PARTITIONS_NAMES_0_3,
+                   get_partitions_names_0_3_response, 0x1750, 64,
+    BENTEL_FIELD_TEXT (partitions[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (partitions[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (partitions[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (partitions[3].name, 48, 16))
+
+BENTEL_FRAME_READ (GET_PARTITIONS_NAMES_4_7,
+                   get_partitions_names_4_7_response, 0x1790, 64,
+    BENTEL_FIELD_TEXT (partitions[0].name, 0, 16)
+    BENTEL_FIELD_TEXT (partitions[1].name, 16, 16)
+    BENTEL_FIELD_TEXT (partitions[2].name, 32, 16)
+    BENTEL_FIELD_TEXT (partitions[3].name, 48, 16))
+
+/* zones alarm, zones sabotage, warnings, partitions alarm, sabotages */
+BENTEL_FRAME_READ (GET_STATUS_AND_FAULTS, get_status_and_faults_response,
+                   0xf004, 11,
+    BENTEL_FIELD_ZONES (alarm_zone, 0)
+    BENTEL_FIELD_ZONES (sabotage_zone, 4)
+    BENTEL_FIELD_BITS (alarm_power, 8, 0, 1)
+    BENTEL_FIELD_BITS (alarm_bpi, 8, 1, 1)
+    BENTEL_FIELD_BITS (alarm_fuse, 8, 2, 1)
+    BENTEL_FIELD_BITS (alarm_battery_low, 8, 3, 1)
+    BENTEL_FIELD_BITS (alarm_telephone_line, 8, 4, 1)
+    BENTEL_FIELD_BITS (alarm_default_codes, 8, 5, 1)
+    BENTEL_FIELD_BITS (alarm_wireless, 8, 6, 1)
+    BENTEL_FIELD_BITS (alarm_partition[i], 9, 0, 8)
+    BENTEL_FIELD_BITS (sabotage_partition, 10, 2, 1)
+    BENTEL_FIELD_BITS (sabotage_fake_key, 10, 3, 1)
+    BENTEL_FIELD_BITS (sabotage_bpi, 10, 4, 1)
+    BENTEL_FIELD_BITS (sabotage_system, 10, 5, 1)
+    BENTEL_FIELD_BITS (sabotage_jam, 10, 6, 1)
+    BENTEL_FIELD_BITS (sabotage_wireless, 10, 7, 1))
+
+/* bytes 0-2 are not known */
+BENTEL_FRAME_READ (GET_ARMED_PARTITIONS, get_armed_partitions_response,
+                   0x1502, 19,
+    BENTEL_FIELD_BITS (partition_armed_state[i], 3, 0, 8)
+    BENTEL_FIELD_BYTE (siren_state, 4)
+    BENTEL_FIELD_BITS (digital_output_state[8 + i], 5, 0, 8)
+    BENTEL_FIELD_BITS (digital_output_state[i], 6, 0, 8)
+    BENTEL_FIELD_ZONES (zone_inclusion, 7)
+    BENTEL_FIELD_ZONES (zone_alarm_memory, 11)
+    BENTEL_FIELD_ZONES (zone_sabotage_memory, 15))
+
+/*
+ * The logger, 256 events of 7 bytes, in 28 reads of 64 bytes: the
+ * events are not aligned to the reads.
+ */
+BENTEL_FRAME_READ (GET_LOGGER_1, get_logger_1_to_27_response, 0x0d3d, 64,
+    BENTEL_FIELD_LOGGER (0 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_2, get_logger_1_to_27_response, 0x0d7d, 64,
+    BENTEL_FIELD_LOGGER (1 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_3, get_logger_1_to_27_response, 0x0dbd, 64,
+    BENTEL_FIELD_LOGGER (2 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_4, get_logger_1_to_27_response, 0x0dfd, 64,
+    BENTEL_FIELD_LOGGER (3 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_5, get_logger_1_to_27_response, 0x0e3d, 64,
+    BENTEL_FIELD_LOGGER (4 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_6, get_logger_1_to_27_response, 0x0e7d, 64,
+    BENTEL_FIELD_LOGGER (5 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_7, get_logger_1_to_27_response, 0x0ebd, 64,
+    BENTEL_FIELD_LOGGER (6 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_8, get_logger_1_to_27_response, 0x0efd, 64,
+    BENTEL_FIELD_LOGGER (7 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_9, get_logger_1_to_27_response, 0x0f3d, 64,
+    BENTEL_FIELD_LOGGER (8 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_10, get_logger_1_to_27_response, 0x0f7d, 64,
+    BENTEL_FIELD_LOGGER (9 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_11, get_logger_1_to_27_response, 0x0fbd, 64,
+    BENTEL_FIELD_LOGGER (10 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_12, get_logger_1_to_27_response, 0x0ffd, 64,
+    BENTEL_FIELD_LOGGER (11 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_13, get_logger_1_to_27_response, 0x103d, 64,
+    BENTEL_FIELD_LOGGER (12 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_14, get_logger_1_to_27_response, 0x107d, 64,
+    BENTEL_FIELD_LOGGER (13 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_15, get_logger_1_to_27_response, 0x10bd, 64,
+    BENTEL_FIELD_LOGGER (14 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_16, get_logger_1_to_27_response, 0x10fd, 64,
+    BENTEL_FIELD_LOGGER (15 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_17, get_logger_1_to_27_response, 0x113d, 64,
+    BENTEL_FIELD_LOGGER (16 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_18, get_logger_1_to_27_response, 0x117d, 64,
+    BENTEL_FIELD_LOGGER (17 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_19, get_logger_1_to_27_response, 0x11bd, 64,
+    BENTEL_FIELD_LOGGER (18 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_20, get_logger_1_to_27_response, 0x11fd, 64,
+    BENTEL_FIELD_LOGGER (19 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_21, get_logger_1_to_27_response, 0x123d, 64,
+    BENTEL_FIELD_LOGGER (20 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_22, get_logger_1_to_27_response, 0x127d, 64,
+    BENTEL_FIELD_LOGGER (21 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_23, get_logger_1_to_27_response, 0x12bd, 64,
+    BENTEL_FIELD_LOGGER (22 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_24, get_logger_1_to_27_response, 0x12fd, 64,
+    BENTEL_FIELD_LOGGER (23 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_25, get_logger_1_to_27_response, 0x133d, 64,
+    BENTEL_FIELD_LOGGER (24 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_26, get_logger_1_to_27_response, 0x137d, 64,
+    BENTEL_FIELD_LOGGER (25 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_27, get_logger_1_to_27_response, 0x13bd, 64,
+    BENTEL_FIELD_LOGGER (26 * 64, 64))
+BENTEL_FRAME_READ (GET_LOGGER_28, get_logger_27_response, 0x13fd, 64,
+    BENTEL_FIELD_LOGGER (27 * 64, 64))
+
+/*
+ * The commands. One bit per partition in each mask of arm_partitions,
+ * the partitions that are in none of them are left as they are.
+ */
+BENTEL_FRAME_COMMAND (ARM_PARTITIONS, arm_partitions_request,
+                      0xf000, 0x03, 19,
+    BENTEL_FIELD_BITS (arm[i], 0, 0, 8)
+    BENTEL_FIELD_BITS (stay[i], 1, 0, 8)
+    BENTEL_FIELD_BITS (disarm[i], 3, 0, 8))
+
+BENTEL_FRAME_COMMAND (BYPASS_ZONES, bypass_zones_request,
+                      0xf001, 0x07, 8,
+    BENTEL_FIELD_ZONES (exclude, 0)
+    BENTEL_FIELD_ZONES (include, 4))
+
+BENTEL_FRAME_COMMAND (RESET_ALARMS, reset_alarms_request,
+                      0xf005, 0x01, 2,
+    BENTEL_FIELD_VALUE (0, 0x07))
+
+#undef BENTEL_FRAME_READ
+#undef BENTEL_FRAME_COMMAND
+#undef BENTEL_FIELD_BITS
+#undef BENTEL_FIELD_ZONES
+#undef BENTEL_FIELD_BYTE
+#undef BENTEL_FIELD_TEXT
+#undef BENTEL_FIELD_DIGITS
+#undef BENTEL_FIELD_LOGGER
+#undef BENTEL_FIELD_VALUE
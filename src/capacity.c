@@ -0,0 +1,30 @@
+#include <string.h>
+
+#include "capacity.h"
+
+/* longer prefixes first, so that "KYO32" is not taken for "KYO3" */
+static const capacity_t capacities[] =
+{
+    { "KYO32", 32, 8 },
+    { "KYO8", 8, 4 },
+    { "KYO4", 4, 4 },
+};
+
+static const capacity_t capacity_full = { "", 32, 8 };
+
+const capacity_t *
+capacity_lookup (const char * model)
+{
+    size_t i;
+
+    for (i = 0 ; i < sizeof (capacities) / sizeof (capacities[0]) ; i++)
+    {
+        if (strncmp (model, capacities[i].model,
+                     strlen (capacities[i].model)) == 0)
+        {
+            return &capacities[i];
+        }
+    }
+
+    return &capacity_full;
+}
@@ -0,0 +1,27 @@
+#ifndef _capacity_h_
+#define _capacity_h_
+
+/*
+ * Number of zones and partitions of each panel model. The arrays in
+ * configuration_t are sized for the largest panel (KYO32); only the
+ * first zones and partitions of the capacity are polled, tracked and
+ * rendered.
+ */
+
+typedef struct _capacity_t capacity_t;
+
+struct _capacity_t
+{
+    /** @brief prefix of the model string in BENTEL_GET_MODEL_RESPONSE */
+    const char * model;
+    int zones;
+    int partitions;
+};
+
+/*
+ * The capacity for the model string, or the full capacity if the
+ * model is not known (yet).
+ */
+const capacity_t * capacity_lookup (const char * model);
+
+#endif /* _capacity_h_ */
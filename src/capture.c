@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <pico/stdlib.h>
+
+#include "capture.h"
+
+#define CAPTURE_RECORD_MAX 256
+
+static inline uint8_t
+capture_get (capture_t * capture, uint32_t position)
+{
+    return capture->ring[position % capture->size];
+}
+
+static inline void
+capture_put (capture_t * capture, uint8_t value)
+{
+    capture->ring[capture->head % capture->size] = value;
+    capture->head++;
+}
+
+/* read the varint at *position, and move past it */
+static uint64_t
+capture_get_varint (capture_t * capture, uint32_t * position)
+{
+    uint64_t value = 0;
+    uint8_t byte;
+    int shift = 0;
+
+    do
+    {
+        byte = capture_get (capture, (*position)++);
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    }
+    while ((byte & 0x80) && shift < 64);
+
+    return value;
+}
+
+static void
+capture_put_varint (capture_t * capture, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        capture_put (capture, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    capture_put (capture, value);
+}
+
+/* drop the oldest record */
+static void
+capture_drop (capture_t * capture)
+{
+    uint32_t position;
+    uint64_t tagged;
+    int count;
+
+    position = capture->tail;
+    tagged = capture_get_varint (capture, &position);
+    count = capture_get (capture, position++) + 1;
+
+    if (capture->is_open && capture->open == position - 1)
+    {
+        capture->is_open = false;
+    }
+
+    capture->tail = position + count;
+    capture->base_us += tagged >> 1;
+    capture->dropped++;
+}
+
+/* make room for len more bytes */
+static void
+capture_reserve (capture_t * capture, uint32_t len)
+{
+    while (capture->head != capture->tail &&
+           capture->head - capture->tail + len > capture->size)
+    {
+        capture_drop (capture);
+    }
+}
+
+int
+capture_start (void * layer)
+{
+    capture_t * capture;
+
+    capture = (capture_t *) layer;
+
+    critical_section_init (&capture->critsec);
+
+    capture->head = 0;
+    capture->tail = 0;
+    capture->base_us = to_us_since_boot (get_absolute_time ());
+    capture->last_us = capture->base_us;
+    capture->last_byte_us = capture->base_us;
+    capture->is_open = false;
+    capture->dropped = 0;
+
+    return 0;
+}
+
+void
+capture_stop (void * layer)
+{
+    (void) layer;
+}
+
+void
+__time_critical_func(capture_write) (capture_t * capture, int direction,
+                                     const uint8_t * data, int len)
+{
+    uint64_t now;
+    uint32_t count;
+    bool merge;
+    int i;
+
+    now = to_us_since_boot (get_absolute_time ());
+
+    critical_section_enter_blocking (&capture->critsec);
+
+    for (i = 0 ; i < len ; i++)
+    {
+        count = capture->is_open ?
+            capture_get (capture, capture->open) + 1u : 0;
+
+        merge = capture->is_open &&
+                capture->open_direction == direction &&
+                now - capture->last_byte_us < CAPTURE_MERGE_US &&
+                count < CAPTURE_RECORD_MAX;
+
+        if (merge)
+        {
+            capture_reserve (capture, 1);
+            merge = capture->is_open;
+        }
+
+        if (!merge)
+        {
+            /* varint of up to 64 bits, count, and the byte */
+            capture_reserve (capture, 10 + 1 + 1);
+
+            capture_put_varint (capture,
+                                ((now - capture->last_us) << 1) | direction);
+            capture->open = capture->head;
+            capture->is_open = true;
+            capture->open_direction = direction;
+            capture_put (capture, 0xff);
+            capture->last_us = now;
+        }
+
+        /* the count is one less than the bytes, 0xff + 1 is 0 */
+        capture->ring[capture->open % capture->size]++;
+        capture_put (capture, data[i]);
+        capture->last_byte_us = now;
+    }
+
+    critical_section_exit (&capture->critsec);
+}
+
+int
+capture_read (capture_t * capture, uint8_t * buffer, int len)
+{
+    capture_header_t header;
+    uint32_t used;
+    uint32_t i;
+
+    critical_section_enter_blocking (&capture->critsec);
+
+    used = capture->head - capture->tail;
+
+    if (sizeof (header) + used > (uint32_t) len)
+    {
+        critical_section_exit (&capture->critsec);
+        return -1;
+    }
+
+    memcpy (header.magic, CAPTURE_MAGIC, sizeof (header.magic));
+    header.version = CAPTURE_VERSION;
+    memset (header.reserved, 0, sizeof (header.reserved));
+    header.start_us = capture->base_us;
+    header.dropped = capture->dropped;
+    header.len = used;
+
+    for (i = 0 ; i < used ; i++)
+    {
+        buffer[sizeof (header) + i] = capture_get (capture, capture->tail + i);
+    }
+
+    critical_section_exit (&capture->critsec);
+
+    memcpy (buffer, &header, sizeof (header));
+
+    return sizeof (header) + used;
+}
@@ -0,0 +1,99 @@
+#ifndef _capture_h_
+#define _capture_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pico/critical_section.h>
+
+/*
+ * The raw bytes of a panel link, both ways, with their time, in a RAM
+ * ring that keeps the newest. The link layers (uart_layer_t,
+ * pio_uart_layer_t) write to it when their capture is set; /capture
+ * downloads it, and host/bentel_replay plays it back through the
+ * stack.
+ *
+ * The ring holds records of the bytes that went one way back to back
+ * (less than CAPTURE_MERGE_US apart, up to 256):
+ *
+ * varint ((delta_us << 1) | direction)   time since the previous record
+ * count - 1                              one byte
+ * bytes
+ *
+ * where a varint is 7 bits per byte, least significant first, with
+ * bit 7 set on all but the last. At 9600 baud a frame costs its length
+ * plus 3 or 4 bytes.
+ *
+ * capture_read () copies the ring out as a file: a capture_header_t,
+ * little endian, then the records, the first of which is delta_us
+ * after start_us.
+ */
+
+#define CAPTURE_RX 0
+#define CAPTURE_TX 1
+
+/* 2 character times at 9600 baud */
+#define CAPTURE_MERGE_US 2083
+
+#define CAPTURE_MAGIC "BCAP"
+#define CAPTURE_VERSION 1
+
+typedef struct _capture_header_t capture_header_t;
+
+struct _capture_header_t
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    /** @brief us since boot */
+    uint64_t start_us;
+    /** @brief records lost to the ring since capture_start () */
+    uint32_t dropped;
+    /** @brief bytes of records after the header */
+    uint32_t len;
+};
+
+typedef struct _capture_t capture_t;
+
+struct _capture_t
+{
+    /* a power of 2 (for the free running positions), at least 1 KiB */
+    uint8_t * ring;
+    uint32_t size;
+
+    /* set by capture_start () */
+    critical_section_t critsec;
+
+    /* free running, the ring index is modulo size */
+    uint32_t head;
+    uint32_t tail;
+
+    /** @brief time the delta of the record at tail is from */
+    uint64_t base_us;
+    /** @brief time of the newest record, and of its last byte */
+    uint64_t last_us;
+    uint64_t last_byte_us;
+
+    /** @brief position of the count of the newest record, if open */
+    uint32_t open;
+    bool is_open;
+    int open_direction;
+
+    uint32_t dropped;
+};
+
+int capture_start (void * layer);
+
+void capture_stop (void * layer);
+
+/* Called by the link layers, also from interrupt handlers. */
+void capture_write (capture_t * capture, int direction,
+                    const uint8_t * data, int len);
+
+/*
+ * Copy the capture, header first, into buffer. Returns the length, or
+ * -1 if it does not fit in len.
+ */
+int capture_read (capture_t * capture, uint8_t * buffer, int len);
+
+#endif /* _capture_h_ */
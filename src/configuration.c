@@ -1,4 +1,8 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "configuration.h"
+#include "identity_cache.h"
 
 int configuration_start (void * layer)
 {
@@ -8,6 +12,14 @@ int configuration_start (void * layer)
 
     sem_init (&configuration->semaphore, 1, 1);
 
+    /* generation 0 is reserved for "everything", see render_delta() */
+    configuration->generation = 1;
+    configuration->dirty = false;
+
+    configuration->capacity = capacity_lookup ("");
+
+    identity_cache_load (configuration);
+
     return 0;
 }
 
@@ -17,3 +29,79 @@ void configuration_stop (void * layer)
 
     configuration = (configuration_t *) layer;
 }
+
+/*
+ * The configuration_update_*() functions must be called with the
+ * semaphore held. They only write the field if the value differs, and
+ * in that case stamp the entity with the generation that the next
+ * configuration_commit() will publish.
+ */
+void
+configuration_update_bool (configuration_t * configuration,
+                           bool * field, bool value, uint32_t * generation)
+{
+    if (*field == value)
+    {
+        return;
+    }
+
+    *field = value;
+    *generation = configuration->generation + 1;
+    configuration->dirty = true;
+}
+
+void
+configuration_update_int (configuration_t * configuration,
+                          int * field, int value, uint32_t * generation)
+{
+    if (*field == value)
+    {
+        return;
+    }
+
+    *field = value;
+    *generation = configuration->generation + 1;
+    configuration->dirty = true;
+}
+
+void
+configuration_update_string (configuration_t * configuration,
+                             char * field, size_t size, const char * value,
+                             uint32_t * generation)
+{
+    if (strncmp (field, value, size - 1) == 0)
+    {
+        return;
+    }
+
+    snprintf (field, size, "%s", value);
+    *generation = configuration->generation + 1;
+    configuration->dirty = true;
+}
+
+void
+configuration_update_capacity (configuration_t * configuration)
+{
+    const capacity_t * capacity;
+
+    capacity = capacity_lookup (configuration->model);
+
+    if (configuration->capacity == capacity)
+    {
+        return;
+    }
+
+    configuration->capacity = capacity;
+    configuration->identity_generation = configuration->generation + 1;
+    configuration->dirty = true;
+}
+
+void
+configuration_commit (configuration_t * configuration)
+{
+    if (configuration->dirty)
+    {
+        configuration->generation++;
+        configuration->dirty = false;
+    }
+}
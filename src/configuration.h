@@ -4,18 +4,55 @@
 #include <pico/sem.h>
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "bentel_layer.h"
+#include "capacity.h"
+
+/* the model, and each page of four zone or partition names */
+#define IDENTITY_ANSWERED_MODEL 1u
+#define IDENTITY_ANSWERED_ZONES(first) (1u << (1 + (first) / 4))
+#define IDENTITY_ANSWERED_PARTITIONS(first) (1u << (9 + (first) / 4))
 
 typedef struct _configuration_t configuration_t;
 
 struct _configuration_t
 {
     semaphore_t semaphore;
+
+    /**
+     * @brief incremented by configuration_commit() every time a message
+     * changed at least one field. Each entity below remembers the
+     * generation in which it last changed, so that a reader can ask
+     * for everything newer than the last generation it has seen.
+     */
+    uint32_t generation;
+    bool dirty;
+
+    uint32_t identity_generation;
     char model[9];
     int fw_major;
     int fw_minor;
 
+    /**
+     * @brief true while model, firmware version and names come from
+     * the flash cache, and the panel has not confirmed them yet.
+     */
+    bool identity_cached;
+    /**
+     * @brief IDENTITY_ANSWERED_* bits of the responses received since
+     * the state machine started the current identity sweep.
+     */
+    uint32_t identity_answered;
+    /** @brief flash sector of the identity cache of this panel */
+    uint32_t identity_offset;
+
+    /** @brief zones and partitions of the model, see capacity.h */
+    const capacity_t * capacity;
+
+    uint32_t peripherals_generation;
+
     struct
     {
         bool present;
@@ -39,6 +76,7 @@ struct _configuration_t
 	bool inclusion;
 	bool alarm_memory;
 	bool sabotage_memory;
+	uint32_t generation;
     } zones[32];
 
     /**
@@ -50,13 +88,18 @@ struct _configuration_t
         char name[17];
 	bool alarm;
 	bool armed;
+	uint32_t generation;
     } partitions[8];
 
     struct
     {
         bool active;
+        uint32_t generation;
     } digital_outputs[16];
 
+    /** @brief covers the alarm_*, sabotage_* and siren_state flags */
+    uint32_t faults_generation;
+
     bool alarm_power;
     bool alarm_bpi;
     bool alarm_fuse;
@@ -81,4 +124,25 @@ int configuration_start (void * layer);
 
 void configuration_stop (void * layer);
 
+void configuration_update_bool (configuration_t * configuration,
+                                bool * field, bool value,
+                                uint32_t * generation);
+
+void configuration_update_int (configuration_t * configuration,
+                               int * field, int value,
+                               uint32_t * generation);
+
+void configuration_update_string (configuration_t * configuration,
+                                  char * field, size_t size,
+                                  const char * value,
+                                  uint32_t * generation);
+
+/*
+ * Select the capacity for the current model, stamping the identity
+ * if it changed.
+ */
+void configuration_update_capacity (configuration_t * configuration);
+
+void configuration_commit (configuration_t * configuration);
+
 #endif /* _configuration_h_ */
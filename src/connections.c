@@ -0,0 +1,433 @@
+#include <string.h>
+
+#include "pico/time.h"
+#include "lwip/altcp.h"
+
+#include "connections.h"
+#include "render.h"
+
+/*
+ * Only updated and read from the lwIP context (the altcp callbacks and
+ * the HTTP handlers), so no locking is needed.
+ */
+static connections_t connections;
+
+#define CONNECTIONS_LISTENERS 2
+
+/*
+ * The listeners whose accept callback is wrapped, each by its own
+ * connections_accept_<n> (), since lwIP does not tell the accept
+ * callback which listener the connection came from.
+ */
+typedef struct _connections_listener_t connections_listener_t;
+
+struct _connections_listener_t
+{
+    struct altcp_pcb * pcb;
+    altcp_accept_fn accept;
+};
+
+static connections_listener_t listeners[CONNECTIONS_LISTENERS];
+
+/*
+ * The recv callback of each connection is kept in its slot. This one,
+ * the last of them, is for the connections whose slot was evicted
+ * while lwIP still had them: they all belong to the server, which
+ * installs the same recv callback on each.
+ */
+static altcp_recv_fn evicted_recv;
+
+static const char eoh[] = "\r\n\r\n";
+
+void __real_altcp_accept (struct altcp_pcb * conn, altcp_accept_fn accept);
+void __real_altcp_recv (struct altcp_pcb * conn, altcp_recv_fn recv);
+err_t __real_altcp_write (struct altcp_pcb * conn, const void * dataptr,
+                          u16_t len, u8_t apiflags);
+err_t __real_altcp_close (struct altcp_pcb * conn);
+void __real_altcp_abort (struct altcp_pcb * conn);
+
+static uint32_t
+connections_now (void)
+{
+    return to_ms_since_boot (get_absolute_time ());
+}
+
+static connection_t *
+connections_lookup (void * pcb)
+{
+    int i;
+
+    if (pcb == NULL)
+    {
+        return NULL;
+    }
+
+    for (i = 0 ; i < CONNECTIONS_MAX ; i++)
+    {
+        if (connections.connections[i].pcb == pcb)
+        {
+            return &connections.connections[i];
+        }
+    }
+
+    return NULL;
+}
+
+static connection_t *
+connections_alloc (void * pcb)
+{
+    connection_t * connection;
+    int i;
+
+    /*
+     * lwIP reuses the pcbs of the connections it dropped on an error,
+     * which never went through altcp_close: a slot that still holds the
+     * same pcb is stale, and is the one to reuse.
+     */
+    connection = connections_lookup (pcb);
+
+    if (connection == NULL)
+    {
+        for (i = 0 ; i < CONNECTIONS_MAX ; i++)
+        {
+            if (connections.connections[i].pcb == NULL)
+            {
+                connection = &connections.connections[i];
+                break;
+            }
+
+            if (connection == NULL ||
+                connections.connections[i].active_ms < connection->active_ms)
+            {
+                connection = &connections.connections[i];
+            }
+        }
+    }
+
+    if (connection->pcb != NULL)
+    {
+        connections.evicted++;
+    }
+
+    memset (connection, 0, sizeof (connection_t));
+    connection->pcb = pcb;
+    connection->opened_ms = connections_now ();
+    connection->active_ms = connection->opened_ms;
+    connection->handshake_ms = -1;
+
+    connections.accepted++;
+
+    return connection;
+}
+
+static void
+connections_free (connection_t * connection)
+{
+    connection->pcb = NULL;
+    connections.closed++;
+}
+
+static void
+connections_count_requests (connection_t * connection, struct pbuf * p)
+{
+    struct pbuf * q;
+    const char * data;
+    u16_t i;
+
+    for (q = p ; q != NULL ; q = q->next)
+    {
+        data = (const char *) q->payload;
+
+        for (i = 0 ; i < q->len ; i++)
+        {
+            if (data[i] == eoh[connection->eoh])
+            {
+                connection->eoh++;
+            }
+            else
+            {
+                connection->eoh = (data[i] == eoh[0]) ? 1 : 0;
+            }
+
+            if (connection->eoh == sizeof (eoh) - 1)
+            {
+                connection->requests++;
+                connections.requests++;
+                connection->eoh = 0;
+            }
+        }
+    }
+}
+
+static err_t
+connections_recv (void * arg, struct altcp_pcb * conn, struct pbuf * p,
+                  err_t err)
+{
+    connection_t * connection;
+    altcp_recv_fn recv = evicted_recv;
+
+    connection = connections_lookup (conn);
+
+    if (connection != NULL)
+    {
+        recv = connection->recv;
+    }
+
+    if (connection != NULL && p != NULL)
+    {
+        connection->active_ms = connections_now ();
+
+        if (connection->handshake_ms < 0)
+        {
+            connection->handshake_ms =
+                connection->active_ms - connection->opened_ms;
+            connections.handshake_ms_total += connection->handshake_ms;
+            connections.handshakes++;
+        }
+
+        connections_count_requests (connection, p);
+    }
+
+    return recv (arg, conn, p, err);
+}
+
+static err_t
+connections_accept (int listener, void * arg, struct altcp_pcb * new_conn,
+                    err_t err)
+{
+    connection_t * connection = NULL;
+    err_t ret;
+
+    if (err == ERR_OK && new_conn != NULL)
+    {
+        connection = connections_alloc (new_conn);
+    }
+
+    ret = listeners[listener].accept (arg, new_conn, err);
+
+    /* the server refused the connection, and already aborted it */
+    if (ret != ERR_OK && connection != NULL && connection->pcb == new_conn)
+    {
+        connections_free (connection);
+    }
+
+    return ret;
+}
+
+static err_t
+connections_accept_0 (void * arg, struct altcp_pcb * new_conn, err_t err)
+{
+    return connections_accept (0, arg, new_conn, err);
+}
+
+static err_t
+connections_accept_1 (void * arg, struct altcp_pcb * new_conn, err_t err)
+{
+    return connections_accept (1, arg, new_conn, err);
+}
+
+static const altcp_accept_fn connections_accepts[CONNECTIONS_LISTENERS] =
+{
+    connections_accept_0,
+    connections_accept_1,
+};
+
+/*
+ * The listener wrapped on pcb, or with pcb NULL a free one.
+ */
+static connections_listener_t *
+connections_listener (struct altcp_pcb * pcb)
+{
+    int i;
+
+    for (i = 0 ; i < CONNECTIONS_LISTENERS ; i++)
+    {
+        if (listeners[i].pcb == pcb)
+        {
+            return &listeners[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * altcp_tls listens on a TCP pcb below the server's listener, and
+ * installs its own accept callback on it from altcp_listen, before
+ * the server installs its callback on the TLS listener. Once that
+ * happens, the TCP listener gets its callback back: only the
+ * connections the server sees are tracked.
+ */
+void
+__wrap_altcp_accept (struct altcp_pcb * conn, altcp_accept_fn accept)
+{
+    connections_listener_t * listener;
+
+    if (conn == NULL)
+    {
+        __real_altcp_accept (conn, accept);
+        return;
+    }
+
+    if (conn->inner_conn != NULL &&
+        (listener = connections_listener (conn->inner_conn)) != NULL)
+    {
+        __real_altcp_accept (listener->pcb, listener->accept);
+        listener->pcb = NULL;
+    }
+
+    listener = connections_listener (conn);
+
+    if (listener == NULL && accept != NULL)
+    {
+        listener = connections_listener (NULL);
+    }
+
+    /* out of listeners: passed through, and not tracked */
+    if (listener == NULL)
+    {
+        __real_altcp_accept (conn, accept);
+        return;
+    }
+
+    if (accept == NULL)
+    {
+        listener->pcb = NULL;
+        __real_altcp_accept (conn, NULL);
+        return;
+    }
+
+    listener->pcb = conn;
+    listener->accept = accept;
+    __real_altcp_accept (conn, connections_accepts[listener - listeners]);
+}
+
+/*
+ * altcp_tls installs its own callbacks on the TCP connections below
+ * it; those are not tracked, and are passed through unchanged.
+ */
+void
+__wrap_altcp_recv (struct altcp_pcb * conn, altcp_recv_fn recv)
+{
+    connection_t * connection;
+
+    connection = connections_lookup (conn);
+
+    if (recv == NULL || connection == NULL)
+    {
+        __real_altcp_recv (conn, recv);
+        return;
+    }
+
+    connection->recv = recv;
+    evicted_recv = recv;
+    __real_altcp_recv (conn, connections_recv);
+}
+
+err_t
+__wrap_altcp_write (struct altcp_pcb * conn, const void * dataptr,
+                    u16_t len, u8_t apiflags)
+{
+    connection_t * connection;
+    err_t err;
+
+    err = __real_altcp_write (conn, dataptr, len, apiflags);
+
+    if (err == ERR_OK && (connection = connections_lookup (conn)) != NULL)
+    {
+        connection->bytes_sent += len;
+        connection->active_ms = connections_now ();
+        connections.bytes_sent += len;
+    }
+
+    return err;
+}
+
+err_t
+__wrap_altcp_close (struct altcp_pcb * conn)
+{
+    connection_t * connection;
+    err_t err;
+
+    connection = connections_lookup (conn);
+    err = __real_altcp_close (conn);
+
+    if (err == ERR_OK && connection != NULL)
+    {
+        connections_free (connection);
+    }
+
+    return err;
+}
+
+void
+__wrap_altcp_abort (struct altcp_pcb * conn)
+{
+    connection_t * connection;
+
+    connection = connections_lookup (conn);
+
+    if (connection != NULL)
+    {
+        connections_free (connection);
+    }
+
+    __real_altcp_abort (conn);
+}
+
+int
+connections_render (char * buffer, size_t len)
+{
+    connection_t * connection;
+    uint32_t now;
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+    bool first = true;
+    int i;
+
+    now = connections_now ();
+
+    render_printf (&render,
+                   "{\"accepted\":%lu,\"closed\":%lu,\"evicted\":%lu,"
+                   "\"bytes_sent\":%llu,\"requests\":%lu,"
+                   "\"handshake_ms_avg\":%lu,\"open\":[",
+                   (unsigned long) connections.accepted,
+                   (unsigned long) connections.closed,
+                   (unsigned long) connections.evicted,
+                   (unsigned long long) connections.bytes_sent,
+                   (unsigned long) connections.requests,
+                   (unsigned long) (connections.handshakes == 0 ? 0 :
+                       connections.handshake_ms_total /
+                       connections.handshakes));
+
+    for (i = 0 ; i < CONNECTIONS_MAX ; i++)
+    {
+        connection = &connections.connections[i];
+
+        if (connection->pcb == NULL)
+        {
+            continue;
+        }
+
+        render_printf (&render,
+                       "%s{\"age_ms\":%lu,\"idle_ms\":%lu,"
+                       "\"handshake_ms\":%ld,\"bytes_sent\":%lu,"
+                       "\"requests\":%lu}",
+                       first ? "" : ",",
+                       (unsigned long) (now - connection->opened_ms),
+                       (unsigned long) (now - connection->active_ms),
+                       (long) connection->handshake_ms,
+                       (unsigned long) connection->bytes_sent,
+                       (unsigned long) connection->requests);
+        first = false;
+    }
+
+    render_printf (&render, "]}");
+
+    return render_finish (&render);
+}
@@ -0,0 +1,72 @@
+#ifndef _connections_h_
+#define _connections_h_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lwip/altcp.h"
+
+/*
+ * Per-connection metrics for the HTTP server.
+ *
+ * picow-http drives its connections through the lwIP altcp API, so the
+ * calls it makes (altcp_accept, altcp_recv, altcp_write, altcp_close,
+ * altcp_abort) are wrapped at link time, see CMakeLists.txt. A
+ * connection is tracked from accept until close:
+ *
+ * - handshake_ms: from accept to the first request byte. With TLS this
+ *   is dominated by the handshake, since altcp_tls only passes data up
+ *   once the handshake is done.
+ * - bytes_sent: response bytes written by the server (before TLS
+ *   encryption).
+ * - requests: request headers received (counted by their final empty
+ *   line).
+ *
+ * Connections that lwIP drops on an error are not closed through
+ * altcp_close; their slot is reclaimed when a new connection needs it
+ * ("evicted"), or when lwIP hands out the same pcb again.
+ *
+ * The callbacks the server installs are kept per listener and per
+ * connection. With TLS, the TCP listener and connections below
+ * altcp_tls keep altcp_tls's own callbacks, and are not tracked.
+ */
+
+#define CONNECTIONS_MAX 8
+
+typedef struct _connection_t connection_t;
+
+struct _connection_t
+{
+    void * pcb;
+    uint32_t opened_ms;
+    uint32_t active_ms;
+    int32_t handshake_ms;
+    uint32_t bytes_sent;
+    uint32_t requests;
+    int eoh;
+    altcp_recv_fn recv;
+};
+
+typedef struct _connections_t connections_t;
+
+struct _connections_t
+{
+    connection_t connections[CONNECTIONS_MAX];
+
+    uint32_t accepted;
+    uint32_t closed;
+    uint32_t evicted;
+    uint64_t bytes_sent;
+    uint32_t requests;
+    uint32_t handshake_ms_total;
+    uint32_t handshakes;
+};
+
+/*
+ * Render the counters and the open connections as a JSON object.
+ * Returns the length, or -1 if it did not fit in len bytes.
+ */
+int connections_render (char * buffer, size_t len);
+
+#endif /* _connections_h_ */
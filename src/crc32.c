@@ -0,0 +1,25 @@
+#include "crc32.h"
+
+/* bitwise: the records that are checked are small and rarely written */
+uint32_t
+crc32 (const void * data, size_t len)
+{
+    const uint8_t * bytes;
+    uint32_t crc = 0xffffffff;
+    size_t i;
+    int j;
+
+    bytes = (const uint8_t *) data;
+
+    for (i = 0 ; i < len ; i++)
+    {
+        crc ^= bytes[i];
+
+        for (j = 0 ; j < 8 ; j++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,10 @@
+#ifndef _crc32_h_
+#define _crc32_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32 (IEEE 802.3), as used by zlib */
+uint32_t crc32 (const void * data, size_t len);
+
+#endif /* _crc32_h_ */
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "event_log.h"
+#include "log_ring.h"
+
+static uint8_t event_log_page[FLASH_PAGE_SIZE];
+
+static uint32_t
+event_log_sector_offset (event_log_t * event_log, int sector)
+{
+    return event_log->offset + sector * FLASH_SECTOR_SIZE;
+}
+
+static const event_log_header_t *
+event_log_header (event_log_t * event_log, int sector)
+{
+    return (const event_log_header_t *)
+        flash_store_data (event_log_sector_offset (event_log, sector));
+}
+
+static const event_log_record_t *
+event_log_record (event_log_t * event_log, int sector, int slot)
+{
+    return (const event_log_record_t *)
+        flash_store_data (event_log_sector_offset (event_log, sector) +
+                          sizeof (event_log_header_t) +
+                          slot * sizeof (event_log_record_t));
+}
+
+static bool
+event_log_header_valid (const event_log_header_t * header)
+{
+    return header->magic == EVENT_LOG_MAGIC &&
+           header->crc == crc32 (header, offsetof (event_log_header_t, crc));
+}
+
+static bool
+event_log_record_valid (const event_log_record_t * record)
+{
+    return record->crc == crc32 (record, offsetof (event_log_record_t, crc));
+}
+
+static bool
+event_log_record_free (const event_log_record_t * record)
+{
+    const uint8_t * bytes;
+    size_t i;
+
+    bytes = (const uint8_t *) record;
+
+    for (i = 0 ; i < sizeof (event_log_record_t) ; i++)
+    {
+        if (bytes[i] != 0xff)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Program len bytes at offset, that must not cross a page boundary,
+ * leaving the rest of the page as it is.
+ */
+static int
+event_log_program (uint32_t offset, const void * data, size_t len)
+{
+    uint32_t page;
+
+    page = offset - offset % FLASH_PAGE_SIZE;
+
+    memset (event_log_page, 0xff, sizeof (event_log_page));
+    memcpy (&event_log_page[offset - page], data, len);
+
+    return flash_store_program (page, event_log_page, FLASH_PAGE_SIZE);
+}
+
+/* erase the sector and make it the head */
+static int
+event_log_start_sector (event_log_t * event_log, int sector,
+                        uint32_t sequence)
+{
+    event_log_header_t header;
+
+    if (flash_store_erase (event_log_sector_offset (event_log, sector),
+                           FLASH_SECTOR_SIZE) != 0)
+    {
+        return -1;
+    }
+
+    event_log->erased++;
+
+    header.magic = EVENT_LOG_MAGIC;
+    header.sequence = sequence;
+    header.reserved = 0xffffffff;
+    header.crc = crc32 (&header, offsetof (event_log_header_t, crc));
+
+    if (event_log_program (event_log_sector_offset (event_log, sector),
+                           &header, sizeof (header)) != 0)
+    {
+        return -1;
+    }
+
+    event_log->head = sector;
+    event_log->head_sequence = sequence;
+    event_log->slot = 0;
+
+    return 0;
+}
+
+/*
+ * The sectors of the ring from the oldest to the head are those with a
+ * valid header whose sequence is within sectors - 1 of the head's.
+ */
+static bool
+event_log_sector_in_ring (event_log_t * event_log, int sector)
+{
+    const event_log_header_t * header;
+
+    header = event_log_header (event_log, sector);
+
+    return event_log_header_valid (header) &&
+           event_log->head_sequence - header->sequence <
+               (uint32_t) event_log->sectors;
+}
+
+/* Remember the newest records, for event_log_sync() after a boot. */
+static void
+event_log_load_seen (event_log_t * event_log)
+{
+    const event_log_record_t * record;
+    int sector;
+    int slot;
+    int i;
+
+    event_log->seen_count = 0;
+    sector = event_log->head;
+
+    for (i = 0 ; i < event_log->sectors ; i++)
+    {
+        if (!event_log_sector_in_ring (event_log, sector))
+        {
+            break;
+        }
+
+        slot = (sector == event_log->head) ?
+            event_log->slot : (int) EVENT_LOG_RECORDS;
+
+        while (--slot >= 0)
+        {
+            record = event_log_record (event_log, sector, slot);
+
+            if (!event_log_record_valid (record))
+            {
+                continue;
+            }
+
+            memcpy (event_log->seen[event_log->seen_count], record->raw,
+                    BENTEL_EVENT_SIZE);
+
+            if (++event_log->seen_count == BENTEL_LOGGER_EVENTS)
+            {
+                return;
+            }
+        }
+
+        sector = (sector + event_log->sectors - 1) % event_log->sectors;
+    }
+}
+
+/* the sequence number after the newest valid record in the sector */
+static uint32_t
+event_log_next_seq (event_log_t * event_log, int sector, int slots)
+{
+    const event_log_record_t * record;
+
+    while (--slots >= 0)
+    {
+        record = event_log_record (event_log, sector, slots);
+
+        if (event_log_record_valid (record))
+        {
+            return record->seq + 1;
+        }
+    }
+
+    return 0;
+}
+
+int
+event_log_start (void * layer)
+{
+    event_log_t * event_log;
+    const event_log_header_t * header;
+    bool found = false;
+    int previous;
+    int i;
+
+    event_log = (event_log_t *) layer;
+
+    sem_init (&event_log->semaphore, 1, 1);
+
+    event_log->appended = 0;
+    event_log->erased = 0;
+    event_log->errors = 0;
+    event_log->seen_count = 0;
+    event_log->next_seq = 1;
+
+    for (i = 0 ; i < event_log->sectors ; i++)
+    {
+        header = event_log_header (event_log, i);
+
+        if (!event_log_header_valid (header))
+        {
+            continue;
+        }
+
+        if (!found || (int32_t) (header->sequence - event_log->head_sequence) > 0)
+        {
+            event_log->head = i;
+            event_log->head_sequence = header->sequence;
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        LOG_RING_INFO ("event_log_start: formatting %d sectors",
+                       event_log->sectors);
+
+        return event_log_start_sector (event_log, 0, 1);
+    }
+
+    /* the first slot that was never programmed */
+    for (event_log->slot = 0 ;
+         event_log->slot < (int) EVENT_LOG_RECORDS ;
+         event_log->slot++)
+    {
+        if (event_log_record_free (event_log_record (event_log,
+                                                     event_log->head,
+                                                     event_log->slot)))
+        {
+            break;
+        }
+    }
+
+    event_log->next_seq = event_log_next_seq (event_log, event_log->head,
+                                              event_log->slot);
+
+    /* the head was started, but nothing appended to it yet */
+    previous = (event_log->head + event_log->sectors - 1) % event_log->sectors;
+
+    if (event_log->next_seq == 0 && event_log->sectors > 1 &&
+        event_log_sector_in_ring (event_log, previous))
+    {
+        event_log->next_seq = event_log_next_seq (event_log, previous,
+                                                  EVENT_LOG_RECORDS);
+    }
+
+    if (event_log->next_seq == 0)
+    {
+        event_log->next_seq = 1;
+    }
+
+    event_log_load_seen (event_log);
+
+    LOG_RING_INFO ("event_log_start: head %d slot %d next %lu",
+                   event_log->head, event_log->slot,
+                   (unsigned long) event_log->next_seq);
+
+    return 0;
+}
+
+void
+event_log_stop (void * layer)
+{
+    (void) layer;
+}
+
+int
+event_log_append (event_log_t * event_log, const uint8_t * raw)
+{
+    event_log_record_t record;
+    uint32_t offset;
+    int ret = 0;
+
+    sem_acquire_blocking (&event_log->semaphore);
+
+    if (event_log->slot == (int) EVENT_LOG_RECORDS &&
+        event_log_start_sector (event_log,
+                                (event_log->head + 1) % event_log->sectors,
+                                event_log->head_sequence + 1) != 0)
+    {
+        event_log->errors++;
+        sem_release (&event_log->semaphore);
+        return -1;
+    }
+
+    record.seq = event_log->next_seq;
+    memcpy (record.raw, raw, BENTEL_EVENT_SIZE);
+    record.reserved = 0xff;
+    record.crc = crc32 (&record, offsetof (event_log_record_t, crc));
+
+    offset = event_log_sector_offset (event_log, event_log->head) +
+             sizeof (event_log_header_t) +
+             event_log->slot * sizeof (event_log_record_t);
+
+    /* the slot is used even if programming failed half way */
+    event_log->slot++;
+
+    if (event_log_program (offset, &record, sizeof (record)) != 0)
+    {
+        event_log->errors++;
+        ret = -1;
+    }
+    else
+    {
+        event_log->next_seq++;
+        event_log->appended++;
+    }
+
+    sem_release (&event_log->semaphore);
+
+    return ret;
+}
+
+static bool
+event_log_seen (event_log_t * event_log, const uint8_t * raw)
+{
+    int i;
+
+    for (i = 0 ; i < event_log->seen_count ; i++)
+    {
+        if (memcmp (event_log->seen[i], raw, BENTEL_EVENT_SIZE) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * The position of the newest event in the panel logger is not known,
+ * so new events are found by content: an event is new if it was not
+ * in the logger at the previous sync. Events are appended in logger
+ * order; their own timestamps give the order in which they happened.
+ */
+int
+event_log_sync (event_log_t * event_log, const uint8_t * logger)
+{
+    static uint8_t current[BENTEL_LOGGER_EVENTS][BENTEL_EVENT_SIZE];
+    bentel_event_t event;
+    const uint8_t * raw;
+    int appended = 0;
+    int count = 0;
+    int i;
+
+    for (i = 0 ; i < BENTEL_LOGGER_EVENTS ; i++)
+    {
+        raw = &logger[i * BENTEL_EVENT_SIZE];
+
+        if (bentel_event_decode (raw, &event) != 0)
+        {
+            continue;
+        }
+
+        memcpy (current[count++], raw, BENTEL_EVENT_SIZE);
+
+        if (event_log_seen (event_log, raw))
+        {
+            continue;
+        }
+
+        if (event_log_append (event_log, raw) == 0)
+        {
+            appended++;
+        }
+    }
+
+    memcpy (event_log->seen, current, sizeof (current));
+    event_log->seen_count = count;
+
+    return appended;
+}
+
+int
+event_log_read (event_log_t * event_log, uint32_t since,
+                event_log_record_t * records, int max)
+{
+    const event_log_record_t * record;
+    int sector;
+    int slots;
+    int count = 0;
+    int slot;
+    int i;
+
+    sem_acquire_blocking (&event_log->semaphore);
+
+    /* oldest sector first */
+    for (i = event_log->sectors - 1 ; i >= 0 && count < max ; i--)
+    {
+        sector = (event_log->head + event_log->sectors - i) % event_log->sectors;
+
+        if (!event_log_sector_in_ring (event_log, sector))
+        {
+            continue;
+        }
+
+        slots = (sector == event_log->head) ?
+            event_log->slot : (int) EVENT_LOG_RECORDS;
+
+        /* the whole sector is older than since */
+        if (slots > 0 &&
+            event_log_record_valid (event_log_record (event_log, sector,
+                                                      slots - 1)) &&
+            event_log_record (event_log, sector, slots - 1)->seq <= since)
+        {
+            continue;
+        }
+
+        for (slot = 0 ; slot < slots && count < max ; slot++)
+        {
+            record = event_log_record (event_log, sector, slot);
+
+            if (event_log_record_valid (record) && record->seq > since)
+            {
+                records[count++] = *record;
+            }
+        }
+    }
+
+    sem_release (&event_log->semaphore);
+
+    return count;
+}
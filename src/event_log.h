@@ -0,0 +1,106 @@
+#ifndef _event_log_h_
+#define _event_log_h_
+
+#include <pico/sem.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bentel_layer.h"
+#include "flash_store.h"
+
+/*
+ * Panel event history, kept in a log-structured ring of flash sectors.
+ *
+ * Each sector starts with a header carrying a sequence number, that is
+ * incremented every time a sector is (re)started; records are appended
+ * to the newest sector (the head), and when it is full the oldest
+ * sector is erased and becomes the new head. So every sector is erased
+ * once per lap of the ring, and at boot the head is found by reading
+ * the sector headers only.
+ *
+ * Records are programmed one at a time, from a page buffer that is
+ * 0xff everywhere but the record, so that a page can be programmed
+ * again for the next record. A record that was torn by a reset fails
+ * its CRC and is skipped.
+ */
+
+#define EVENT_LOG_MAGIC 0x31474c45 /* "ELG1" */
+
+typedef struct _event_log_record_t event_log_record_t;
+
+struct _event_log_record_t
+{
+    uint32_t seq;
+    uint8_t raw[BENTEL_EVENT_SIZE];
+    uint8_t reserved;
+    /** @brief CRC-32 of seq, raw and reserved */
+    uint32_t crc;
+};
+
+typedef struct _event_log_header_t event_log_header_t;
+
+struct _event_log_header_t
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t reserved;
+    /** @brief CRC-32 of magic, sequence and reserved */
+    uint32_t crc;
+};
+
+#define EVENT_LOG_RECORDS \
+    ((FLASH_SECTOR_SIZE - sizeof (event_log_header_t)) / \
+     sizeof (event_log_record_t))
+
+typedef struct _event_log_t event_log_t;
+
+struct _event_log_t
+{
+    /** @brief flash offset and number of sectors of the ring */
+    uint32_t offset;
+    int sectors;
+
+    semaphore_t semaphore;
+
+    /** @brief sector being appended to, and its header sequence */
+    int head;
+    uint32_t head_sequence;
+    /** @brief next free record in the head sector */
+    int slot;
+    /** @brief sequence number of the next record */
+    uint32_t next_seq;
+
+    /**
+     * @brief the panel logger as it was at the last sync (or the newest
+     * records in flash after a boot), to tell new events from old ones
+     */
+    uint8_t seen[BENTEL_LOGGER_EVENTS][BENTEL_EVENT_SIZE];
+    int seen_count;
+
+    uint32_t appended;
+    uint32_t erased;
+    uint32_t errors;
+};
+
+/* Find the head, and remember the newest events. */
+int event_log_start (void * layer);
+
+void event_log_stop (void * layer);
+
+int event_log_append (event_log_t * event_log, const uint8_t * raw);
+
+/*
+ * Append the events of the panel logger mirror that are not in the
+ * log yet. Returns the number of events appended.
+ */
+int event_log_sync (event_log_t * event_log, const uint8_t * logger);
+
+/*
+ * Copy up to max records with a sequence number greater than since,
+ * oldest first. Returns the number of records copied.
+ */
+int event_log_read (event_log_t * event_log, uint32_t since,
+                    event_log_record_t * records, int max);
+
+#endif /* _event_log_h_ */
@@ -0,0 +1,100 @@
+#include <pico/flash.h>
+#include <hardware/flash.h>
+
+#include "flash_store.h"
+
+/* how long flash_safe_execute() may wait for the other core to park */
+#define FLASH_STORE_TIMEOUT_MS 100
+
+typedef struct _flash_store_operation_t flash_store_operation_t;
+
+struct _flash_store_operation_t
+{
+    uint32_t offset;
+    const void * data;
+    size_t len;
+};
+
+static void
+flash_store_do_erase (void * param)
+{
+    flash_store_operation_t * operation;
+
+    operation = (flash_store_operation_t *) param;
+
+    flash_range_erase (operation->offset, operation->len);
+}
+
+static void
+flash_store_do_program (void * param)
+{
+    flash_store_operation_t * operation;
+
+    operation = (flash_store_operation_t *) param;
+
+    flash_range_program (operation->offset, operation->data, operation->len);
+}
+
+int
+flash_store_start (void)
+{
+    return flash_safe_execute_core_init () ? 0 : -1;
+}
+
+const void *
+flash_store_data (uint32_t offset)
+{
+    return (const void *) (XIP_BASE + offset);
+}
+
+int
+flash_store_erase (uint32_t offset, size_t len)
+{
+    flash_store_operation_t operation =
+    {
+        .offset = offset,
+        .data = NULL,
+        .len = len,
+    };
+
+    if (offset % FLASH_SECTOR_SIZE != 0 || len % FLASH_SECTOR_SIZE != 0)
+    {
+        return -1;
+    }
+
+    if (flash_safe_execute (flash_store_do_erase, &operation,
+                            FLASH_STORE_TIMEOUT_MS) != PICO_OK)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * data must not be in flash: the flash is not readable while it is
+ * being programmed.
+ */
+int
+flash_store_program (uint32_t offset, const void * data, size_t len)
+{
+    flash_store_operation_t operation =
+    {
+        .offset = offset,
+        .data = data,
+        .len = len,
+    };
+
+    if (offset % FLASH_PAGE_SIZE != 0 || len % FLASH_PAGE_SIZE != 0)
+    {
+        return -1;
+    }
+
+    if (flash_safe_execute (flash_store_do_program, &operation,
+                            FLASH_STORE_TIMEOUT_MS) != PICO_OK)
+    {
+        return -1;
+    }
+
+    return 0;
+}
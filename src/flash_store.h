@@ -0,0 +1,44 @@
+#ifndef _flash_store_h_
+#define _flash_store_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hardware/flash.h>
+
+/*
+ * Persistent storage in the last sectors of the flash, well above the
+ * program image. Offsets are relative to the start of the flash, and
+ * erase and program operations work on whole sectors and pages, as for
+ * hardware/flash.h.
+ */
+
+/*
+ * identity cache: model, firmware version and names, see
+ * identity_cache.h. One sector per panel, panel 0 in the last one.
+ */
+#define FLASH_STORE_IDENTITY_SECTORS 4
+#define FLASH_STORE_IDENTITY_OFFSET(panel) \
+    (PICO_FLASH_SIZE_BYTES - ((panel) + 1) * FLASH_SECTOR_SIZE)
+
+/* event history ring, see event_log.h */
+#define FLASH_STORE_EVENTS_SECTORS 32
+#define FLASH_STORE_EVENTS_OFFSET \
+    (PICO_FLASH_SIZE_BYTES - \
+     (FLASH_STORE_IDENTITY_SECTORS + FLASH_STORE_EVENTS_SECTORS) * \
+     FLASH_SECTOR_SIZE)
+
+/*
+ * Must be called on core0 before core1 is launched: core1 erases and
+ * programs the flash, and core0 has to be parked while it does.
+ */
+int flash_store_start (void);
+
+/* Memory mapped (XIP) contents of the flash at offset */
+const void * flash_store_data (uint32_t offset);
+
+int flash_store_erase (uint32_t offset, size_t len);
+
+int flash_store_program (uint32_t offset, const void * data, size_t len);
+
+#endif /* _flash_store_h_ */
@@ -10,9 +10,16 @@
  * See: https://gitlab.com/slimhazard/picow_http/-/wikis/Custom-Handlers
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "pico/cyw43_arch.h"
 
 #include "pico/bootrom.h"
+#include "pico/rand.h"
+
+/* For MEMP_MAX */
+#include "lwip/memp.h"
 
 /*
  * Include picow_http/http.h for picow-http's public API.
@@ -22,12 +29,93 @@
 
 #include "handlers.h"
 
-#include "configuration.h"
-#include "state_machine.h"
+#include "panel.h"
+#include "render.h"
+#include "connections.h"
+#include "event_log.h"
+#include "capture.h"
+#include "perf.h"
+#include "trace.h"
+#include "ram_stats.h"
+#include "log_ring.h"
+#if PICOW_HTTPS
+#include "tls_stats.h"
+#endif
 
 /* Size of the largest string that could result from format_decimal(). */
 #define MAX_INT_LEN (STRLEN_LTRL("−2147483648"))
 
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+/*
+ * Keep-alive policy per class of endpoint.
+ *
+ * Endpoints that clients call repeatedly (the web app polls /delta,
+ * Home Assistant polls /ha) ask the client to keep the connection open
+ * for as long as the server's idle timeout, so that every poll re-uses
+ * it; with TLS this saves a handshake per request. Endpoints that a
+ * client calls once, or only on a user action, ask the client to close
+ * the connection right away, so that it does not hold one of the few
+ * PCBs until the idle timeout expires.
+ */
+enum conn_class {
+    CONN_POLL,
+    CONN_ONE_SHOT,
+};
+
+static err_t
+set_conn_policy(struct resp *resp, enum conn_class class)
+{
+    if (class == CONN_ONE_SHOT)
+        return http_resp_set_hdr_ltrl(resp, "Connection", "close");
+    return http_resp_set_hdr_ltrl(resp, "Keep-Alive",
+                                  "timeout=" XSTR(POLL_IDLE_TMO_S));
+}
+
+#define QUERY_UINT_MAX_LEN (STRLEN_LTRL("4294967295"))
+
+/*
+ * Set *val to the value of the numeric query parameter name, and leave
+ * it alone if the parameter is absent. Returns false if the value is
+ * empty or too long.
+ */
+static bool
+query_uint(struct req *req, const char *name, size_t name_len,
+           uint32_t *val)
+{
+    const char *query, *v;
+    size_t query_len, v_len;
+    char str[QUERY_UINT_MAX_LEN + 1];
+
+    if ((query = http_req_query(req, &query_len)) == NULL)
+        return true;
+    if ((v = http_req_query_val(query, query_len, name, name_len, &v_len))
+        == NULL)
+        return true;
+    if (v_len == 0 || v_len > QUERY_UINT_MAX_LEN)
+        return false;
+    memcpy(str, v, v_len);
+    str[v_len] = '\0';
+    *val = strtoul(str, NULL, 10);
+    return true;
+}
+
+/*
+ * The panel that a request is for, from the query parameter panel=<n>
+ * (panel 0 without it), or NULL if there is no such panel.
+ */
+static panel_t *
+req_panel(struct req *req)
+{
+    uint32_t n = 0;
+
+    if (!query_uint(req, "panel", STRLEN_LTRL("panel"), &n)
+        || n >= (uint32_t)panel_count())
+        return NULL;
+    return panel_get(n);
+}
+
 /*
  * Custom handler for GET/HEAD /temp
  *
@@ -145,6 +233,11 @@ temp_handler(struct http *http, void *p)
         return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
 
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
     /*
      * Send the response using the body buffer as the response
      * body. Set the 'durable' parameter to false, because body is a
@@ -322,6 +415,11 @@ led_handler(struct http *http, void *p)
         return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
 
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
     /*
      * Use http_resp_send_buf() to send bit_str[idx] as the response
      * body. In this case, we set the 'durable' parameter to true,
@@ -420,6 +518,11 @@ rssi_handler(struct http *http, void *p)
         return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
 
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
     /*
      * As with the previous handlers, use http_resp_send_buf() to send
      * the response body. Set the 'durable' parameter to false, since
@@ -441,165 +544,13 @@ rssi_handler(struct http *http, void *p)
 
 #define HA_FMT \
     ("{\"ssid\":\"" WIFI_SSID "\",\"host\":\"" CYW43_HOST_NAME "\"," \
-     "\"ip\":\"%s\",\"mac\":\"%s\",\"state_machine\":\"%02d\"," \
-     "\"fw\":\"%d.%02d\",\"model\":\"%.8s\","\
-     "\"readers\":{"\
-         "\"0\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"1\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"2\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"3\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"4\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"5\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"6\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"7\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"8\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"9\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"10\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"11\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"12\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"13\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"14\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"15\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}}," \
-     "\"keyboards\":{"\
-         "\"0\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"1\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"2\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"3\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"4\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"5\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"6\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}," \
-         "\"7\":{\"present\":\"%1d\",\"sabotage\":\"%1d\",\"alive\":\"%1d\"}}," \
-     "\"zones\":{"\
-         "\"0\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"1\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"2\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"3\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"4\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"5\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"6\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"7\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"8\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"9\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"10\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"11\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"12\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"13\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"14\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"15\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"16\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"17\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"18\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"19\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"20\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"21\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"22\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"23\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"24\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"25\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"26\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"27\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"28\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"29\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"30\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}," \
-         "\"31\":{\"name\":\"%.16s\",\"sabotage\":\"%1d\",\"alarm\":\"%1d\",\"included\":\"%1d\",\"alarm_memory\":\"%1d\",\"sabotage_memory\":\"%1d\"}}," \
-     "\"partitions\":{"\
-         "\"0\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"1\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"2\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"3\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"4\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"5\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"6\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}," \
-         "\"7\":{\"name\":\"%.16s\",\"alarm\":\"%1d\",armed\":\"%1d\"}}," \
-     "\"alarm_power\":\"%1d\",\"alarm_bpi\":\"%1d\", \"alarm_fuse\":\"%1d\"," \
-     "\"alarm_battery_low\":\"%1d\",\"alarm_telephone_line\":\"%1d\"," \
-     "\"alarm_default_codes\":\"%1d\",\"alarm_wireless\":\"%1d\"," \
-     "\"sabotage_partition\":\"%1d\",\"sabotage_fake_key\":\"%1d\"," \
-     "\"sabotage_bpi\":\"%1d\",\"sabotage_system\":\"%1d\"," \
-     "\"sabotage_jam\":\"%1d\",\"sabotage_wireless\":\"%1d\"" \
-     "\"siren_state\":\"%1d\"" \
-     "}")
-#define HA_STR \
-    ("{\"ssid\":\"" WIFI_SSID "\",\"host\":\"" CYW43_HOST_NAME "\"," \
-     "\"ip\":\"\",\"mac\":\"\",\"state_machine\":\"\"," \
-     "\"fw\":\"\",\"model\":\"\"" \
-     "\"readers\":{"\
-         "\"0\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"1\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"2\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"3\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"4\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"5\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"6\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"7\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"8\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"9\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"10\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"11\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"12\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"13\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"14\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"15\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}}," \
-     "\"keyboards\":{"\
-         "\"0\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"1\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"2\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"3\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"4\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"5\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"6\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}," \
-         "\"7\":{\"present\":\"\",\"sabotage\":\"\",\"alive\":\"\"}}," \
-     "\"zones\":{"\
-         "\"0\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}" \
-         "\"1\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"2\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"3\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"4\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"5\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"6\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"7\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"8\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"9\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"10\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"11\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"12\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"13\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"14\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"15\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"16\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"17\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"18\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"19\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"20\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"21\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"22\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"23\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"24\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"25\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"26\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"27\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"28\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"29\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"30\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}," \
-         "\"31\":{\"name\":\"\",\"sabotage\":\"\",\"alarm\":\"\",\"included\":\"\",\"alarm_memory\":\"\",\"sabotage_memory\":\"\"}}," \
-     "\"partitions\":{"\
-         "\"0\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"1\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"2\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"3\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"4\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"5\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"6\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}," \
-         "\"7\":{\"name\":\"\",\"alarm\":\"\",armed\":\"\"}}," \
-     "\"alarm_power\":\"\",\"alarm_bpi\":\"\", \"alarm_fuse\":\"\"," \
-     "\"alarm_battery_low\":\"\",\"alarm_telephone_line\":\"\"," \
-     "\"alarm_default_codes\":\"\",\"alarm_wireless\":\"\"," \
-     "\"sabotage_partition\":\"\",\"sabotage_fake_key\":\"\"," \
-     "\"sabotage_bpi\":\"\",\"sabotage_system\":\"\"," \
-     "\"sabotage_jam\":\"\",\"sabotage_wireless\":\"\"" \
-     "\"siren_state\":\"\"" \
-     "}")
-#define HA_MAX_LEN (STRLEN_LTRL(HA_STR) + IPADDR_STRLEN_MAX + MAC_ADDR_LEN) + 2 /* state machine */ + 4 /* fw */ + 8 /* model */ + (24*3) /* readers and keyboards */ + (32*21) /* zones */ + (8*18) /* partitions */ + 7 /* alarms */ + 6 /* sabotages */ + 1 /* siren */
+     "\"ip\":\"%s\",\"mac\":\"%s\",\"state_machine\":\"%02d\",")
+
+/*
+ * Room for the KYO32 capacity: about 160 bytes per zone with an
+ * escaped name, 90 per partition, 70 per reader and keyboard.
+ */
+#define HA_MAX_LEN (8 * 1024)
 
 /* The next handler will set an ETag header with a 32-bit value in hex. */
 #define ETAG_LEN (sizeof("\"12345678\""))
@@ -713,6 +664,11 @@ netinfo_handler(struct http *http, void *p)
         return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
 
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
     /*
      * If the request has an If-None-Match header, and its value is
      * equal to the hash string computed for the ETag, send a response
@@ -798,11 +754,11 @@ ha_handler(struct http *http, void *p)
     struct resp *resp = http_resp(http);
     struct netinfo *info;
     static char etag[ETAG_LEN] = { '\0' };
-    char body[HA_MAX_LEN];
-    size_t body_len;
+    /* Static for the size, as for /delta. */
+    static char body[HA_MAX_LEN];
+    int body_len, ha_len;
+    panel_t *panel;
     err_t err;
-    extern state_machine_t state_machine;
-    extern configuration_t configuration;
 
     /*
      * Cast the private data pointer to a pointer to an object of type
@@ -817,6 +773,10 @@ ha_handler(struct http *http, void *p)
      */
     CAST_OBJ_NOTNULL(info, p, NETINFO_MAGIC);
 
+    /* /ha?panel=<n> for any panel but the first */
+    if ((panel = req_panel(req)) == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+
     /* Initialize the ETag string. */
     if (etag[0] == '\0')
         set_etag(etag, info);
@@ -856,6 +816,11 @@ ha_handler(struct http *http, void *p)
         return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
 
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
     /*
      * If the request has an If-None-Match header, and its value is
      * equal to the hash string computed for the ETag, send a response
@@ -897,319 +862,26 @@ ha_handler(struct http *http, void *p)
      * response body with status 200. The code for sending a JSON
      * response is similar to the code above for the rssi handler.
      *
-     * Format the response body in the body array, and use the return
-     * value from snprintf() for the body length.
+     * The network information is formatted here, the panel state by
+     * render_ha(), which only covers the zones and partitions that
+     * the panel model has.
      */
-    sem_acquire_blocking (&configuration.semaphore);
-
-    body_len = snprintf (body, HA_MAX_LEN, HA_FMT, info->ip, info->mac,
-                         state_machine.state,
-                         configuration.fw_major, configuration.fw_minor,
-                         configuration.model,
-                         configuration.readers[0].present,
-                         configuration.readers[0].sabotage,
-                         configuration.readers[0].alive,
-                         configuration.readers[1].present,
-                         configuration.readers[1].sabotage,
-                         configuration.readers[1].alive,
-                         configuration.readers[2].present,
-                         configuration.readers[2].sabotage,
-                         configuration.readers[2].alive,
-                         configuration.readers[3].present,
-                         configuration.readers[3].sabotage,
-                         configuration.readers[3].alive,
-                         configuration.readers[4].present,
-                         configuration.readers[4].sabotage,
-                         configuration.readers[4].alive,
-                         configuration.readers[5].present,
-                         configuration.readers[5].sabotage,
-                         configuration.readers[5].alive,
-                         configuration.readers[6].present,
-                         configuration.readers[6].sabotage,
-                         configuration.readers[6].alive,
-                         configuration.readers[7].present,
-                         configuration.readers[7].sabotage,
-                         configuration.readers[7].alive,
-                         configuration.readers[8].present,
-                         configuration.readers[8].sabotage,
-                         configuration.readers[8].alive,
-                         configuration.readers[9].present,
-                         configuration.readers[9].sabotage,
-                         configuration.readers[9].alive,
-                         configuration.readers[10].present,
-                         configuration.readers[10].sabotage,
-                         configuration.readers[10].alive,
-                         configuration.readers[11].present,
-                         configuration.readers[11].sabotage,
-                         configuration.readers[11].alive,
-                         configuration.readers[12].present,
-                         configuration.readers[12].sabotage,
-                         configuration.readers[12].alive,
-                         configuration.readers[13].present,
-                         configuration.readers[13].sabotage,
-                         configuration.readers[13].alive,
-                         configuration.readers[14].present,
-                         configuration.readers[14].sabotage,
-                         configuration.readers[14].alive,
-                         configuration.readers[15].present,
-                         configuration.readers[15].sabotage,
-                         configuration.readers[15].alive,
-                         configuration.keyboards[0].present,
-                         configuration.keyboards[0].sabotage,
-                         configuration.keyboards[0].alive,
-                         configuration.keyboards[1].present,
-                         configuration.keyboards[1].sabotage,
-                         configuration.keyboards[1].alive,
-                         configuration.keyboards[2].present,
-                         configuration.keyboards[2].sabotage,
-                         configuration.keyboards[2].alive,
-                         configuration.keyboards[3].present,
-                         configuration.keyboards[3].sabotage,
-                         configuration.keyboards[3].alive,
-                         configuration.keyboards[4].present,
-                         configuration.keyboards[4].sabotage,
-                         configuration.keyboards[4].alive,
-                         configuration.keyboards[5].present,
-                         configuration.keyboards[5].sabotage,
-                         configuration.keyboards[5].alive,
-                         configuration.keyboards[6].present,
-                         configuration.keyboards[6].sabotage,
-                         configuration.keyboards[6].alive,
-                         configuration.keyboards[7].present,
-                         configuration.keyboards[7].sabotage,
-                         configuration.keyboards[7].alive,
-                         configuration.zones[0].name,
-                         configuration.zones[0].sabotage,
-                         configuration.zones[0].alarm,
-                         configuration.zones[0].inclusion,
-                         configuration.zones[0].alarm_memory,
-                         configuration.zones[0].sabotage_memory,
-                         configuration.zones[1].name,
-                         configuration.zones[1].sabotage,
-                         configuration.zones[1].alarm,
-                         configuration.zones[1].inclusion,
-                         configuration.zones[1].alarm_memory,
-                         configuration.zones[1].sabotage_memory,
-                         configuration.zones[2].name,
-                         configuration.zones[2].sabotage,
-                         configuration.zones[2].alarm,
-                         configuration.zones[2].inclusion,
-                         configuration.zones[2].alarm_memory,
-                         configuration.zones[2].sabotage_memory,
-                         configuration.zones[3].name,
-                         configuration.zones[3].sabotage,
-                         configuration.zones[3].alarm,
-                         configuration.zones[3].inclusion,
-                         configuration.zones[3].alarm_memory,
-                         configuration.zones[3].sabotage_memory,
-                         configuration.zones[4].name,
-                         configuration.zones[4].sabotage,
-                         configuration.zones[4].alarm,
-                         configuration.zones[4].inclusion,
-                         configuration.zones[4].alarm_memory,
-                         configuration.zones[4].sabotage_memory,
-                         configuration.zones[5].name,
-                         configuration.zones[5].sabotage,
-                         configuration.zones[5].alarm,
-                         configuration.zones[5].inclusion,
-                         configuration.zones[5].alarm_memory,
-                         configuration.zones[5].sabotage_memory,
-                         configuration.zones[6].name,
-                         configuration.zones[6].sabotage,
-                         configuration.zones[6].alarm,
-                         configuration.zones[6].inclusion,
-                         configuration.zones[6].alarm_memory,
-                         configuration.zones[6].sabotage_memory,
-                         configuration.zones[7].name,
-                         configuration.zones[7].sabotage,
-                         configuration.zones[7].alarm,
-                         configuration.zones[7].inclusion,
-                         configuration.zones[7].alarm_memory,
-                         configuration.zones[7].sabotage_memory,
-                         configuration.zones[8].name,
-                         configuration.zones[8].sabotage,
-                         configuration.zones[8].alarm,
-                         configuration.zones[8].inclusion,
-                         configuration.zones[8].alarm_memory,
-                         configuration.zones[8].sabotage_memory,
-                         configuration.zones[9].name,
-                         configuration.zones[9].sabotage,
-                         configuration.zones[9].alarm,
-                         configuration.zones[9].inclusion,
-                         configuration.zones[9].alarm_memory,
-                         configuration.zones[9].sabotage_memory,
-                         configuration.zones[10].name,
-                         configuration.zones[10].sabotage,
-                         configuration.zones[10].alarm,
-                         configuration.zones[10].inclusion,
-                         configuration.zones[10].alarm_memory,
-                         configuration.zones[10].sabotage_memory,
-                         configuration.zones[11].name,
-                         configuration.zones[11].sabotage,
-                         configuration.zones[11].alarm,
-                         configuration.zones[11].inclusion,
-                         configuration.zones[11].alarm_memory,
-                         configuration.zones[11].sabotage_memory,
-                         configuration.zones[12].name,
-                         configuration.zones[12].sabotage,
-                         configuration.zones[12].alarm,
-                         configuration.zones[12].inclusion,
-                         configuration.zones[12].alarm_memory,
-                         configuration.zones[12].sabotage_memory,
-                         configuration.zones[13].name,
-                         configuration.zones[13].sabotage,
-                         configuration.zones[13].alarm,
-                         configuration.zones[13].inclusion,
-                         configuration.zones[13].alarm_memory,
-                         configuration.zones[13].sabotage_memory,
-                         configuration.zones[14].name,
-                         configuration.zones[14].sabotage,
-                         configuration.zones[14].alarm,
-                         configuration.zones[14].inclusion,
-                         configuration.zones[14].alarm_memory,
-                         configuration.zones[14].sabotage_memory,
-                         configuration.zones[15].name,
-                         configuration.zones[15].sabotage,
-                         configuration.zones[15].alarm,
-                         configuration.zones[15].inclusion,
-                         configuration.zones[15].alarm_memory,
-                         configuration.zones[15].sabotage_memory,
-                         configuration.zones[16].name,
-                         configuration.zones[16].sabotage,
-                         configuration.zones[16].alarm,
-                         configuration.zones[16].inclusion,
-                         configuration.zones[16].alarm_memory,
-                         configuration.zones[16].sabotage_memory,
-                         configuration.zones[17].name,
-                         configuration.zones[17].sabotage,
-                         configuration.zones[17].alarm,
-                         configuration.zones[17].inclusion,
-                         configuration.zones[17].alarm_memory,
-                         configuration.zones[17].sabotage_memory,
-                         configuration.zones[18].name,
-                         configuration.zones[18].sabotage,
-                         configuration.zones[18].alarm,
-                         configuration.zones[18].inclusion,
-                         configuration.zones[18].alarm_memory,
-                         configuration.zones[18].sabotage_memory,
-                         configuration.zones[19].name,
-                         configuration.zones[19].sabotage,
-                         configuration.zones[19].alarm,
-                         configuration.zones[19].inclusion,
-                         configuration.zones[19].alarm_memory,
-                         configuration.zones[19].sabotage_memory,
-                         configuration.zones[20].name,
-                         configuration.zones[20].sabotage,
-                         configuration.zones[20].alarm,
-                         configuration.zones[20].inclusion,
-                         configuration.zones[20].alarm_memory,
-                         configuration.zones[20].sabotage_memory,
-                         configuration.zones[21].name,
-                         configuration.zones[21].sabotage,
-                         configuration.zones[21].alarm,
-                         configuration.zones[21].inclusion,
-                         configuration.zones[21].alarm_memory,
-                         configuration.zones[21].sabotage_memory,
-                         configuration.zones[22].name,
-                         configuration.zones[22].sabotage,
-                         configuration.zones[22].alarm,
-                         configuration.zones[22].inclusion,
-                         configuration.zones[22].alarm_memory,
-                         configuration.zones[22].sabotage_memory,
-                         configuration.zones[23].name,
-                         configuration.zones[23].sabotage,
-                         configuration.zones[23].alarm,
-                         configuration.zones[23].inclusion,
-                         configuration.zones[23].alarm_memory,
-                         configuration.zones[23].sabotage_memory,
-                         configuration.zones[24].name,
-                         configuration.zones[24].sabotage,
-                         configuration.zones[24].alarm,
-                         configuration.zones[24].inclusion,
-                         configuration.zones[24].alarm_memory,
-                         configuration.zones[24].sabotage_memory,
-                         configuration.zones[25].name,
-                         configuration.zones[25].sabotage,
-                         configuration.zones[25].alarm,
-                         configuration.zones[25].inclusion,
-                         configuration.zones[25].alarm_memory,
-                         configuration.zones[25].sabotage_memory,
-                         configuration.zones[26].name,
-                         configuration.zones[26].sabotage,
-                         configuration.zones[26].alarm,
-                         configuration.zones[26].inclusion,
-                         configuration.zones[26].alarm_memory,
-                         configuration.zones[26].sabotage_memory,
-                         configuration.zones[27].name,
-                         configuration.zones[27].sabotage,
-                         configuration.zones[27].alarm,
-                         configuration.zones[27].inclusion,
-                         configuration.zones[27].alarm_memory,
-                         configuration.zones[27].sabotage_memory,
-                         configuration.zones[28].name,
-                         configuration.zones[28].sabotage,
-                         configuration.zones[28].alarm,
-                         configuration.zones[28].inclusion,
-                         configuration.zones[28].alarm_memory,
-                         configuration.zones[28].sabotage_memory,
-                         configuration.zones[29].name,
-                         configuration.zones[29].sabotage,
-                         configuration.zones[29].alarm,
-                         configuration.zones[29].inclusion,
-                         configuration.zones[29].alarm_memory,
-                         configuration.zones[29].sabotage_memory,
-                         configuration.zones[30].name,
-                         configuration.zones[30].sabotage,
-                         configuration.zones[30].alarm,
-                         configuration.zones[30].inclusion,
-                         configuration.zones[30].alarm_memory,
-                         configuration.zones[30].sabotage_memory,
-                         configuration.zones[31].name,
-                         configuration.zones[31].sabotage,
-                         configuration.zones[31].alarm,
-                         configuration.zones[31].inclusion,
-                         configuration.zones[31].alarm_memory,
-                         configuration.zones[31].sabotage_memory,
-                         configuration.partitions[0].name,
-                         configuration.partitions[0].alarm,
-                         configuration.partitions[0].armed,
-                         configuration.partitions[1].name,
-                         configuration.partitions[1].alarm,
-                         configuration.partitions[1].armed,
-                         configuration.partitions[2].name,
-                         configuration.partitions[2].alarm,
-                         configuration.partitions[2].armed,
-                         configuration.partitions[3].name,
-                         configuration.partitions[3].alarm,
-                         configuration.partitions[3].armed,
-                         configuration.partitions[4].name,
-                         configuration.partitions[4].alarm,
-                         configuration.partitions[4].armed,
-                         configuration.partitions[5].name,
-                         configuration.partitions[5].alarm,
-                         configuration.partitions[5].armed,
-                         configuration.partitions[6].name,
-                         configuration.partitions[6].alarm,
-                         configuration.partitions[6].armed,
-                         configuration.partitions[7].name,
-                         configuration.partitions[7].alarm,
-                         configuration.partitions[7].armed,
-                         configuration.alarm_power,
-                         configuration.alarm_bpi,
-                         configuration.alarm_fuse,
-                         configuration.alarm_battery_low,
-                         configuration.alarm_telephone_line,
-                         configuration.alarm_default_codes,
-                         configuration.alarm_wireless,
-                         configuration.sabotage_partition,
-                         configuration.sabotage_fake_key,
-                         configuration.sabotage_bpi,
-                         configuration.sabotage_system,
-                         configuration.sabotage_jam,
-                         configuration.sabotage_wireless,
-                         configuration.siren_state);
-
-    sem_release (&configuration.semaphore);
+    body_len = snprintf(body, HA_MAX_LEN, HA_FMT, info->ip, info->mac,
+                        panel->state_machine->state);
+
+    sem_acquire_blocking (&panel->configuration->semaphore);
+
+    ha_len = render_ha (&body[body_len], HA_MAX_LEN - body_len - 1,
+                        panel->configuration);
+
+    sem_release (&panel->configuration->semaphore);
+
+    if (ha_len < 0) {
+        HTTP_LOG_ERROR("/ha body exceeds %d bytes", HA_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+    body_len += ha_len;
+    body[body_len++] = '}';
 
     /*
      * Set the Content-Length header with http_resp_set_len().
@@ -1239,6 +911,1094 @@ ha_handler(struct http *http, void *p)
     return http_resp_send_buf(http, body, body_len, false);
 }
 
+/*
+ * Large enough for a delta with since=0, i.e. the full configuration:
+ * about 150 bytes per zone, 60 per partition, plus outputs and faults.
+ */
+#define DELTA_MAX_LEN (6 * 1024)
+
+/*
+ * Custom handler for GET/HEAD /delta
+ *
+ * The web app calls /delta?since=<gen>, where gen is the "gen" field
+ * of the previous response (or 0 on startup), and panel=<n> for any
+ * panel but the first. The response is a JSON
+ * object that always contains the boot epoch, the current generation,
+ * temperature (Q18.14 as for /temp) and rssi, plus only the zones,
+ * partitions,
+ * outputs and faults that changed after generation since. So when the
+ * panel is quiet, the response is a few dozen bytes, and the client
+ * only has to patch the DOM nodes for the entities that are present.
+ *
+ * The generations restart from 0 at boot, so a since from a previous
+ * boot may be lower than the current generation and still be stale.
+ * The epoch, a random number drawn once per boot, tells the client:
+ * when it changes, the client asks again with since=0.
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+delta_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    /*
+     * Static, since the body may be several KB. Handlers are never
+     * run concurrently, and the body is copied by http_resp_send_buf()
+     * with durable set to false.
+     */
+    static char body[DELTA_MAX_LEN];
+    static uint32_t epoch = 0;
+    panel_t *panel;
+    configuration_t *configuration;
+    uint32_t since = 0;
+    int body_len, delta_len;
+    err_t err;
+    (void)p;
+
+    if ((panel = req_panel(req)) == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+    if (!query_uint(req, "since", STRLEN_LTRL("since"), &since))
+        return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+    configuration = panel->configuration;
+
+    while (epoch == 0)
+        epoch = get_rand_32();
+
+    body_len = snprintf(body, DELTA_MAX_LEN,
+                        "{\"epoch\":%lu,\"temp\":%lu,\"rssi\":%ld,"
+                        "\"state_machine\":%d,", (unsigned long)epoch,
+                        (unsigned long)get_temp(), (long)get_rssi(),
+                        panel->state_machine->state);
+
+    sem_acquire_blocking (&configuration->semaphore);
+
+    /*
+     * A client that saw a generation newer than ours is talking to a
+     * previous boot of the device, so it gets everything.
+     */
+    if (since > configuration->generation)
+        since = 0;
+
+    delta_len = render_delta (&body[body_len], DELTA_MAX_LEN - body_len - 1,
+                              configuration, since);
+
+    sem_release (&configuration->semaphore);
+
+    if (delta_len < 0) {
+        HTTP_LOG_ERROR("/delta body exceeds %d bytes", DELTA_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+    body_len += delta_len;
+    body[body_len++] = '}';
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#if PICOW_HTTPS
+
+#define TLS_FMT ("{\"full\":%lu,\"resumed\":%lu,\"missed\":%lu}")
+#define TLS_MAX ("{\"full\":4294967295,\"resumed\":4294967295," \
+                 "\"missed\":4294967295}")
+#define TLS_MAX_LEN (STRLEN_LTRL(TLS_MAX))
+
+/*
+ * Custom handler for GET/HEAD /tls, only in the versions with TLS
+ * support.
+ *
+ * The response is a JSON object with the handshake counters from
+ * tls_stats.h: "full" handshakes, sessions "resumed" from the session
+ * cache, and sessions offered by the client that "missed" the cache.
+ * A dashboard that reconnects should raise "resumed", not "full".
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+tls_handler(struct http *http, void *p)
+{
+    struct resp *resp = http_resp(http);
+    tls_stats_t stats;
+    char body[TLS_MAX_LEN + 1];
+    size_t body_len;
+    err_t err;
+    (void)p;
+
+    tls_stats_get(&stats);
+    body_len = snprintf(body, sizeof(body), TLS_FMT,
+                        (unsigned long)stats.full,
+                        (unsigned long)stats.resumed,
+                        (unsigned long)stats.missed);
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#endif /* PICOW_HTTPS */
+
+/* Room for the totals and CONNECTIONS_MAX open connections */
+#define CONNECTIONS_MAX_LEN (192 + CONNECTIONS_MAX * 128)
+
+/*
+ * Custom handler for GET/HEAD /connections
+ *
+ * The response is a JSON object with the connection counters from
+ * connections.h, and an array "open" with the age, idle time,
+ * handshake time, bytes sent and requests served of each connection
+ * that is currently open (including the one for this request).
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+connections_handler(struct http *http, void *p)
+{
+    struct resp *resp = http_resp(http);
+    char body[CONNECTIONS_MAX_LEN];
+    int body_len;
+    err_t err;
+    (void)p;
+
+    if ((body_len = connections_render(body, sizeof(body))) < 0) {
+        HTTP_LOG_ERROR("/connections body exceeds %d bytes",
+                       CONNECTIONS_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+/* Records per /events response, about 110 bytes each as JSON */
+#define EVENTS_MAX 32
+#define EVENTS_MAX_LEN (64 + EVENTS_MAX * 128)
+
+/*
+ * Custom handler for GET/HEAD /events
+ *
+ * The client calls /events?since=<seq>, where seq is the "next" field
+ * of the previous response (or 0 for the whole history), and
+ * panel=<n> for any panel but the first; panels without an event log
+ * get 404. The response
+ * is a JSON object with up to EVENTS_MAX events from the flash event
+ * log (see event_log.h) with a sequence number greater than since,
+ * oldest first, and "more":true if there are more to fetch:
+ *
+ * {"next":42,"more":false,"events":[{"seq":42,"type":1,"index":3,
+ *  "date":"19/10/26","time":"08:15","raw":"01030813..."}]}
+ *
+ * The fields decoded from raw are a best guess of the logger layout,
+ * see bentel_event_decode(), so the raw bytes are passed along too.
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+events_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    /* Static for the size, as for /delta. */
+    static char body[EVENTS_MAX_LEN];
+    static event_log_record_t records[EVENTS_MAX];
+    bentel_event_t event;
+    panel_t *panel;
+    uint32_t since = 0;
+    int body_len, count, i, j;
+    err_t err;
+    (void)p;
+
+    if ((panel = req_panel(req)) == NULL || panel->event_log == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+    if (!query_uint(req, "since", STRLEN_LTRL("since"), &since))
+        return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+
+    count = event_log_read(panel->event_log, since, records, EVENTS_MAX);
+
+    body_len = snprintf(body, EVENTS_MAX_LEN,
+                        "{\"next\":%lu,\"more\":%s,\"events\":[",
+                        (unsigned long)(count > 0 ?
+                                        records[count - 1].seq : since),
+                        count == EVENTS_MAX ? "true" : "false");
+
+    for (i = 0; i < count; i++) {
+        memset(&event, 0, sizeof(event));
+        bentel_event_decode(records[i].raw, &event);
+
+        body_len += snprintf(&body[body_len], EVENTS_MAX_LEN - body_len,
+                             "%s{\"seq\":%lu,\"type\":%d,\"index\":%u,"
+                             "\"date\":\"%02u/%02u/%02u\","
+                             "\"time\":\"%02u:%02u\",\"raw\":\"",
+                             i == 0 ? "" : ",",
+                             (unsigned long)records[i].seq,
+                             (int)event.event_type, event.index,
+                             event.day, event.month, event.year,
+                             event.hour, event.minute);
+        for (j = 0; j < BENTEL_EVENT_SIZE; j++)
+            body_len += snprintf(&body[body_len],
+                                 EVENTS_MAX_LEN - body_len, "%02x",
+                                 records[i].raw[j]);
+        body_len += snprintf(&body[body_len], EVENTS_MAX_LEN - body_len,
+                             "\"}");
+    }
+    body_len += snprintf(&body[body_len], EVENTS_MAX_LEN - body_len, "]}");
+
+    if (body_len >= EVENTS_MAX_LEN) {
+        HTTP_LOG_ERROR("/events body exceeds %d bytes", EVENTS_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#define PANELS_MAX_LEN (16 + PANELS_MAX * 96)
+
+/*
+ * Custom handler for GET/HEAD /panels
+ *
+ * The response is a JSON array of the panels that the other endpoints
+ * take in their panel=<n> query parameter, with their name and model:
+ *
+ * [{"panel":0,"name":"panel0","model":"KYO32"}]
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+panels_handler(struct http *http, void *p)
+{
+    struct resp *resp = http_resp(http);
+    char body[PANELS_MAX_LEN];
+    int body_len, i, n;
+    panel_t *panel;
+    err_t err;
+    (void)p;
+
+    body_len = snprintf(body, sizeof(body), "[");
+    for (i = 0; i < panel_count(); i++) {
+        panel = panel_get(i);
+
+        body_len += snprintf(&body[body_len], sizeof(body) - body_len,
+                             "%s{\"panel\":%d,\"name\":\"%s\",\"model\":",
+                             i == 0 ? "" : ",", i, panel->name);
+
+        sem_acquire_blocking (&panel->configuration->semaphore);
+        n = render_string(&body[body_len], sizeof(body) - body_len,
+                          panel->configuration->model);
+        sem_release (&panel->configuration->semaphore);
+
+        if (n < 0)
+            break;
+        body_len += n;
+        body_len += snprintf(&body[body_len], sizeof(body) - body_len, "}");
+    }
+    body_len += snprintf(&body[body_len], sizeof(body) - body_len, "]");
+
+    if (body_len >= (int)sizeof(body)) {
+        HTTP_LOG_ERROR("/panels body exceeds %d bytes", PANELS_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#ifdef COMMANDS
+static const struct {
+    const char *name;
+    size_t len;
+    command_type_t type;
+} command_ops[] = {
+    { "arm", STRLEN_LTRL("arm"), COMMAND_ARM },
+    { "stay", STRLEN_LTRL("stay"), COMMAND_STAY },
+    { "disarm", STRLEN_LTRL("disarm"), COMMAND_DISARM },
+    { "exclude", STRLEN_LTRL("exclude"), COMMAND_EXCLUDE },
+    { "include", STRLEN_LTRL("include"), COMMAND_INCLUDE },
+    { "reset", STRLEN_LTRL("reset"), COMMAND_RESET },
+};
+
+#define COMMAND_OPS (sizeof(command_ops) / sizeof(command_ops[0]))
+
+static const char * const command_statuses[] = {
+    [COMMAND_UNKNOWN] = "unknown",
+    [COMMAND_QUEUED] = "queued",
+    [COMMAND_SENT] = "sent",
+    [COMMAND_CONFIRMED] = "confirmed",
+    [COMMAND_FAILED] = "failed",
+};
+
+/*
+ * Whether the request has the X-Command-Token header of the build. The
+ * comparison takes as long wherever the first difference is, so that
+ * the timing does not give the token away.
+ */
+static bool
+command_authorized(struct req *req)
+{
+    static const char token[] = COMMAND_TOKEN;
+    const char *val;
+    size_t val_len, i;
+    char diff = 0;
+
+    if ((val = http_req_hdr(req, "X-Command-Token",
+                            STRLEN_LTRL("X-Command-Token"), &val_len))
+        == NULL || val_len != sizeof(token) - 1)
+        return false;
+    for (i = 0; i < val_len; i++)
+        diff |= val[i] ^ token[i];
+    return diff == 0;
+}
+
+/*
+ * Custom handler for GET/HEAD/POST /command
+ *
+ * POST /command?op=<op>&mask=<n> queues a command to the panel (and
+ * panel=<n> for any panel but the first), where op is one of:
+ *
+ * arm, stay, disarm   mask: bit n for partition n
+ * exclude, include    mask: bit n for zone n
+ * reset               alarm memory, no mask
+ *
+ * The response has status 202 and the id of the command:
+ *
+ * {"id":3,"status":"queued"}
+ *
+ * Commands go ahead of the background polls, and are confirmed by an
+ * immediate re-read of the panel state (see state_machine.h), so the
+ * status is final a few hundred ms later. GET /command?id=<id> returns
+ * it, as "sent", "confirmed" or "failed"; an id that is too old to be
+ * remembered gets 404. A full queue gets 503, a listen-only panel 409.
+ *
+ * Only built with COMMANDS (else 404), and every request needs the
+ * header X-Command-Token with the COMMAND_TOKEN of the build (else
+ * 403), see CMakeLists.txt.
+ */
+err_t
+command_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    char body[48];
+    const char *query, *val;
+    size_t query_len, val_len;
+    panel_t *panel;
+    command_status_t status;
+    uint32_t id = 0, mask = 0;
+    int body_len, i, ret;
+    err_t err;
+    (void)p;
+
+    if (!command_authorized(req))
+        return http_resp_err(http, HTTP_STATUS_FORBIDDEN);
+
+    if ((panel = req_panel(req)) == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+
+    if (http_req_method(req) != HTTP_METHOD_POST) {
+        if (!query_uint(req, "id", STRLEN_LTRL("id"), &id) || id == 0)
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+        status = state_machine_command_status(panel->state_machine, id);
+        if (status == COMMAND_UNKNOWN)
+            return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+    }
+    else {
+        if ((query = http_req_query(req, &query_len)) == NULL
+            || (val = http_req_query_val(query, query_len, "op",
+                                         STRLEN_LTRL("op"), &val_len))
+            == NULL)
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+        for (i = 0; i < (int)COMMAND_OPS; i++)
+            if (val_len == command_ops[i].len
+                && memcmp(val, command_ops[i].name, val_len) == 0)
+                break;
+        if (i == COMMAND_OPS)
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+        if (!query_uint(req, "mask", STRLEN_LTRL("mask"), &mask)
+            || (mask == 0 && command_ops[i].type != COMMAND_RESET))
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+
+        ret = state_machine_command(panel->state_machine,
+                                    command_ops[i].type, mask, &id);
+        if (ret == -2)
+            return http_resp_err(http, HTTP_STATUS_CONFLICT);
+        if (ret != 0)
+            return http_resp_err(http, HTTP_STATUS_SERVICE_UNAVAILABLE);
+        status = COMMAND_QUEUED;
+
+        if ((err = http_resp_set_status(resp, HTTP_STATUS_ACCEPTED))
+            != ERR_OK) {
+            HTTP_LOG_ERROR("Set status 202 failed: %d", err);
+            return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+        }
+    }
+
+    body_len = snprintf(body, sizeof(body), "{\"id\":%lu,\"status\":\"%s\"}",
+                        (unsigned long)id, command_statuses[status]);
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    /* the client polls for the status right after */
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+/*
+ * Parse one command of a batch, "<op>" or "<op>:<mask>" with op as for
+ * /command, into command. Returns false if it is not valid.
+ */
+static bool
+parse_command(const char *s, size_t len, command_t *command)
+{
+    size_t op_len, i;
+    int op;
+
+    for (op_len = 0; op_len < len && s[op_len] != ':'; op_len++)
+        ;
+    for (op = 0; op < (int)COMMAND_OPS; op++)
+        if (op_len == command_ops[op].len
+            && memcmp(s, command_ops[op].name, op_len) == 0)
+            break;
+    if (op == COMMAND_OPS)
+        return false;
+
+    command->type = command_ops[op].type;
+    command->mask = 0;
+    if (op_len == len)
+        return command->type == COMMAND_RESET;
+
+    /* ":" and up to 10 digits */
+    if (len - op_len < 2 || len - op_len > 11)
+        return false;
+    for (i = op_len + 1; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        command->mask = command->mask * 10 + (s[i] - '0');
+    }
+    return command->mask != 0 || command->type == COMMAND_RESET;
+}
+
+#define BATCH_MAX_LEN (16 + STATE_MACHINE_BATCH * 40)
+
+/*
+ * Custom handler for GET/HEAD/POST /batch
+ *
+ * POST /batch?ops=<cmd>,<cmd>,... queues up to STATE_MACHINE_BATCH
+ * commands as one batch (and panel=<n> for any panel but the first),
+ * where each cmd is <op>:<mask>, or just reset, with op and mask as
+ * for /command. For example, to exclude zones 1 and 4, and arm
+ * partitions 0 and 2:
+ *
+ * POST /batch?ops=exclude:18,arm:5
+ *
+ * Either all commands are queued, or none of them (422 for a bad
+ * command, 503 for a full queue). The commands are sent back to back
+ * and confirmed with a single re-read of the panel state. The response
+ * has status 202, and the commands with their consecutive ids:
+ *
+ * {"commands":[{"id":7,"status":"queued"},{"id":8,"status":"queued"}]}
+ *
+ * GET /batch?id=<first id>&count=<n> returns the same with the current
+ * status of each command, see /command. Built and authorized as
+ * /command.
+ */
+err_t
+batch_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    char body[BATCH_MAX_LEN];
+    const char *query, *val;
+    size_t query_len, val_len, start, end;
+    panel_t *panel;
+    command_t commands[STATE_MACHINE_BATCH];
+    uint32_t id = 0, count = 0;
+    int body_len, i, ret;
+    err_t err;
+    (void)p;
+
+    if (!command_authorized(req))
+        return http_resp_err(http, HTTP_STATUS_FORBIDDEN);
+
+    if ((panel = req_panel(req)) == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+
+    if (http_req_method(req) != HTTP_METHOD_POST) {
+        if (!query_uint(req, "id", STRLEN_LTRL("id"), &id) || id == 0
+            || !query_uint(req, "count", STRLEN_LTRL("count"), &count)
+            || count == 0 || count > STATE_MACHINE_BATCH)
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+    }
+    else {
+        if ((query = http_req_query(req, &query_len)) == NULL
+            || (val = http_req_query_val(query, query_len, "ops",
+                                         STRLEN_LTRL("ops"), &val_len))
+            == NULL || val_len == 0)
+            return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+
+        for (start = 0; start <= val_len; start = end + 1) {
+            for (end = start; end < val_len && val[end] != ','; end++)
+                ;
+            if (count == STATE_MACHINE_BATCH
+                || !parse_command(&val[start], end - start,
+                                  &commands[count]))
+                return http_resp_err(http,
+                                     HTTP_STATUS_UNPROCESSABLE_CONTENT);
+            count++;
+        }
+
+        ret = state_machine_batch(panel->state_machine, commands, count,
+                                  &id);
+        if (ret == -2)
+            return http_resp_err(http, HTTP_STATUS_CONFLICT);
+        if (ret != 0)
+            return http_resp_err(http, HTTP_STATUS_SERVICE_UNAVAILABLE);
+
+        if ((err = http_resp_set_status(resp, HTTP_STATUS_ACCEPTED))
+            != ERR_OK) {
+            HTTP_LOG_ERROR("Set status 202 failed: %d", err);
+            return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+        }
+    }
+
+    body_len = snprintf(body, sizeof(body), "{\"commands\":[");
+    for (i = 0; i < (int)count; i++)
+        body_len += snprintf(&body[body_len], sizeof(body) - body_len,
+                             "%s{\"id\":%lu,\"status\":\"%s\"}",
+                             i == 0 ? "" : ",", (unsigned long)(id + i),
+                             command_statuses[
+                                 state_machine_command_status(
+                                     panel->state_machine, id + i)]);
+    body_len += snprintf(&body[body_len], sizeof(body) - body_len, "]}");
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_POLL)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+#else
+err_t
+command_handler(struct http *http, void *p)
+{
+    (void)p;
+
+    return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+}
+
+err_t
+batch_handler(struct http *http, void *p)
+{
+    (void)p;
+
+    return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+}
+#endif /* COMMANDS */
+
+#ifdef CAPTURE_SIZE
+#define CAPTURE_MAX_LEN (sizeof(capture_header_t) + CAPTURE_SIZE)
+#else
+#define CAPTURE_MAX_LEN sizeof(capture_header_t)
+#endif
+
+/*
+ * Custom handler for GET/HEAD /capture
+ *
+ * The response is the capture of the link of the panel, the bytes both
+ * ways with their time, as application/octet-stream in the format of
+ * src/capture.h, for host/bentel_replay:
+ *
+ * curl -o panel0.bcap http://picow/capture
+ *
+ * 404 if the panel has none, see CAPTURE_SIZE in CMakeLists.txt. The
+ * capture goes on while it is sent, the response is a copy.
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+capture_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    /* Static for the size, as for /delta. */
+    static uint8_t body[CAPTURE_MAX_LEN];
+    panel_t *panel;
+    int body_len;
+    err_t err;
+    (void)p;
+
+    if ((panel = req_panel(req)) == NULL || panel->capture == NULL)
+        return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+
+    if ((body_len = capture_read(panel->capture, body, sizeof(body))) < 0) {
+        HTTP_LOG_ERROR("/capture exceeds %u bytes",
+                       (unsigned)CAPTURE_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/octet-stream"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#ifdef TRACE_SIZE
+#define TRACE_MAX_LEN \
+    (sizeof(trace_header_t) + TRACE_CORES * TRACE_SIZE * sizeof(trace_record_t))
+
+/*
+ * Custom handler for GET/HEAD /trace
+ *
+ * The response is the trace of both cores, the newest TRACE_SIZE
+ * records of each, as application/octet-stream in the format of
+ * src/trace.h, for host/bentel_trace:
+ *
+ * curl -o picow.btrc http://picow/trace
+ *
+ * 404 without TRACE_SIZE in CMakeLists.txt. The trace goes on while it
+ * is sent, the response is a copy.
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+trace_handler(struct http *http, void *p)
+{
+    struct resp *resp = http_resp(http);
+    /* Static for the size, as for /delta. */
+    static uint8_t body[TRACE_MAX_LEN];
+    int body_len;
+    err_t err;
+    (void)p;
+
+    if ((body_len = trace_read(body, sizeof(body))) < 0) {
+        HTTP_LOG_ERROR("/trace exceeds %u bytes", (unsigned)TRACE_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/octet-stream"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+#else
+err_t
+trace_handler(struct http *http, void *p)
+{
+    (void)p;
+
+    return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+}
+#endif /* TRACE_SIZE */
+
+/* Room for every counter of both cores, about 110 bytes each */
+#define PERF_MAX_LEN (64 + PERF_CORES * PERF_IDS * 112)
+
+/*
+ * Custom handler for GET/HEAD /perf
+ *
+ * The response is a JSON object with the cycle counters of perf.h for
+ * each core, those called since the last reset: the count of calls and
+ * the min, mean and max cycles of a call, and the clock in Hz:
+ *
+ * {"clk_hz":133000000,"cores":[{"on_uart_rx":{"count":12,"min":840,
+ *  "mean":910,"max":2310},...},{"state_machine_next":{...},...}]}
+ *
+ * The counters are reset, unless the query has reset=0. 404 if they
+ * are not in the build, see PERF in CMakeLists.txt.
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+perf_handler(struct http *http, void *p)
+{
+#if PERF
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    /* Static for the size, as for /delta. */
+    static char body[PERF_MAX_LEN];
+    uint32_t reset = 1;
+    int body_len;
+    err_t err;
+    (void)p;
+
+    if (!query_uint(req, "reset", STRLEN_LTRL("reset"), &reset))
+        return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+
+    if ((body_len = perf_render(body, sizeof(body), reset != 0)) < 0) {
+        HTTP_LOG_ERROR("/perf body exceeds %d bytes", PERF_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+#else
+    (void)p;
+
+    return http_resp_err(http, HTTP_STATUS_NOT_FOUND);
+#endif
+}
+
+/* Room for the stacks, the heaps and about 64 bytes per lwIP pool */
+#define RAM_MAX_LEN (256 + MEMP_MAX * 64)
+
+/*
+ * Custom handler for GET/HEAD /ram
+ *
+ * The response is a JSON object with the high water marks of ram_stats.h
+ * as of the latest sample: the stack of each core, the C heap, the lwIP
+ * heap (if lwIP keeps MEM_STATS), and the size, the use and the peak
+ * use of each lwIP memory pool:
+ *
+ * {"samples":120,"stacks":[{"size":2048,"max_used":812},{...}],
+ *  "heap":{"size":61440,"arena":9216,"used":7010,"max_used":8830},
+ *  "pools":{"TCP_PCB":{"size":5,"used":1,"max_used":3},...}}
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+ram_handler(struct http *http, void *p)
+{
+    struct resp *resp = http_resp(http);
+    /* Static for the size, as for /delta. */
+    static char body[RAM_MAX_LEN];
+    int body_len;
+    err_t err;
+    (void)p;
+
+    if ((body_len = ram_stats_render(body, sizeof(body))) < 0) {
+        HTTP_LOG_ERROR("/ram body exceeds %d bytes", RAM_MAX_LEN);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+#define LOG_FMT \
+    "{\"level\":%u,\"written\":%lu,\"suppressed\":%lu,\"dropped\":%lu," \
+    "\"pending\":%lu}"
+#define LOG_MAX_LEN (STRLEN_LTRL(LOG_FMT) + 4 * 10)
+
+/*
+ * Custom handler for GET/HEAD /log
+ *
+ * The query level=<n> sets the level of the log of log_ring.h: 0 for
+ * errors only, then warnings, informational, and 3 for the debug lines
+ * of the panel link. The response is a JSON object with the level, and
+ * the count of lines written, suppressed by the rate limit and dropped
+ * on a full ring since boot, and the bytes not yet written out:
+ *
+ * {"level":2,"written":12,"suppressed":0,"dropped":0,"pending":0}
+ *
+ * The private data pointer p is not used.
+ */
+err_t
+log_handler(struct http *http, void *p)
+{
+    struct req *req = http_req(http);
+    struct resp *resp = http_resp(http);
+    log_ring_stats_t stats;
+    uint32_t level = UINT32_MAX;
+    char body[LOG_MAX_LEN + 1];
+    size_t body_len;
+    err_t err;
+    (void)p;
+
+    if (!query_uint(req, "level", STRLEN_LTRL("level"), &level))
+        return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+    if (level != UINT32_MAX && log_ring_set_level(level) != 0)
+        return http_resp_err(http, HTTP_STATUS_UNPROCESSABLE_CONTENT);
+
+    log_ring_get_stats(&stats);
+    body_len = snprintf(body, sizeof(body), LOG_FMT,
+                        (unsigned)log_ring_level,
+                        (unsigned long)stats.written,
+                        (unsigned long)stats.suppressed,
+                        (unsigned long)stats.dropped,
+                        (unsigned long)stats.pending);
+
+    if ((err = http_resp_set_len(resp, body_len)) != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_len() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_type_ltrl(resp, "application/json"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("http_resp_set_type_ltrl() failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = http_resp_set_hdr_ltrl(resp, "Cache-Control", "no-store"))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Set header Cache-Control failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    if ((err = set_conn_policy(resp, CONN_ONE_SHOT)) != ERR_OK) {
+        HTTP_LOG_ERROR("Set connection policy failed: %d", err);
+        return http_resp_err(http, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+
+    return http_resp_send_buf(http, body, body_len, false);
+}
+
+/* A handler and its private data, as registered, see timed_priv() */
+struct timed {
+    hndlr_f     handler;
+    void        *p;
+    perf_id_t   id;
+};
+
+static struct timed timed[PERF_IDS];
+
+void *
+timed_priv(perf_id_t id, hndlr_f handler, void *p)
+{
+    timed[id].handler = handler;
+    timed[id].p = p;
+    timed[id].id = id;
+    return &timed[id];
+}
+
+/*
+ * Runs the handler that p stands for, see timed_priv(), counts its
+ * cycles in /perf and marks its begin and end in /trace. The send of
+ * the response is included, up to the point that lwIP has queued it.
+ */
+err_t
+timed_handler(struct http *http, void *p)
+{
+    struct timed *t = p;
+    perf_stamp_t start;
+    err_t err;
+
+    trace_write(TRACE_HANDLER_BEGIN, t->id);
+    perf_begin(&start);
+    err = t->handler(http, t->p);
+    perf_end(t->id, &start);
+    trace_write(TRACE_HANDLER_END, t->id);
+    return err;
+}
+
 err_t
 bootloader_handler(struct http *http, void *p)
 {
@@ -10,6 +10,8 @@
 #include "lwip/ip_addr.h"
 #include "picow_http/http.h"
 
+#include "perf.h"
+
 #define MAC_ADDR_LEN (sizeof("01:02:03:04:05:06"))
 
 /*
@@ -29,6 +31,13 @@ struct netinfo {
 	char		mac[MAC_ADDR_LEN];
 };
 
+/*
+ * Idle timeout for the HTTP server, in seconds. Endpoints that clients
+ * poll announce it in the Keep-Alive response header, see
+ * set_conn_policy() in handlers.c.
+ */
+#define POLL_IDLE_TMO_S 60
+
 /*
  * Return the most recent temperature sensor reading in degrees Kelvin as
  * a fixed-point Q18.14 number; i.e. 18 integer bits and 14 fractional
@@ -46,11 +55,28 @@ uint32_t get_temp(void);
 int32_t get_rssi(void);
 
 /*
- * Custom response handlers for the URL paths:
+ * Custom response handlers for the URL paths below. /ha, /delta,
+ * /events, /command, /batch and /capture take the query parameter
+ * panel=<n> to select a panel other than the first, see /panels.
+ *
  * /temp
  * /led
  * /rssi
  * /netinfo
+ * /ha
+ * /delta
+ * /tls (only with TLS support)
+ * /connections
+ * /events
+ * /panels
+ * /command
+ * /batch
+ * /capture
+ * /perf
+ * /trace
+ * /ram
+ * /log
+ * /bootloader
  *
  * Custom handler functions must satisfy typedef hndlr_f from
  * picow_http/http.h
@@ -62,4 +88,26 @@ err_t led_handler(struct http *http, void *p);
 err_t rssi_handler(struct http *http, void *p);
 err_t netinfo_handler(struct http *http, void *p);
 err_t ha_handler(struct http *http, void *p);
+err_t delta_handler(struct http *http, void *p);
+#if PICOW_HTTPS
+err_t tls_handler(struct http *http, void *p);
+#endif
+err_t connections_handler(struct http *http, void *p);
+err_t events_handler(struct http *http, void *p);
+err_t panels_handler(struct http *http, void *p);
+err_t command_handler(struct http *http, void *p);
+err_t batch_handler(struct http *http, void *p);
+err_t capture_handler(struct http *http, void *p);
+err_t perf_handler(struct http *http, void *p);
+err_t trace_handler(struct http *http, void *p);
+err_t ram_handler(struct http *http, void *p);
+err_t log_handler(struct http *http, void *p);
 err_t bootloader_handler(struct http *http, void *p);
+
+/*
+ * Register timed_handler() with timed_priv(id, handler, p) as its
+ * private data to have handler (with private data p) counted in /perf
+ * as id. At most one handler per id.
+ */
+err_t timed_handler(struct http *http, void *p);
+void *timed_priv(perf_id_t id, hndlr_f handler, void *p);
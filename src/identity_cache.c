@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "flash_store.h"
+#include "identity_cache.h"
+#include "log_ring.h"
+
+/* "BID1", bump the last digit when the layout changes */
+#define IDENTITY_CACHE_MAGIC 0x31444942
+
+typedef struct _identity_cache_t identity_cache_t;
+
+struct _identity_cache_t
+{
+    uint32_t magic;
+    uint32_t length;
+
+    char model[9];
+    int32_t fw_major;
+    int32_t fw_minor;
+    char zones[32][17];
+    char partitions[8][17];
+
+    /** @brief CRC-32 of all the fields above */
+    uint32_t crc;
+};
+
+#define IDENTITY_CACHE_PAGES \
+    ((sizeof (identity_cache_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+
+/* programmed from RAM, padded to whole pages */
+static uint8_t identity_cache_pages[IDENTITY_CACHE_PAGES * FLASH_PAGE_SIZE];
+
+static bool
+identity_cache_valid (const identity_cache_t * cache)
+{
+    return cache->magic == IDENTITY_CACHE_MAGIC &&
+           cache->length == sizeof (identity_cache_t) &&
+           cache->crc == crc32 (cache, offsetof (identity_cache_t, crc));
+}
+
+int
+identity_cache_load (configuration_t * configuration)
+{
+    const identity_cache_t * cache;
+    int i;
+
+    cache = (const identity_cache_t *)
+        flash_store_data (configuration->identity_offset);
+
+    configuration->identity_cached = false;
+
+    if (!identity_cache_valid (cache))
+    {
+        return -1;
+    }
+
+    /*
+     * The cached values are the initial state, so the generations are
+     * left alone: a client asking for everything gets them, and the
+     * first answers from the panel only count as changes if they
+     * differ.
+     */
+    snprintf (configuration->model, sizeof (configuration->model), "%s",
+              cache->model);
+    configuration->fw_major = cache->fw_major;
+    configuration->fw_minor = cache->fw_minor;
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        snprintf (configuration->zones[i].name,
+                  sizeof (configuration->zones[i].name), "%s",
+                  cache->zones[i]);
+    }
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        snprintf (configuration->partitions[i].name,
+                  sizeof (configuration->partitions[i].name), "%s",
+                  cache->partitions[i]);
+    }
+
+    configuration->capacity = capacity_lookup (configuration->model);
+    configuration->identity_cached = true;
+
+    return 0;
+}
+
+/*
+ * The answers the sweep needs before the cache can be written: the
+ * model, and the pages of names of the zones and partitions of the
+ * model, as requested by the state machine.
+ */
+static uint32_t
+identity_cache_needed (const configuration_t * configuration)
+{
+    uint32_t needed = IDENTITY_ANSWERED_MODEL;
+    int i;
+
+    for (i = 0 ; i < configuration->capacity->zones ; i += 4)
+    {
+        needed |= IDENTITY_ANSWERED_ZONES (i);
+    }
+
+    for (i = 0 ; i < configuration->capacity->partitions ; i += 4)
+    {
+        needed |= IDENTITY_ANSWERED_PARTITIONS (i);
+    }
+
+    return needed;
+}
+
+int
+identity_cache_save (configuration_t * configuration)
+{
+    identity_cache_t * cache;
+    uint32_t needed;
+    int i;
+
+    memset (identity_cache_pages, 0xff, sizeof (identity_cache_pages));
+    cache = (identity_cache_t *) identity_cache_pages;
+    memset (cache, 0, sizeof (identity_cache_t));
+
+    sem_acquire_blocking (&configuration->semaphore);
+
+    /*
+     * Some of the requests of this sweep went unanswered: what is not
+     * confirmed may still come from the flash, so the cache stays as
+     * it is, and so does identity_cached.
+     */
+    needed = identity_cache_needed (configuration);
+
+    if ((configuration->identity_answered & needed) != needed)
+    {
+        sem_release (&configuration->semaphore);
+        return 0;
+    }
+
+    memcpy (cache->model, configuration->model, sizeof (cache->model));
+    cache->fw_major = configuration->fw_major;
+    cache->fw_minor = configuration->fw_minor;
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        memcpy (cache->zones[i], configuration->zones[i].name,
+                sizeof (cache->zones[i]));
+    }
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        memcpy (cache->partitions[i], configuration->partitions[i].name,
+                sizeof (cache->partitions[i]));
+    }
+
+    /* the panel has now answered for everything that was cached */
+    configuration_update_bool (configuration,
+                               &configuration->identity_cached, false,
+                               &configuration->identity_generation);
+    configuration_commit (configuration);
+
+    sem_release (&configuration->semaphore);
+
+    cache->magic = IDENTITY_CACHE_MAGIC;
+    cache->length = sizeof (identity_cache_t);
+    cache->crc = crc32 (cache, offsetof (identity_cache_t, crc));
+
+    if (memcmp (flash_store_data (configuration->identity_offset), cache,
+                sizeof (identity_cache_t)) == 0)
+    {
+        return 0;
+    }
+
+    LOG_RING_INFO ("identity_cache_save: writing flash");
+
+    if (flash_store_erase (configuration->identity_offset, FLASH_SECTOR_SIZE) != 0 ||
+        flash_store_program (configuration->identity_offset, identity_cache_pages,
+                             sizeof (identity_cache_pages)) != 0)
+    {
+        return -1;
+    }
+
+    return 1;
+}
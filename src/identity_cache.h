@@ -0,0 +1,31 @@
+#ifndef _identity_cache_h_
+#define _identity_cache_h_
+
+#include "configuration.h"
+
+/*
+ * Warm-start cache of the parts of the configuration that almost never
+ * change: model, firmware version, zone and partition names. They take
+ * 11 requests to the panel (about 700 bytes at 9600 baud), so they are
+ * kept in flash, and loaded at boot before the panel has answered.
+ *
+ * The state machine re-reads them from the panel in the background,
+ * and calls identity_cache_save() at the end of every sweep; the flash
+ * is only written when the panel answered every request of the sweep,
+ * and its answers differ from the cache.
+ */
+
+/*
+ * Called from configuration_start(), before anything else uses the
+ * configuration. Returns 0 and sets configuration->identity_cached if
+ * a valid cache was found.
+ */
+int identity_cache_load (configuration_t * configuration);
+
+/*
+ * Returns 1 if the flash was written, 0 if it was already up to date
+ * (or the sweep is incomplete), -1 on error.
+ */
+int identity_cache_save (configuration_t * configuration);
+
+#endif /* _identity_cache_h_ */
@@ -0,0 +1,213 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <pico/critical_section.h>
+#include <pico/time.h>
+
+#include "log_ring.h"
+
+#define LOG_RING_INTERVAL_US (1000000u / LOG_RING_RATE)
+
+volatile log_level_t log_ring_level = LOG_RING_LEVEL;
+
+static const char log_ring_levels[LOG_LEVELS] = { 'E', 'W', 'I', 'D' };
+
+static char log_ring_buffer[LOG_RING_SIZE];
+
+static critical_section_t log_ring_critsec;
+static volatile bool log_ring_started = false;
+
+/* under log_ring_critsec */
+static uint32_t log_ring_head;
+static uint32_t log_ring_tail;
+static uint32_t log_ring_credit_us = LOG_RING_BURST * LOG_RING_INTERVAL_US;
+static uint64_t log_ring_last_us;
+static log_ring_stats_t log_ring_stats;
+
+/* of the flushing thread */
+static uint32_t log_ring_reported_suppressed;
+static uint32_t log_ring_reported_dropped;
+
+void
+log_ring_start (void)
+{
+    critical_section_init (&log_ring_critsec);
+    log_ring_last_us = to_us_since_boot (get_absolute_time ());
+    log_ring_started = true;
+}
+
+/* a token bucket: LOG_RING_INTERVAL_US of credit per line */
+static bool
+log_ring_admit (uint64_t now)
+{
+    uint64_t credit;
+
+    credit = log_ring_credit_us + (now - log_ring_last_us);
+    log_ring_last_us = now;
+
+    if (credit > LOG_RING_BURST * LOG_RING_INTERVAL_US)
+    {
+        credit = LOG_RING_BURST * LOG_RING_INTERVAL_US;
+    }
+
+    if (credit < LOG_RING_INTERVAL_US)
+    {
+        log_ring_credit_us = credit;
+        log_ring_stats.suppressed++;
+        return false;
+    }
+
+    log_ring_credit_us = credit - LOG_RING_INTERVAL_US;
+
+    return true;
+}
+
+void
+log_ring_write (log_level_t level, const char * format, ...)
+{
+    char line[LOG_RING_LINE_MAX];
+    va_list args;
+    uint64_t now;
+    uint32_t first;
+    int len;
+    int n;
+
+    if (!log_ring_started || (unsigned) level >= LOG_LEVELS)
+    {
+        return;
+    }
+
+    now = to_us_since_boot (get_absolute_time ());
+
+    critical_section_enter_blocking (&log_ring_critsec);
+
+    if (!log_ring_admit (now))
+    {
+        critical_section_exit (&log_ring_critsec);
+        return;
+    }
+
+    critical_section_exit (&log_ring_critsec);
+
+    len = snprintf (line, sizeof (line), "%lu.%03lu %c ",
+                    (unsigned long) (now / 1000000u),
+                    (unsigned long) (now / 1000u % 1000u),
+                    log_ring_levels[level]);
+
+    va_start (args, format);
+    n = vsnprintf (&line[len], sizeof (line) - len, format, args);
+    va_end (args);
+
+    /* truncated lines keep their newline */
+    len = (n < 0) ? len :
+        (len + n < (int) sizeof (line) - 1) ? len + n : (int) sizeof (line) - 2;
+    line[len++] = '\n';
+
+    critical_section_enter_blocking (&log_ring_critsec);
+
+    if (LOG_RING_SIZE - (log_ring_head - log_ring_tail) < (uint32_t) len)
+    {
+        log_ring_stats.dropped++;
+    }
+    else
+    {
+        first = LOG_RING_SIZE - (log_ring_head % LOG_RING_SIZE);
+        first = (first < (uint32_t) len) ? first : (uint32_t) len;
+
+        memcpy (&log_ring_buffer[log_ring_head % LOG_RING_SIZE], line, first);
+        memcpy (log_ring_buffer, &line[first], len - first);
+
+        log_ring_head += len;
+        log_ring_stats.written++;
+    }
+
+    critical_section_exit (&log_ring_critsec);
+}
+
+int
+log_ring_flush (FILE * f)
+{
+    char chunk[LOG_RING_LINE_MAX];
+    log_ring_stats_t stats;
+    uint32_t n;
+    int flushed = 0;
+
+    if (!log_ring_started)
+    {
+        return 0;
+    }
+
+    /* copied out in chunks, so that the writers wait for a memcpy only */
+    for (;;)
+    {
+        critical_section_enter_blocking (&log_ring_critsec);
+
+        n = log_ring_head - log_ring_tail;
+        n = (n < sizeof (chunk)) ? n : sizeof (chunk);
+        n = (n < LOG_RING_SIZE - log_ring_tail % LOG_RING_SIZE) ?
+            n : LOG_RING_SIZE - log_ring_tail % LOG_RING_SIZE;
+
+        memcpy (chunk, &log_ring_buffer[log_ring_tail % LOG_RING_SIZE], n);
+        log_ring_tail += n;
+
+        stats = log_ring_stats;
+
+        critical_section_exit (&log_ring_critsec);
+
+        if (n == 0)
+        {
+            break;
+        }
+
+        fwrite (chunk, 1, n, f);
+        flushed += n;
+    }
+
+    if (stats.suppressed != log_ring_reported_suppressed ||
+        stats.dropped != log_ring_reported_dropped)
+    {
+        flushed += fprintf (f, "log: %lu suppressed, %lu dropped\n",
+                            (unsigned long) (stats.suppressed -
+                                             log_ring_reported_suppressed),
+                            (unsigned long) (stats.dropped -
+                                             log_ring_reported_dropped));
+        log_ring_reported_suppressed = stats.suppressed;
+        log_ring_reported_dropped = stats.dropped;
+    }
+
+    if (flushed > 0)
+    {
+        fflush (f);
+    }
+
+    return flushed;
+}
+
+int
+log_ring_set_level (uint32_t level)
+{
+    if (level >= LOG_LEVELS)
+    {
+        return -1;
+    }
+
+    log_ring_level = (log_level_t) level;
+
+    return 0;
+}
+
+void
+log_ring_get_stats (log_ring_stats_t * stats)
+{
+    if (!log_ring_started)
+    {
+        memset (stats, 0, sizeof (*stats));
+        return;
+    }
+
+    critical_section_enter_blocking (&log_ring_critsec);
+    *stats = log_ring_stats;
+    stats->pending = log_ring_head - log_ring_tail;
+    critical_section_exit (&log_ring_critsec);
+}
@@ -0,0 +1,95 @@
+#ifndef _log_ring_h_
+#define _log_ring_h_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * The log of the panel stack, the event log, the identity cache and
+ * MQTT: leveled, rate limited, and written to a RAM ring instead of to
+ * stdout, so that logging from an interrupt costs a vsnprintf and a
+ * copy, not the time the UART takes to send the line.
+ *
+ * - LOG_RING_ERROR () ... LOG_RING_DEBUG () log a line (without the
+ *   newline) if its level is at most log_ring_level; above it they only
+ *   cost a compare, the arguments are not evaluated. The level is set
+ *   at runtime with log_ring_set_level () (/log?level=n); at boot it is
+ *   LOG_RING_LEVEL, INFO unless given to cmake.
+ * - at most LOG_RING_RATE lines per second are kept, in bursts of up to
+ *   LOG_RING_BURST; the others are counted as suppressed. A line that
+ *   does not fit in the ring is counted as dropped.
+ * - log_ring_flush () writes what is in the ring, from one thread only:
+ *   the main loop of core0 in the firmware (see main.c), the main loop
+ *   of the host programs. Each line has the ms since boot and the level.
+ *
+ * Nothing is kept before log_ring_start ().
+ */
+
+#ifndef LOG_RING_SIZE
+/* bytes, a power of 2 */
+#define LOG_RING_SIZE (4096)
+#endif
+
+#define LOG_RING_LINE_MAX (128)
+#define LOG_RING_RATE (20)
+#define LOG_RING_BURST (40)
+
+typedef enum _log_level_t log_level_t;
+
+enum _log_level_t
+{
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVELS,
+};
+
+#ifndef LOG_RING_LEVEL
+#define LOG_RING_LEVEL LOG_LEVEL_INFO
+#endif
+
+typedef struct _log_ring_stats_t log_ring_stats_t;
+
+struct _log_ring_stats_t
+{
+    uint32_t written;
+    uint32_t suppressed;
+    uint32_t dropped;
+    uint32_t pending;
+};
+
+extern volatile log_level_t log_ring_level;
+
+#define LOG_RING(level, ...)                                    \
+    do                                                          \
+    {                                                           \
+        if ((level) <= log_ring_level)                          \
+        {                                                       \
+            log_ring_write ((level), __VA_ARGS__);              \
+        }                                                       \
+    } while (0)
+
+#define LOG_RING_ERROR(...) LOG_RING (LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_RING_WARN(...) LOG_RING (LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_RING_INFO(...) LOG_RING (LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_RING_DEBUG(...) LOG_RING (LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+void log_ring_start (void);
+
+void log_ring_write (log_level_t level, const char * format, ...)
+    __attribute__ ((format (printf, 2, 3)));
+
+/*
+ * Write the lines in the ring to f, and a line with the count of those
+ * suppressed and dropped since the last flush, if any. Returns the
+ * bytes written.
+ */
+int log_ring_flush (FILE * f);
+
+/* Returns -1 if level is not a log_level_t. */
+int log_ring_set_level (uint32_t level);
+
+void log_ring_get_stats (log_ring_stats_t * stats);
+
+#endif /* _log_ring_h_ */
@@ -8,9 +8,13 @@
 #include <stdio.h>
 #include <stdint.h>
 
-#include "bentel_layer.h"
-#include "state_machine.h"
-#include "configuration.h"
+#include "panel.h"
+#include "mqtt_publisher.h"
+#include "flash_store.h"
+#include "perf.h"
+#include "trace.h"
+#include "ram_stats.h"
+#include "log_ring.h"
 
 #include "pico/stdio_uart.h"
 #include "pico/cyw43_arch.h"
@@ -76,6 +80,14 @@ static critical_section_t temp_critsec, rssi_critsec, linkup_critsec;
 /* repeating_timer object for rssi updates */
 static repeating_timer_t rssi_timer;
 
+/*
+ * The heaps and the lwIP pools of /ram are sampled from the main loop
+ * of core0, in the lwIP context. The repeating timer paces the samples
+ * as for rssi in poll mode, see ram_stats.h
+ */
+static repeating_timer_t ram_stats_timer;
+static volatile bool ram_stats_ready = false;
+
 #if PICO_CYW43_ARCH_POLL
 /*
  * In poll mode, rssi updates must be called from the main loop. So the
@@ -175,6 +187,26 @@ __time_critical_func(rssi_poll)(repeating_timer_t *rt)
 }
 #endif
 
+/* Callback for the repeating_timer that paces the samples for /ram. */
+static bool
+__time_critical_func(ram_stats_due)(repeating_timer_t *rt)
+{
+    (void)rt;
+    ram_stats_ready = true;
+    return true;
+}
+
+static void
+ram_stats_poll(void)
+{
+    if (!ram_stats_ready)
+        return;
+    ram_stats_ready = false;
+    cyw43_arch_lwip_begin();
+    ram_stats_sample();
+    cyw43_arch_lwip_end();
+}
+
 static void
 start_rssi_poll(repeating_timer_callback_t cb)
 {
@@ -206,7 +238,13 @@ start_rssi_poll(repeating_timer_callback_t cb)
 void
 core1_main(void)
 {
-    extern state_machine_t state_machine;
+    int i;
+
+    /* The stack high water mark of /ram, see ram_stats.h */
+    ram_stats_paint_stack();
+
+    /* The cycle counters of /perf, see perf.h */
+    perf_core_start();
 
     /* Initiate asynchronous ADC temperature sensor reads */
     adc_init();
@@ -236,11 +274,24 @@ core1_main(void)
     start_rssi_poll(rssi_update);
 #endif
 
-    for (;;)
-    {
-        //__wfi();
-        state_machine_next (&state_machine);
-	sleep_ms (1000);
+    /*
+     * Poll the panels, and wake up early when a command is queued from
+     * the HTTP handlers. See state_machine.h
+     */
+    for (;;) {
+        uint32_t wait = STATE_MACHINE_POLL_MS;
+
+        for (i = 0; i < panel_count (); i++) {
+            perf_stamp_t start;
+            uint32_t w;
+
+            perf_begin(&start);
+            w = state_machine_next (panel_get (i)->state_machine);
+            perf_end(PERF_STATE_MACHINE_NEXT, &start);
+            if (w < wait)
+                wait = w;
+        }
+        state_machine_wait (wait);
     }
 }
 
@@ -253,9 +304,13 @@ main(void)
     struct netif *netif;
     uint8_t mac[6];
     err_t err;
-    extern bentel_layer_t bentel_layer;
-    extern state_machine_t state_machine;
-    extern configuration_t configuration;
+    int i;
+#ifdef MQTT_BROKER
+    extern mqtt_publisher_t mqtt_publisher;
+#endif
+#ifdef TRACE_SIZE
+    extern trace_t trace_rings[TRACE_CORES];
+#endif
 
     /* For picotool info */
     bi_decl(bi_program_feature("hostname: " CYW43_HOST_NAME));
@@ -273,15 +328,36 @@ main(void)
 #else
     bi_decl(bi_program_feature("TLS: no"));
 #endif
+#ifdef MQTT_BROKER
+    bi_decl(bi_program_feature("MQTT broker: " MQTT_BROKER));
+#endif
+
+    ram_stats_paint_stack();
+    perf_core_start();
+
+#ifdef TRACE_SIZE
+    /* Before anything is traced, see trace.h */
+    if (trace_start(trace_rings) != 0)
+        HTTP_LOG_ERROR("TRACE_SIZE must be a power of 2");
+#endif
+
+    /* Before anything is logged, see log_ring.h */
+    log_ring_start();
 
     /* Initialize the critical sections */
     critical_section_init(&temp_critsec);
     critical_section_init(&linkup_critsec);
     critical_section_init(&rssi_critsec);
 
-    configuration_start (&configuration);
-    state_machine_start (&state_machine);
-    bentel_layer_start (&bentel_layer);
+    /*
+     * core1 writes the identity cache and the event log to flash, and
+     * needs to park core0 while it does.
+     */
+    if (flash_store_start () != 0)
+        return -1;
+
+    for (i = 0; i < panel_count (); i++)
+        panel_start (panel_get (i));
 
     /*
      * Launch core1. The code preceding multicore_launch_core1()
@@ -376,16 +452,30 @@ main(void)
         HTTP_LOG_ERROR("Could not get mac address");
     cyw43_arch_lwip_end();
 
+#ifdef MQTT_BROKER
+    /*
+     * If an MQTT broker was named at compile time, publish the panel
+     * state to it. The publisher runs from the cyw43_arch async
+     * context, and connects (and reconnects) to the broker on its
+     * own, so a broker that is not reachable yet is not an error.
+     */
+    if (mqtt_publisher_start(&mqtt_publisher) != 0)
+        HTTP_LOG_ERROR("Could not start the MQTT publisher for "
+                       MQTT_BROKER);
+#endif
+
     /*
      * Start with the default configuration for the HTTP server.
      *
      * If an NTP server was named at compile time, set it here.  We
      * set a longer idle timeout than specified in the default
-     * configuration, since Javascript code runs updates every few
-     * seconds for /temp and /rssi (to update the temperature and
-     * signal strength in the UI). Most browsers leave connections
-     * established after a page is loaded, so keep them open to be
-     * re-used for the updates.
+     * configuration, since Javascript code polls /delta every few
+     * seconds (to update the panel state, temperature and signal
+     * strength in the UI), and Home Assistant polls /ha. Most
+     * browsers leave connections established after a page is loaded,
+     * so keep them open to be re-used for the updates. One-shot
+     * endpoints ask the client to close instead (see set_conn_policy()
+     * in handlers.c).
      *
      * See: https://slimhazard.gitlab.io/picow_http/group__server.html#ga3380001925d9eb091370db86d85f7349
      */
@@ -393,7 +483,7 @@ main(void)
 #ifdef NTP_SERVER
     cfg.ntp_cfg.server = NTP_SERVER;
 #endif
-    cfg.idle_tmo_s = 30;
+    cfg.idle_tmo_s = POLL_IDLE_TMO_S;
 
     /*
      * Before the http server starts, register the custom handlers for
@@ -410,40 +500,139 @@ main(void)
      * registering before server start, we ensure that the handlers
      * are available right away.
      *
+     * Every handler is registered through timed_handler(), so that its
+     * cycles are counted in /perf; timed_priv() holds the handler and
+     * its private data.
+     *
      * See: https://slimhazard.gitlab.io/picow_http/group__resp.html#gac4ee42ee6a8559778bb486dcb6253cfe
      */
-    if ((err = register_hndlr_methods(&cfg, "/netinfo", netinfo_handler,
-                      HTTP_METHODS_GET_HEAD, &netinfo))
+    if ((err = register_hndlr_methods(&cfg, "/netinfo", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_NETINFO, netinfo_handler,
+                                 &netinfo)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /netinfo: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/temp", temp_handler,
-                      HTTP_METHODS_GET_HEAD, NULL))
+    if ((err = register_hndlr_methods(&cfg, "/temp", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_TEMP, temp_handler, NULL)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /temp: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/led", led_handler,
-                      HTTP_METHODS_GET_HEAD, NULL))
+    if ((err = register_hndlr_methods(&cfg, "/led", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_LED, led_handler, NULL)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /led: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/rssi", rssi_handler,
-                      HTTP_METHODS_GET_HEAD, NULL))
+    if ((err = register_hndlr_methods(&cfg, "/rssi", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_RSSI, rssi_handler, NULL)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /rssi: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/ha", ha_handler,
-                      HTTP_METHODS_GET_HEAD, &netinfo))
+    if ((err = register_hndlr_methods(&cfg, "/ha", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_HA, ha_handler, &netinfo)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /ha: %d", err);
         return -1;
     }
-    if ((err = register_hndlr_methods(&cfg, "/bootloader", bootloader_handler,
-                      HTTP_METHODS_GET_HEAD, NULL))
+    if ((err = register_hndlr_methods(&cfg, "/delta", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_DELTA, delta_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /delta: %d", err);
+        return -1;
+    }
+#if PICOW_HTTPS
+    if ((err = register_hndlr_methods(&cfg, "/tls", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_TLS, tls_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /tls: %d", err);
+        return -1;
+    }
+#endif
+    if ((err = register_hndlr_methods(&cfg, "/connections", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_CONNECTIONS, connections_handler,
+                                 NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /connections: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/events", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_EVENTS, events_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /events: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/panels", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_PANELS, panels_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /panels: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/command", timed_handler,
+                      HTTP_METHODS_GET_HEAD | (1U << HTTP_METHOD_POST),
+                      timed_priv(PERF_HTTP_COMMAND, command_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /command: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/batch", timed_handler,
+                      HTTP_METHODS_GET_HEAD | (1U << HTTP_METHOD_POST),
+                      timed_priv(PERF_HTTP_BATCH, batch_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /batch: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/capture", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_CAPTURE, capture_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /capture: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/perf", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_PERF, perf_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /perf: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/trace", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_TRACE, trace_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /trace: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/ram", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_RAM, ram_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /ram: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/log", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_LOG, log_handler, NULL)))
+        != ERR_OK) {
+        HTTP_LOG_ERROR("Register /log: %d", err);
+        return -1;
+    }
+    if ((err = register_hndlr_methods(&cfg, "/bootloader", timed_handler,
+                      HTTP_METHODS_GET_HEAD,
+                      timed_priv(PERF_HTTP_BOOTLOADER, bootloader_handler,
+                                 NULL)))
         != ERR_OK) {
         HTTP_LOG_ERROR("Register /bootloader: %d", err);
         return -1;
@@ -460,11 +649,18 @@ main(void)
     HTTP_LOG_INFO("http started");
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, true);
 
+    /* The samples for /ram, taken in the loops below. */
+    ram_stats_ready = true;
+    if (!add_repeating_timer_ms(-RAM_STATS_INTVL_MS, ram_stats_due, NULL,
+                                &ram_stats_timer))
+        HTTP_LOG_ERROR("Failed to start timer to sample /ram");
+
 #if PICO_CYW43_ARCH_POLL
     /*
      * After the server starts, in poll mode we must periodically call
      * cyw43_arch_poll(). Check if the timer has set the boolean to
-     * indicate that timeout for rssi updates has expired.
+     * indicate that timeout for rssi updates has expired, and write out
+     * what was logged, see log_ring.h
      */
     for (;;) {
         cyw43_arch_poll();
@@ -472,16 +668,23 @@ main(void)
             rssi_ready = false;
             (void)rssi_update(NULL);
         }
+        ram_stats_poll();
+        log_ring_flush(stdout);
         cyw43_arch_wait_for_work_until(
             make_timeout_time_ms(POLL_SLEEP_MS));
     }
 #else
     /*
      * Background mode is entirely interrupt-driven. So we use WFI to
-     * let the processor sleep until an interrupt is called.
+     * let the processor sleep until an interrupt is called; the timer
+     * for /ram wakes it up for the samples. What was logged meanwhile
+     * is written out here, see log_ring.h
      */
-    for (;;)
+    for (;;) {
         __wfi();
+        ram_stats_poll();
+        log_ring_flush(stdout);
+    }
 #endif
 
     /* Unreachable */
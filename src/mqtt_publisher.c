@@ -0,0 +1,524 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/cyw43_arch.h"
+#include "lwip/ip_addr.h"
+
+#include "log_ring.h"
+#include "mqtt_publisher.h"
+#include "render.h"
+
+#define MQTT_TOPIC_PREFIX "bentel/" CYW43_HOST_NAME
+#define MQTT_STATUS_TOPIC MQTT_TOPIC_PREFIX "/status"
+#define MQTT_DISCOVERY_PREFIX "homeassistant"
+#define MQTT_UNIQUE_ID "bentel_" CYW43_HOST_NAME
+
+#define MQTT_QOS 1
+#define MQTT_KEEP_ALIVE_S 60
+
+/*
+ * The configuration is checked for changes every MQTT_PUBLISH_INTVL_MS,
+ * which is well below the time the panel needs to answer a request, so
+ * a change reaches the broker within one panel cycle.
+ */
+#define MQTT_PUBLISH_INTVL_MS 100
+#define MQTT_RECONNECT_INTVL_MS (5 * 1000)
+
+#define MQTT_TOPIC_LEN 96
+#define MQTT_PAYLOAD_LEN 384
+
+/* Order of the discovery payloads, see mqtt_publisher_discovery() */
+#define MQTT_DISCOVERY_ZONES 0
+#define MQTT_DISCOVERY_PARTITIONS (MQTT_DISCOVERY_ZONES + 32)
+#define MQTT_DISCOVERY_OUTPUTS (MQTT_DISCOVERY_PARTITIONS + 8)
+#define MQTT_DISCOVERY_FAULTS (MQTT_DISCOVERY_OUTPUTS + 16)
+#define MQTT_DISCOVERY_END (MQTT_DISCOVERY_FAULTS + MQTT_PUBLISHER_FAULTS)
+
+static const struct
+{
+    const char * name;
+    size_t offset;
+} faults[MQTT_PUBLISHER_FAULTS] =
+{
+    { "alarm_power", offsetof (configuration_t, alarm_power) },
+    { "alarm_bpi", offsetof (configuration_t, alarm_bpi) },
+    { "alarm_fuse", offsetof (configuration_t, alarm_fuse) },
+    { "alarm_battery_low", offsetof (configuration_t, alarm_battery_low) },
+    { "alarm_telephone_line", offsetof (configuration_t, alarm_telephone_line) },
+    { "alarm_default_codes", offsetof (configuration_t, alarm_default_codes) },
+    { "alarm_wireless", offsetof (configuration_t, alarm_wireless) },
+    { "sabotage_partition", offsetof (configuration_t, sabotage_partition) },
+    { "sabotage_fake_key", offsetof (configuration_t, sabotage_fake_key) },
+    { "sabotage_bpi", offsetof (configuration_t, sabotage_bpi) },
+    { "sabotage_system", offsetof (configuration_t, sabotage_system) },
+    { "sabotage_jam", offsetof (configuration_t, sabotage_jam) },
+    { "sabotage_wireless", offsetof (configuration_t, sabotage_wireless) },
+    { "siren_state", offsetof (configuration_t, siren_state) },
+};
+
+static const struct mqtt_connect_client_info_t client_info =
+{
+    .client_id = MQTT_UNIQUE_ID,
+    .keep_alive = MQTT_KEEP_ALIVE_S,
+    .will_topic = MQTT_STATUS_TOPIC,
+    .will_msg = "offline",
+    .will_qos = MQTT_QOS,
+    .will_retain = 1,
+};
+
+static bool
+fault_value (configuration_t * configuration, int i)
+{
+    return *(bool *) ((char *) configuration + faults[i].offset);
+}
+
+static err_t
+mqtt_publisher_publish (mqtt_publisher_t * publisher, const char * topic,
+                        const char * payload, int len)
+{
+    err_t err;
+
+    err = mqtt_publish (publisher->client, topic, payload, len,
+                        MQTT_QOS, 1, NULL, NULL);
+
+    if (err == ERR_OK)
+    {
+        publisher->published++;
+    }
+
+    return err;
+}
+
+/*
+ * Home Assistant MQTT discovery, one binary_sensor per entity. The
+ * abbreviated keys are documented at
+ * https://www.home-assistant.io/integrations/mqtt/#discovery-messages
+ */
+static int
+mqtt_publisher_discovery (int i, char * topic, char * payload)
+{
+    char object[32];
+    char name[32];
+    char state[MQTT_TOPIC_LEN];
+    char attributes[MQTT_TOPIC_LEN + 20];
+    const char * options;
+    bool json;
+
+    if (i < MQTT_DISCOVERY_PARTITIONS)
+    {
+        i -= MQTT_DISCOVERY_ZONES;
+        snprintf (object, sizeof (object), "zone_%d", i);
+        snprintf (name, sizeof (name), "Zone %d", i + 1);
+        snprintf (state, sizeof (state), MQTT_TOPIC_PREFIX "/zone/%d", i);
+        options = "\"val_tpl\":\"{{value_json.alarm}}\","
+                  "\"pl_on\":\"1\",\"pl_off\":\"0\",";
+        json = true;
+    }
+    else if (i < MQTT_DISCOVERY_OUTPUTS)
+    {
+        i -= MQTT_DISCOVERY_PARTITIONS;
+        snprintf (object, sizeof (object), "partition_%d", i);
+        snprintf (name, sizeof (name), "Partition %d armed", i + 1);
+        snprintf (state, sizeof (state), MQTT_TOPIC_PREFIX "/partition/%d", i);
+        options = "\"val_tpl\":\"{{value_json.armed}}\","
+                  "\"pl_on\":\"1\",\"pl_off\":\"0\",";
+        json = true;
+    }
+    else if (i < MQTT_DISCOVERY_FAULTS)
+    {
+        i -= MQTT_DISCOVERY_OUTPUTS;
+        snprintf (object, sizeof (object), "output_%d", i);
+        snprintf (name, sizeof (name), "Output %d", i + 1);
+        snprintf (state, sizeof (state), MQTT_TOPIC_PREFIX "/output/%d", i);
+        options = "";
+        json = false;
+    }
+    else
+    {
+        i -= MQTT_DISCOVERY_FAULTS;
+        snprintf (object, sizeof (object), "%s", faults[i].name);
+        snprintf (name, sizeof (name), "%s", faults[i].name);
+        snprintf (state, sizeof (state), MQTT_TOPIC_PREFIX "/fault/%s",
+                  faults[i].name);
+        options = "\"dev_cla\":\"problem\",";
+        json = false;
+    }
+
+    snprintf (topic, MQTT_TOPIC_LEN,
+              MQTT_DISCOVERY_PREFIX "/binary_sensor/" MQTT_UNIQUE_ID "/%s/config",
+              object);
+
+    /*
+     * zones and partitions carry their name in the JSON state, expose it
+     * (and the other flags) as attributes
+     */
+    attributes[0] = '\0';
+
+    if (json)
+    {
+        snprintf (attributes, sizeof (attributes),
+                  "\"json_attr_t\":\"%s\",", state);
+    }
+
+    return snprintf (payload, MQTT_PAYLOAD_LEN,
+                     "{\"name\":\"%s\",\"uniq_id\":\"" MQTT_UNIQUE_ID "_%s\","
+                     "\"stat_t\":\"%s\",%s%s"
+                     "\"avty_t\":\"" MQTT_STATUS_TOPIC "\","
+                     "\"dev\":{\"ids\":[\"" MQTT_UNIQUE_ID "\"],"
+                     "\"name\":\"Bentel " CYW43_HOST_NAME "\","
+                     "\"mf\":\"Bentel Security\"}}",
+                     name, object, state, options, attributes);
+}
+
+/* zones and partitions beyond the capacity of the panel are not announced */
+static bool
+mqtt_publisher_discovery_needed (mqtt_publisher_t * publisher, int i)
+{
+    const capacity_t * capacity;
+
+    capacity = publisher->configuration->capacity;
+
+    if (i < MQTT_DISCOVERY_PARTITIONS)
+    {
+        return i - MQTT_DISCOVERY_ZONES < capacity->zones;
+    }
+
+    if (i < MQTT_DISCOVERY_OUTPUTS)
+    {
+        return i - MQTT_DISCOVERY_PARTITIONS < capacity->partitions;
+    }
+
+    return true;
+}
+
+static bool
+mqtt_publisher_publish_discovery (mqtt_publisher_t * publisher)
+{
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    int len;
+
+    /* wait for the model, and so the capacity, to be known */
+    if (publisher->configuration->model[0] == '\0')
+    {
+        return false;
+    }
+
+    while (publisher->discovery < MQTT_DISCOVERY_END)
+    {
+        if (!mqtt_publisher_discovery_needed (publisher, publisher->discovery))
+        {
+            publisher->discovery++;
+            continue;
+        }
+
+        len = mqtt_publisher_discovery (publisher->discovery, topic, payload);
+
+        if (len < 0 || len >= MQTT_PAYLOAD_LEN)
+        {
+            publisher->dropped++;
+        }
+        else if (mqtt_publisher_publish (publisher, topic, payload, len)
+                 != ERR_OK)
+        {
+            /* output buffer full, resume from here on the next run */
+            return false;
+        }
+
+        publisher->discovery++;
+    }
+
+    return true;
+}
+
+/*
+ * Must be called with the configuration semaphore held. Returns false
+ * if the MQTT client could not take more messages; the remaining
+ * entities are still marked as changed and go out on the next run.
+ */
+static bool
+mqtt_publisher_publish_states (mqtt_publisher_t * publisher)
+{
+    configuration_t * configuration;
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    const char * value;
+    int len;
+    int i;
+
+    configuration = publisher->configuration;
+
+    for (i = 0 ; i < configuration->capacity->zones ; i++)
+    {
+        if (publisher->zones[i].sent &&
+            publisher->zones[i].generation == configuration->zones[i].generation)
+        {
+            continue;
+        }
+
+        len = render_zone (payload, sizeof (payload), configuration, i);
+        snprintf (topic, sizeof (topic), MQTT_TOPIC_PREFIX "/zone/%d", i);
+
+        if (len < 0)
+        {
+            publisher->dropped++;
+        }
+        else if (mqtt_publisher_publish (publisher, topic, payload, len) != ERR_OK)
+        {
+            return false;
+        }
+
+        publisher->zones[i].sent = true;
+        publisher->zones[i].generation = configuration->zones[i].generation;
+    }
+
+    for (i = 0 ; i < configuration->capacity->partitions ; i++)
+    {
+        if (publisher->partitions[i].sent &&
+            publisher->partitions[i].generation == configuration->partitions[i].generation)
+        {
+            continue;
+        }
+
+        len = render_partition (payload, sizeof (payload), configuration, i);
+        snprintf (topic, sizeof (topic), MQTT_TOPIC_PREFIX "/partition/%d", i);
+
+        if (len < 0)
+        {
+            publisher->dropped++;
+        }
+        else if (mqtt_publisher_publish (publisher, topic, payload, len) != ERR_OK)
+        {
+            return false;
+        }
+
+        publisher->partitions[i].sent = true;
+        publisher->partitions[i].generation = configuration->partitions[i].generation;
+    }
+
+    for (i = 0 ; i < 16 ; i++)
+    {
+        if (publisher->outputs[i].sent &&
+            publisher->outputs[i].generation == configuration->digital_outputs[i].generation)
+        {
+            continue;
+        }
+
+        value = configuration->digital_outputs[i].active ? "ON" : "OFF";
+        snprintf (topic, sizeof (topic), MQTT_TOPIC_PREFIX "/output/%d", i);
+
+        if (mqtt_publisher_publish (publisher, topic, value, strlen (value)) != ERR_OK)
+        {
+            return false;
+        }
+
+        publisher->outputs[i].sent = true;
+        publisher->outputs[i].generation = configuration->digital_outputs[i].generation;
+    }
+
+    for (i = 0 ; i < MQTT_PUBLISHER_FAULTS ; i++)
+    {
+        if (publisher->faults[i].sent &&
+            publisher->faults[i].value == fault_value (configuration, i))
+        {
+            continue;
+        }
+
+        value = fault_value (configuration, i) ? "ON" : "OFF";
+        snprintf (topic, sizeof (topic), MQTT_TOPIC_PREFIX "/fault/%s",
+                  faults[i].name);
+
+        if (mqtt_publisher_publish (publisher, topic, value, strlen (value)) != ERR_OK)
+        {
+            return false;
+        }
+
+        publisher->faults[i].sent = true;
+        publisher->faults[i].value = fault_value (configuration, i);
+    }
+
+    return true;
+}
+
+static void
+mqtt_publisher_forget (mqtt_publisher_t * publisher)
+{
+    int i;
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        publisher->zones[i].sent = false;
+    }
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+        publisher->partitions[i].sent = false;
+    }
+
+    for (i = 0 ; i < 16 ; i++)
+    {
+        publisher->outputs[i].sent = false;
+    }
+
+    for (i = 0 ; i < MQTT_PUBLISHER_FAULTS ; i++)
+    {
+        publisher->faults[i].sent = false;
+    }
+}
+
+static void
+mqtt_publisher_connection_cb (mqtt_client_t * client, void * arg,
+                              mqtt_connection_status_t status)
+{
+    mqtt_publisher_t * publisher;
+
+    publisher = (mqtt_publisher_t *) arg;
+
+    publisher->connecting = false;
+    publisher->connected = (status == MQTT_CONNECT_ACCEPTED);
+
+    if (!publisher->connected)
+    {
+        LOG_RING_WARN ("mqtt: disconnected from %s, status %d",
+                       publisher->broker, status);
+
+        /* the broker may have missed changes, send everything again */
+        mqtt_publisher_forget (publisher);
+        return;
+    }
+
+    LOG_RING_INFO ("mqtt: connected to %s:%u",
+                   publisher->broker, publisher->port);
+
+    mqtt_publisher_publish (publisher, MQTT_STATUS_TOPIC, "online", 6);
+}
+
+static void
+mqtt_publisher_connect (mqtt_publisher_t * publisher)
+{
+    ip_addr_t address;
+    err_t err;
+
+    ipaddr_aton (publisher->broker, &address);
+
+    err = mqtt_client_connect (publisher->client, &address, publisher->port,
+                               mqtt_publisher_connection_cb, publisher,
+                               &client_info);
+
+    if (err != ERR_OK)
+    {
+        LOG_RING_ERROR ("mqtt: connect to %s failed: %d",
+                        publisher->broker, err);
+        return;
+    }
+
+    publisher->connecting = true;
+}
+
+/*
+ * Runs from the cyw43_arch async context, so lwIP may be called
+ * directly.
+ */
+static void
+mqtt_publisher_work (async_context_t * context,
+                     async_at_time_worker_t * worker)
+{
+    mqtt_publisher_t * publisher;
+    configuration_t * configuration;
+    uint32_t delay;
+
+    publisher = (mqtt_publisher_t *) worker->user_data;
+    configuration = publisher->configuration;
+    delay = MQTT_PUBLISH_INTVL_MS;
+
+    if (!publisher->connected)
+    {
+        if (!publisher->connecting)
+        {
+            mqtt_publisher_connect (publisher);
+        }
+
+        delay = MQTT_RECONNECT_INTVL_MS;
+    }
+    else if (mqtt_publisher_publish_discovery (publisher))
+    {
+        sem_acquire_blocking (&configuration->semaphore);
+
+        /*
+         * generation 1 is the empty configuration: wait until the panel
+         * has answered, rather than retaining defaults on the broker
+         */
+        if (configuration->generation > 1)
+        {
+            mqtt_publisher_publish_states (publisher);
+        }
+
+        sem_release (&configuration->semaphore);
+    }
+
+    async_context_add_at_time_worker_in_ms (context, worker, delay);
+}
+
+int
+mqtt_publisher_start (void * layer)
+{
+    mqtt_publisher_t * publisher;
+    ip_addr_t address;
+
+    publisher = (mqtt_publisher_t *) layer;
+
+    if (!ipaddr_aton (publisher->broker, &address))
+    {
+        LOG_RING_ERROR ("mqtt: invalid broker address %s",
+                        publisher->broker);
+        return -1;
+    }
+
+    publisher->connecting = false;
+    publisher->connected = false;
+    publisher->discovery = 0;
+    publisher->published = 0;
+    publisher->dropped = 0;
+    mqtt_publisher_forget (publisher);
+
+    cyw43_arch_lwip_begin ();
+    publisher->client = mqtt_client_new ();
+    cyw43_arch_lwip_end ();
+
+    if (publisher->client == NULL)
+    {
+        return -1;
+    }
+
+    publisher->context = cyw43_arch_async_context ();
+    publisher->worker.do_work = mqtt_publisher_work;
+    publisher->worker.user_data = publisher;
+
+    if (!async_context_add_at_time_worker_in_ms (publisher->context,
+                                                 &publisher->worker, 0))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+mqtt_publisher_stop (void * layer)
+{
+    mqtt_publisher_t * publisher;
+
+    publisher = (mqtt_publisher_t *) layer;
+
+    async_context_remove_at_time_worker (publisher->context,
+                                         &publisher->worker);
+
+    cyw43_arch_lwip_begin ();
+    mqtt_disconnect (publisher->client);
+    mqtt_client_free (publisher->client);
+    cyw43_arch_lwip_end ();
+
+    publisher->client = NULL;
+    publisher->connected = false;
+}
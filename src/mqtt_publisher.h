@@ -0,0 +1,76 @@
+#ifndef _mqtt_publisher_h_
+#define _mqtt_publisher_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/async_context.h"
+#include "lwip/apps/mqtt.h"
+
+#include "configuration.h"
+
+/*
+ * Publishes the configuration to an MQTT broker, one retained topic
+ * per entity:
+ *
+ * bentel/<hostname>/zone/<n>          {"name":...,"alarm":0,...}
+ * bentel/<hostname>/partition/<n>     {"name":...,"alarm":0,"armed":0}
+ * bentel/<hostname>/output/<n>        ON | OFF
+ * bentel/<hostname>/fault/<name>      ON | OFF
+ * bentel/<hostname>/status            online | offline (last will)
+ *
+ * plus Home Assistant discovery payloads under homeassistant/, sent
+ * once after boot.
+ *
+ * An entity is only published when its generation is newer than the
+ * one last published for it, so the broker sees one message per
+ * change. The faults share a single generation, so the publisher keeps
+ * a copy of the values it sent and only publishes the ones that differ.
+ */
+
+#define MQTT_PUBLISHER_FAULTS 14
+
+typedef struct _mqtt_publisher_t mqtt_publisher_t;
+
+struct _mqtt_publisher_t
+{
+    configuration_t * configuration;
+    const char * broker;
+    uint16_t port;
+
+    mqtt_client_t * client;
+    async_context_t * context;
+    async_at_time_worker_t worker;
+
+    bool connecting;
+    bool connected;
+
+    /** @brief next discovery payload to send, one past the last when done */
+    int discovery;
+
+    struct
+    {
+        bool sent;
+        uint32_t generation;
+    } zones[32], partitions[8], outputs[16];
+
+    struct
+    {
+        bool sent;
+        bool value;
+    } faults[MQTT_PUBLISHER_FAULTS];
+
+    uint32_t published;
+    uint32_t dropped;
+};
+
+/*
+ * Must be called after cyw43_arch_init(), and after the network link
+ * is up. The publisher connects (and reconnects) to the broker on its
+ * own from the cyw43_arch async context.
+ */
+int mqtt_publisher_start (void * layer);
+
+void mqtt_publisher_stop (void * layer);
+
+#endif /* _mqtt_publisher_h_ */
@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+#include "panel.h"
+
+extern panel_t panels[];
+extern const int panels_count;
+
+int
+panel_start (void * layer)
+{
+    panel_t * panel;
+
+    panel = (panel_t *) layer;
+
+    configuration_start (panel->configuration);
+
+    if (panel->event_log != NULL)
+    {
+        event_log_start (panel->event_log);
+    }
+
+    state_machine_start (panel->state_machine);
+
+    /* before the link, which writes to it */
+    if (panel->capture != NULL)
+    {
+        capture_start (panel->capture);
+    }
+
+    return bentel_layer_start (panel->bentel_layer);
+}
+
+void
+panel_stop (void * layer)
+{
+    panel_t * panel;
+
+    panel = (panel_t *) layer;
+
+    bentel_layer_stop (panel->bentel_layer);
+
+    if (panel->capture != NULL)
+    {
+        capture_stop (panel->capture);
+    }
+
+    configuration_stop (panel->configuration);
+}
+
+panel_t *
+panel_get (int index)
+{
+    if (index < 0 || index >= panels_count)
+    {
+        return NULL;
+    }
+
+    return &panels[index];
+}
+
+int
+panel_count (void)
+{
+    return panels_count;
+}
@@ -0,0 +1,48 @@
+#ifndef _panel_h_
+#define _panel_h_
+
+#include "bentel_layer.h"
+#include "capture.h"
+#include "configuration.h"
+#include "event_log.h"
+#include "state_machine.h"
+
+/*
+ * One monitored panel: a link (a uart_layer_t, or any layer behind the
+ * bentel layer ops), the bentel layer that frames it, the configuration
+ * it updates and the state machine that polls it.
+ *
+ * The instances are wired in variables.c, in the panels[] table;
+ * panel n is addressed by ?panel=n in the HTTP API.
+ */
+
+#define PANELS_MAX 4
+
+typedef struct _panel_t panel_t;
+
+struct _panel_t
+{
+    const char * name;
+
+    configuration_t * configuration;
+    bentel_layer_t * bentel_layer;
+    state_machine_t * state_machine;
+
+    /** @brief NULL for a panel without an event history in flash */
+    event_log_t * event_log;
+
+    /** @brief the capture of its link, for /capture, or NULL */
+    capture_t * capture;
+};
+
+/* Start the configuration, state machine and layers of the panel. */
+int panel_start (void * layer);
+
+void panel_stop (void * layer);
+
+/* The panel with the given index, or NULL. */
+panel_t * panel_get (int index);
+
+int panel_count (void);
+
+#endif /* _panel_h_ */
@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include "perf.h"
+#include "render.h"
+
+static const char * perf_names[PERF_IDS] =
+{
+    [PERF_UART_RX] = "on_uart_rx",
+    [PERF_BENTEL_RECEIVED] = "bentel_layer_received_message",
+    [PERF_BENTEL_DECODE] = "bentel_message_decode",
+    [PERF_HANDLE_MESSAGE] = "handle_bentel_message",
+    [PERF_STATE_MACHINE_NEXT] = "state_machine_next",
+    [PERF_HTTP_NETINFO] = "/netinfo",
+    [PERF_HTTP_TEMP] = "/temp",
+    [PERF_HTTP_LED] = "/led",
+    [PERF_HTTP_RSSI] = "/rssi",
+    [PERF_HTTP_HA] = "/ha",
+    [PERF_HTTP_DELTA] = "/delta",
+    [PERF_HTTP_TLS] = "/tls",
+    [PERF_HTTP_CONNECTIONS] = "/connections",
+    [PERF_HTTP_EVENTS] = "/events",
+    [PERF_HTTP_PANELS] = "/panels",
+    [PERF_HTTP_COMMAND] = "/command",
+    [PERF_HTTP_BATCH] = "/batch",
+    [PERF_HTTP_CAPTURE] = "/capture",
+    [PERF_HTTP_BOOTLOADER] = "/bootloader",
+    [PERF_HTTP_PERF] = "/perf",
+    [PERF_HTTP_TRACE] = "/trace",
+    [PERF_HTTP_RAM] = "/ram",
+    [PERF_HTTP_LOG] = "/log",
+};
+
+const char *
+perf_name (perf_id_t id)
+{
+    return ((unsigned) id < PERF_IDS) ? perf_names[id] : "";
+}
+
+#if PERF
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+/* SysTick, 24 bits, counts down */
+#define PERF_SYSTICK_MASK 0x00ffffffu
+/* beyond that, the SysTick may have wrapped: use the timer */
+#define PERF_SYSTICK_MAX_US 100000u
+
+static perf_counter_t perf_counters[PERF_CORES][PERF_IDS];
+static volatile bool perf_reset[PERF_CORES];
+static uint32_t perf_cycles_per_us;
+
+void
+perf_core_start (void)
+{
+    perf_cycles_per_us = clock_get_hz (clk_sys) / 1000000u;
+
+    systick_hw->csr = 0;
+    systick_hw->rvr = PERF_SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    /* the processor clock, no interrupt */
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS |
+        M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void
+__time_critical_func(perf_end) (perf_id_t id, const perf_stamp_t * start)
+{
+    perf_counter_t * counter;
+    uint32_t cycles;
+    uint32_t us;
+    uint core;
+
+    cycles = (start->cycles - systick_hw->cvr) & PERF_SYSTICK_MASK;
+    us = timer_hw->timerawl - start->us;
+
+    if (us >= PERF_SYSTICK_MAX_US)
+    {
+        cycles = us * perf_cycles_per_us;
+    }
+
+    core = get_core_num ();
+
+    if (perf_reset[core])
+    {
+        memset (perf_counters[core], 0, sizeof (perf_counters[core]));
+        perf_reset[core] = false;
+    }
+
+    counter = &perf_counters[core][id];
+
+    if (counter->count == 0 || cycles < counter->min)
+    {
+        counter->min = cycles;
+    }
+
+    if (cycles > counter->max)
+    {
+        counter->max = cycles;
+    }
+
+    counter->total += cycles;
+    counter->count++;
+}
+
+/*
+ * {"clk_hz":133000000,"cores":[{"on_uart_rx":{"count":12,"min":840,
+ *  "mean":910,"max":2310},...},{...}]}
+ *
+ * Only the counters that were called since the last reset.
+ */
+int
+perf_render (char * buffer, size_t len, bool reset)
+{
+    perf_counter_t counter;
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+    bool first;
+    int core;
+    int id;
+
+    render_printf (&render, "{\"clk_hz\":%lu,\"cores\":[",
+                   (unsigned long) clock_get_hz (clk_sys));
+
+    for (core = 0 ; core < PERF_CORES ; core++)
+    {
+        render_printf (&render, "%s{", core == 0 ? "" : ",");
+        first = true;
+
+        for (id = 0 ; id < PERF_IDS ; id++)
+        {
+            /* a copy, the other core may be updating it */
+            counter = perf_counters[core][id];
+
+            if (perf_reset[core] || counter.count == 0)
+            {
+                continue;
+            }
+
+            render_printf (&render,
+                           "%s\"%s\":{\"count\":%lu,\"min\":%lu,\"mean\":%lu,"
+                           "\"max\":%lu}",
+                           first ? "" : ",", perf_names[id],
+                           (unsigned long) counter.count,
+                           (unsigned long) counter.min,
+                           (unsigned long) (counter.total / counter.count),
+                           (unsigned long) counter.max);
+            first = false;
+        }
+
+        render_printf (&render, "}");
+
+        if (reset)
+        {
+            perf_reset[core] = true;
+        }
+    }
+
+    render_printf (&render, "]}");
+
+    return render_finish (&render);
+}
+
+#endif /* PERF */
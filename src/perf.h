@@ -0,0 +1,125 @@
+#ifndef _perf_h_
+#define _perf_h_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Cycle counters around the hot paths, per core: the count of calls
+ * and the min, mean and max cycles of a call, for /perf.
+ *
+ * The cycles are read from the SysTick of the core (24 bits, it wraps
+ * after 126 ms at 133 MHz), started by perf_core_start () on each
+ * core. A call that takes longer than that is measured with the 1 us
+ * timer instead, and converted to cycles.
+ *
+ * perf_begin () and perf_end () only touch the counters of the core
+ * they run on, so the cores need no locking. perf_render () resets
+ * the counters of a core by asking that core to clear them at its
+ * next perf_end (), so that at most one call straddles a reset.
+ *
+ * They are in the firmware unless PERF=0 is given to cmake, see
+ * CMakeLists.txt; without PERF (as in the host build) they are empty.
+ */
+
+typedef enum _perf_id_t perf_id_t;
+
+enum _perf_id_t
+{
+    PERF_UART_RX = 0,
+    PERF_BENTEL_RECEIVED,
+    PERF_BENTEL_DECODE,
+    PERF_HANDLE_MESSAGE,
+    PERF_STATE_MACHINE_NEXT,
+    PERF_HTTP_NETINFO,
+    PERF_HTTP_TEMP,
+    PERF_HTTP_LED,
+    PERF_HTTP_RSSI,
+    PERF_HTTP_HA,
+    PERF_HTTP_DELTA,
+    PERF_HTTP_TLS,
+    PERF_HTTP_CONNECTIONS,
+    PERF_HTTP_EVENTS,
+    PERF_HTTP_PANELS,
+    PERF_HTTP_COMMAND,
+    PERF_HTTP_BATCH,
+    PERF_HTTP_CAPTURE,
+    PERF_HTTP_BOOTLOADER,
+    PERF_HTTP_PERF,
+    PERF_HTTP_TRACE,
+    PERF_HTTP_RAM,
+    PERF_HTTP_LOG,
+    PERF_IDS,
+};
+
+#define PERF_CORES 2
+
+/* "on_uart_rx", ..., "/ha", ..., also without PERF */
+const char * perf_name (perf_id_t id);
+
+typedef struct _perf_stamp_t perf_stamp_t;
+
+struct _perf_stamp_t
+{
+    uint32_t cycles;
+    uint32_t us;
+};
+
+typedef struct _perf_counter_t perf_counter_t;
+
+struct _perf_counter_t
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+};
+
+#if PERF
+
+#include "hardware/structs/systick.h"
+#include "hardware/timer.h"
+
+static inline void
+perf_begin (perf_stamp_t * stamp)
+{
+    stamp->cycles = systick_hw->cvr;
+    stamp->us = timer_hw->timerawl;
+}
+
+void perf_end (perf_id_t id, const perf_stamp_t * start);
+
+/* Start the SysTick of the calling core. */
+void perf_core_start (void);
+
+/*
+ * Render the counters of both cores as a JSON object, and reset them
+ * if reset is true. Returns the length, or -1 if it did not fit in len
+ * bytes.
+ */
+int perf_render (char * buffer, size_t len, bool reset);
+
+#else
+
+static inline void
+perf_begin (perf_stamp_t * stamp)
+{
+    (void) stamp;
+}
+
+static inline void
+perf_end (perf_id_t id, const perf_stamp_t * start)
+{
+    (void) id;
+    (void) start;
+}
+
+static inline void
+perf_core_start (void)
+{
+}
+
+#endif /* PERF */
+
+#endif /* _perf_h_ */
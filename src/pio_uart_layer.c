@@ -0,0 +1,302 @@
+#include "pio_uart_layer.h"
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
+
+#include "log_ring.h"
+
+#include "pio_uart.pio.h"
+
+/*
+ * Bytes per DMA run. When a run completes the channel is re-armed from
+ * its interrupt, and the write address carries on around the ring.
+ */
+#define PIO_UART_DMA_COUNT (1u << 31)
+
+/* offsets of the programs in each PIO, loaded by the first layer */
+static bool rx_loaded[NUM_PIOS];
+static bool tx_loaded[NUM_PIOS];
+static uint rx_offset[NUM_PIOS];
+static uint tx_offset[NUM_PIOS];
+
+/* the layer on each DMA channel, for the interrupt handler */
+static pio_uart_layer_t * dma_layers[NUM_DMA_CHANNELS];
+static bool dma_irq_added = false;
+
+/*
+ * The DMA and timer interrupts are both taken on the core that called
+ * pio_uart_layer_start (), at the same priority, so they do not
+ * preempt each other and armed/consumed need no lock.
+ */
+static void
+__time_critical_func(on_dma_complete)(void)
+{
+    int i;
+    pio_uart_layer_t * pio_uart_layer;
+
+    for (i = 0 ; i < NUM_DMA_CHANNELS ; i++)
+    {
+        pio_uart_layer = dma_layers[i];
+
+        if (pio_uart_layer != NULL && dma_channel_get_irq1_status (i))
+        {
+            dma_channel_acknowledge_irq1 (i);
+
+            pio_uart_layer->armed += PIO_UART_DMA_COUNT;
+
+            dma_channel_set_trans_count (i, PIO_UART_DMA_COUNT, true);
+        }
+    }
+}
+
+static bool
+__time_critical_func(pio_uart_layer_poll)(repeating_timer_t * timer)
+{
+    pio_uart_layer_t * pio_uart_layer;
+    uint32_t received;
+    uint32_t pending;
+    uint8_t ch;
+
+    pio_uart_layer = (pio_uart_layer_t *) timer->user_data;
+
+    if (pio_interrupt_get (pio_uart_layer->pio, 4 + pio_uart_layer->sm_rx))
+    {
+        pio_interrupt_clear (pio_uart_layer->pio, 4 + pio_uart_layer->sm_rx);
+        pio_uart_layer->framing_errors++;
+    }
+
+    received = pio_uart_layer->armed + PIO_UART_DMA_COUNT -
+        dma_channel_hw_addr (pio_uart_layer->dma_channel)->transfer_count;
+
+    pending = received - pio_uart_layer->consumed;
+
+    if (pending > PIO_UART_RING_SIZE)
+    {
+        pio_uart_layer->overruns += pending - PIO_UART_RING_SIZE;
+        pio_uart_layer->consumed = received - PIO_UART_RING_SIZE;
+    }
+
+    if (pio_uart_layer->upper_layer == NULL ||
+        pio_uart_layer->ops == NULL ||
+        pio_uart_layer->ops->to_upper_layer_received_message == NULL)
+    {
+        pio_uart_layer->consumed = received;
+        return true;
+    }
+
+    /*
+     * One byte at a time, as from the hardware UART: the bentel layer
+     * decodes at most one message per call.
+     */
+    while (pio_uart_layer->consumed != received)
+    {
+        ch = pio_uart_layer->ring[pio_uart_layer->consumed &
+                                  (PIO_UART_RING_SIZE - 1)];
+        pio_uart_layer->consumed++;
+
+        if (pio_uart_layer->capture != NULL)
+        {
+            capture_write (pio_uart_layer->capture, CAPTURE_RX, &ch, 1);
+        }
+
+        pio_uart_layer->ops->to_upper_layer_received_message (pio_uart_layer->upper_layer,
+                                                              &ch, 1);
+    }
+
+    return true;
+}
+
+static void
+pio_uart_layer_rx_init (pio_uart_layer_t * pio_uart_layer, uint offset)
+{
+    PIO pio;
+    uint sm;
+    pio_sm_config c;
+
+    pio = pio_uart_layer->pio;
+    sm = pio_uart_layer->sm_rx;
+
+    pio_sm_set_consecutive_pindirs (pio, sm, pio_uart_layer->rx_pin, 1, false);
+    pio_gpio_init (pio, pio_uart_layer->rx_pin);
+    gpio_pull_up (pio_uart_layer->rx_pin);
+
+    c = pio_uart_rx_program_get_default_config (offset);
+    sm_config_set_in_pins (&c, pio_uart_layer->rx_pin);
+    sm_config_set_jmp_pin (&c, pio_uart_layer->rx_pin);
+    /* shift right, no autopush: the byte lands in bits 31..24 */
+    sm_config_set_in_shift (&c, true, false, 32);
+    sm_config_set_fifo_join (&c, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv (&c, (float) clock_get_hz (clk_sys) /
+                          (8 * pio_uart_layer->speed));
+
+    pio_sm_init (pio, sm, offset, &c);
+    pio_sm_set_enabled (pio, sm, true);
+}
+
+static void
+pio_uart_layer_tx_init (pio_uart_layer_t * pio_uart_layer, uint offset)
+{
+    PIO pio;
+    uint sm;
+    uint32_t mask;
+    pio_sm_config c;
+
+    pio = pio_uart_layer->pio;
+    sm = pio_uart_layer->sm_tx;
+    mask = 1u << pio_uart_layer->tx_pin;
+
+    /* idle high before the pin is handed over to the PIO */
+    pio_sm_set_pins_with_mask (pio, sm, mask, mask);
+    pio_sm_set_pindirs_with_mask (pio, sm, mask, mask);
+    pio_gpio_init (pio, pio_uart_layer->tx_pin);
+
+    c = pio_uart_tx_program_get_default_config (offset);
+    sm_config_set_out_shift (&c, true, false, 32);
+    sm_config_set_out_pins (&c, pio_uart_layer->tx_pin, 1);
+    sm_config_set_sideset_pins (&c, pio_uart_layer->tx_pin);
+    sm_config_set_fifo_join (&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv (&c, (float) clock_get_hz (clk_sys) /
+                          (8 * pio_uart_layer->speed));
+
+    pio_sm_init (pio, sm, offset, &c);
+    pio_sm_set_enabled (pio, sm, true);
+}
+
+static void
+pio_uart_layer_dma_init (pio_uart_layer_t * pio_uart_layer)
+{
+    int channel;
+    dma_channel_config c;
+
+    channel = dma_claim_unused_channel (true);
+    pio_uart_layer->dma_channel = channel;
+    dma_layers[channel] = pio_uart_layer;
+
+    c = dma_channel_get_default_config (channel);
+    channel_config_set_transfer_data_size (&c, DMA_SIZE_8);
+    channel_config_set_read_increment (&c, false);
+    channel_config_set_write_increment (&c, true);
+    channel_config_set_ring (&c, true, PIO_UART_RING_BITS);
+    channel_config_set_dreq (&c, pio_get_dreq (pio_uart_layer->pio,
+                                               pio_uart_layer->sm_rx, false));
+
+    if (!dma_irq_added)
+    {
+        irq_add_shared_handler (DMA_IRQ_1, on_dma_complete,
+                                PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled (DMA_IRQ_1, true);
+        dma_irq_added = true;
+    }
+    dma_channel_set_irq1_enabled (channel, true);
+
+    /* a byte read of the top lane of the RX FIFO, see pio_uart.pio */
+    dma_channel_configure (channel, &c, pio_uart_layer->ring,
+                           (io_rw_8 *) &pio_uart_layer->pio->rxf[pio_uart_layer->sm_rx] + 3,
+                           PIO_UART_DMA_COUNT, true);
+}
+
+int
+pio_uart_layer_start (void * layer)
+{
+    pio_uart_layer_t *pio_uart_layer;
+    uint index;
+
+    pio_uart_layer = (pio_uart_layer_t *) layer;
+    index = pio_get_index (pio_uart_layer->pio);
+
+    if (!rx_loaded[index])
+    {
+        rx_offset[index] = pio_add_program (pio_uart_layer->pio,
+                                            &pio_uart_rx_program);
+        rx_loaded[index] = true;
+    }
+
+    pio_uart_layer->sm_rx = pio_claim_unused_sm (pio_uart_layer->pio, true);
+    pio_uart_layer->armed = 0;
+    pio_uart_layer->consumed = 0;
+    pio_uart_layer->overruns = 0;
+    pio_uart_layer->framing_errors = 0;
+
+    pio_uart_layer_rx_init (pio_uart_layer, rx_offset[index]);
+
+    if (pio_uart_layer->tx_pin >= 0)
+    {
+        if (!tx_loaded[index])
+        {
+            tx_offset[index] = pio_add_program (pio_uart_layer->pio,
+                                                &pio_uart_tx_program);
+            tx_loaded[index] = true;
+        }
+
+        pio_uart_layer->sm_tx = pio_claim_unused_sm (pio_uart_layer->pio, true);
+
+        pio_uart_layer_tx_init (pio_uart_layer, tx_offset[index]);
+    }
+
+    pio_uart_layer_dma_init (pio_uart_layer);
+
+    if (!add_repeating_timer_ms (PIO_UART_POLL_MS, pio_uart_layer_poll,
+                                 pio_uart_layer, &pio_uart_layer->timer))
+    {
+        LOG_RING_ERROR ("pio_uart_layer_start: no timer slot");
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+pio_uart_layer_stop (void * layer)
+{
+    pio_uart_layer_t *pio_uart_layer;
+
+    pio_uart_layer = (pio_uart_layer_t *) layer;
+
+    cancel_repeating_timer (&pio_uart_layer->timer);
+
+    dma_channel_set_irq1_enabled (pio_uart_layer->dma_channel, false);
+    dma_channel_abort (pio_uart_layer->dma_channel);
+    dma_layers[pio_uart_layer->dma_channel] = NULL;
+    dma_channel_unclaim (pio_uart_layer->dma_channel);
+
+    pio_sm_set_enabled (pio_uart_layer->pio, pio_uart_layer->sm_rx, false);
+    pio_sm_unclaim (pio_uart_layer->pio, pio_uart_layer->sm_rx);
+
+    if (pio_uart_layer->tx_pin >= 0)
+    {
+        pio_sm_set_enabled (pio_uart_layer->pio, pio_uart_layer->sm_tx, false);
+        pio_sm_unclaim (pio_uart_layer->pio, pio_uart_layer->sm_tx);
+    }
+}
+
+int
+pio_uart_layer_send_message (void * layer, void * message, int len)
+{
+    int i;
+    pio_uart_layer_t *pio_uart_layer;
+    const uint8_t * buffer;
+
+    pio_uart_layer = (pio_uart_layer_t *) layer;
+    buffer = (const uint8_t *) message;
+
+    if (pio_uart_layer->tx_pin < 0)
+    {
+        return -1;
+    }
+
+    if (pio_uart_layer->capture != NULL)
+    {
+        capture_write (pio_uart_layer->capture, CAPTURE_TX, buffer, len);
+    }
+
+    for (i = 0 ; i < len ; i++)
+    {
+        pio_sm_put_blocking (pio_uart_layer->pio, pio_uart_layer->sm_tx,
+                             buffer[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef _pio_uart_layer_h_
+#define _pio_uart_layer_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <hardware/pio.h>
+#include <pico/time.h>
+
+#include "uart_layer.h"
+
+/*
+ * A 9600-8N1 panel link on a pair of PIO state machines, for the links
+ * that do not fit on the two hardware UARTs (uart0 also carries the
+ * stdout log). It has the same start/stop/send functions as
+ * uart_layer_t, and hands the received bytes to the same
+ * uart_layer_ops_t, so it can be put under a bentel layer in its place.
+ *
+ * The receiver is fed to a ring buffer by a DMA channel, so receiving
+ * costs no CPU per bit or per byte; a repeating timer drains the ring
+ * to the upper layer every PIO_UART_POLL_MS. The ring must be large
+ * enough for the bytes of one period, or the oldest are dropped and
+ * counted in overruns.
+ *
+ * A tx_pin of -1 makes a receive-only link, e.g. to listen to the bus.
+ */
+
+/* a power of 2, for the DMA address ring */
+#define PIO_UART_RING_BITS 8
+#define PIO_UART_RING_SIZE (1u << PIO_UART_RING_BITS)
+
+#define PIO_UART_POLL_MS 10
+
+typedef struct _pio_uart_layer_t pio_uart_layer_t;
+
+struct _pio_uart_layer_t
+{
+    PIO pio;
+    int speed;
+    int tx_pin;
+    int rx_pin;
+    void * upper_layer;
+    uart_layer_ops_t *ops;
+    /* the bytes both ways are written here, if not NULL */
+    capture_t * capture;
+
+    /* set by pio_uart_layer_start () */
+    uint sm_rx;
+    uint sm_tx;
+    int dma_channel;
+    repeating_timer_t timer;
+
+    /** @brief bytes received, modulo 2^32, at the last DMA re-arm */
+    uint32_t armed;
+    /** @brief bytes handed to the upper layer, modulo 2^32 */
+    uint32_t consumed;
+
+    uint32_t overruns;
+    uint32_t framing_errors;
+
+    uint8_t ring[PIO_UART_RING_SIZE]
+        __attribute__ ((aligned (PIO_UART_RING_SIZE)));
+};
+
+int pio_uart_layer_start (void * layer);
+
+void pio_uart_layer_stop (void * layer);
+
+int pio_uart_layer_send_message (void * layer, void * message, int len);
+
+#endif /* _pio_uart_layer_h_ */
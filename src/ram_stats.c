@@ -0,0 +1,238 @@
+#include <malloc.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "lwip/memp.h"
+#include "lwip/priv/memp_priv.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+
+#include "ram_stats.h"
+#include "render.h"
+
+#define RAM_STATS_PAINT 0x5ca1ab1eu
+/* left unpainted below the frame of ram_stats_paint_stack () */
+#define RAM_STATS_MARGIN_WORDS 16
+
+/* from the linker script of the SDK */
+extern uint32_t __StackBottom[], __StackTop[];
+extern uint32_t __StackOneBottom[], __StackOneTop[];
+extern char __end__[], __StackLimit[];
+
+typedef struct _ram_stats_stack_t ram_stats_stack_t;
+
+struct _ram_stats_stack_t
+{
+    uint32_t * bottom;
+    uint32_t * top;
+};
+
+/* core1 runs on the stack of multicore_launch_core1 () */
+static const ram_stats_stack_t ram_stats_stacks[RAM_STATS_CORES] =
+{
+    { __StackBottom, __StackTop },
+    { __StackOneBottom, __StackOneTop },
+};
+
+#if !MEMP_MEM_MALLOC
+/* in the order of memp_t */
+static const char * const ram_stats_pool_names[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+#endif
+
+typedef struct _ram_stats_pool_t ram_stats_pool_t;
+
+struct _ram_stats_pool_t
+{
+    uint16_t used;
+    uint16_t max_used;
+};
+
+typedef struct _ram_stats_t ram_stats_t;
+
+struct _ram_stats_t
+{
+    uint32_t samples;
+    uint32_t stack_used[RAM_STATS_CORES];
+    uint32_t heap_arena;
+    uint32_t heap_used;
+    uint32_t heap_max_used;
+#if !MEMP_MEM_MALLOC
+    ram_stats_pool_t pools[MEMP_MAX];
+#endif
+};
+
+/*
+ * Only updated by ram_stats_sample () and read by ram_stats_render (),
+ * both in the lwIP context.
+ */
+static ram_stats_t ram_stats;
+
+void __attribute__ ((noinline))
+ram_stats_paint_stack (void)
+{
+    volatile uint32_t here;
+    uint32_t * word;
+    uint32_t * end;
+    uint core;
+
+    core = get_core_num ();
+    end = (uint32_t *) &here - RAM_STATS_MARGIN_WORDS;
+
+    for (word = ram_stats_stacks[core].bottom ; word < end ; word++)
+    {
+        *word = RAM_STATS_PAINT;
+    }
+}
+
+static uint32_t
+ram_stats_stack_used (int core)
+{
+    const uint32_t * word;
+
+    word = ram_stats_stacks[core].bottom;
+
+    while (word < ram_stats_stacks[core].top && *word == RAM_STATS_PAINT)
+    {
+        word++;
+    }
+
+    return (ram_stats_stacks[core].top - word) * sizeof (uint32_t);
+}
+
+#if !MEMP_MEM_MALLOC
+static uint16_t
+ram_stats_pool_free (const struct memp_desc * desc)
+{
+    struct memp * element;
+    uint16_t count = 0;
+    SYS_ARCH_DECL_PROTECT (old_level);
+
+    SYS_ARCH_PROTECT (old_level);
+
+    for (element = *desc->tab ; element != NULL ; element = element->next)
+    {
+        count++;
+    }
+
+    SYS_ARCH_UNPROTECT (old_level);
+
+    return count;
+}
+#endif
+
+void
+ram_stats_sample (void)
+{
+    struct mallinfo info;
+    int core;
+#if !MEMP_MEM_MALLOC
+    ram_stats_pool_t * pool;
+    int i;
+#endif
+
+    for (core = 0 ; core < RAM_STATS_CORES ; core++)
+    {
+        ram_stats.stack_used[core] = ram_stats_stack_used (core);
+    }
+
+    info = mallinfo ();
+    ram_stats.heap_arena = info.arena;
+    ram_stats.heap_used = info.uordblks;
+
+    if (ram_stats.heap_used > ram_stats.heap_max_used)
+    {
+        ram_stats.heap_max_used = ram_stats.heap_used;
+    }
+
+#if !MEMP_MEM_MALLOC
+    for (i = 0 ; i < MEMP_MAX ; i++)
+    {
+        pool = &ram_stats.pools[i];
+        pool->used = memp_pools[i]->num - ram_stats_pool_free (memp_pools[i]);
+
+        if (pool->used > pool->max_used)
+        {
+            pool->max_used = pool->used;
+        }
+    }
+#endif
+
+    ram_stats.samples++;
+}
+
+/*
+ * {"samples":120,"stacks":[{"size":2048,"max_used":812},{...}],
+ *  "heap":{"size":61440,"arena":9216,"used":7010,"max_used":8830},
+ *  "lwip_heap":{"size":4000,"used":0,"max_used":1260},
+ *  "pools":{"TCP_PCB":{"size":5,"used":1,"max_used":3},...}}
+ *
+ * "lwip_heap" only if lwIP keeps MEM_STATS.
+ */
+int
+ram_stats_render (char * buffer, size_t len)
+{
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+    int core;
+#if !MEMP_MEM_MALLOC
+    int i;
+#endif
+
+    render_printf (&render, "{\"samples\":%lu,\"stacks\":[",
+                   (unsigned long) ram_stats.samples);
+
+    for (core = 0 ; core < RAM_STATS_CORES ; core++)
+    {
+        render_printf (&render,
+                       "%s{\"size\":%u,\"max_used\":%lu}",
+                       core == 0 ? "" : ",",
+                       (unsigned) ((ram_stats_stacks[core].top -
+                                    ram_stats_stacks[core].bottom) *
+                                   sizeof (uint32_t)),
+                       (unsigned long) ram_stats.stack_used[core]);
+    }
+
+    render_printf (&render,
+                   "],\"heap\":{\"size\":%u,\"arena\":%lu,\"used\":%lu,"
+                   "\"max_used\":%lu}",
+                   (unsigned) (__StackLimit - __end__),
+                   (unsigned long) ram_stats.heap_arena,
+                   (unsigned long) ram_stats.heap_used,
+                   (unsigned long) ram_stats.heap_max_used);
+
+#if LWIP_STATS && MEM_STATS
+    render_printf (&render,
+                   ",\"lwip_heap\":{\"size\":%lu,\"used\":%lu,"
+                   "\"max_used\":%lu}",
+                   (unsigned long) lwip_stats.mem.avail,
+                   (unsigned long) lwip_stats.mem.used,
+                   (unsigned long) lwip_stats.mem.max);
+#endif
+
+    render_printf (&render, ",\"pools\":{");
+
+#if !MEMP_MEM_MALLOC
+    for (i = 0 ; i < MEMP_MAX ; i++)
+    {
+        render_printf (&render,
+                       "%s\"%s\":{\"size\":%u,\"used\":%u,\"max_used\":%u}",
+                       i == 0 ? "" : ",", ram_stats_pool_names[i],
+                       (unsigned) memp_pools[i]->num,
+                       (unsigned) ram_stats.pools[i].used,
+                       (unsigned) ram_stats.pools[i].max_used);
+    }
+#endif
+
+    render_printf (&render, "}}");
+
+    return render_finish (&render);
+}
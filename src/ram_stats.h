@@ -0,0 +1,40 @@
+#ifndef _ram_stats_h_
+#define _ram_stats_h_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * High water marks of the RAM that is used at runtime, for /ram:
+ *
+ * - the stack of each core. ram_stats_paint_stack (), called first
+ *   thing on each core, fills the free part of the stack of the calling
+ *   core with a pattern; the deepest use is where the pattern ends. On
+ *   the Cortex-M0+ the interrupt handlers run on the stack of the core
+ *   they interrupt, so their use is part of it.
+ * - the C heap (malloc, used by mbedtls), from mallinfo ().
+ * - the lwIP memory pools (pbufs, PCBs, ...), by counting the free
+ *   elements of each pool, and the lwIP heap if lwIP keeps MEM_STATS.
+ *
+ * The heap and the pools are only ever in use for a moment, so their
+ * peaks are caught by sampling: ram_stats_sample () runs every
+ * RAM_STATS_INTVL_MS on core0, in the lwIP context (see main.c).
+ */
+
+#define RAM_STATS_CORES 2
+#define RAM_STATS_INTVL_MS (1000)
+
+/* Paint the free part of the stack of the calling core. */
+void ram_stats_paint_stack (void);
+
+/* Sample the heaps and the pools, with lwIP locked out. */
+void ram_stats_sample (void);
+
+/*
+ * Render the latest sample as a JSON object. Returns the length, or -1
+ * if it did not fit in len bytes.
+ */
+int ram_stats_render (char * buffer, size_t len);
+
+#endif /* _ram_stats_h_ */
@@ -0,0 +1,391 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "render.h"
+
+void
+render_printf (render_t * render, const char * format, ...)
+{
+    int n;
+    va_list args;
+
+    if (render->overflow)
+    {
+        return;
+    }
+
+    va_start (args, format);
+    n = vsnprintf (&render->buffer[render->used],
+                   render->len - render->used, format, args);
+    va_end (args);
+
+    if (n < 0 || (size_t) n >= render->len - render->used)
+    {
+        render->overflow = true;
+        return;
+    }
+
+    render->used += n;
+}
+
+static void
+render_name (render_t * render, const char * value)
+{
+    int n;
+
+    if (render->overflow)
+    {
+        return;
+    }
+
+    n = render_string (&render->buffer[render->used],
+                       render->len - render->used, value);
+
+    if (n < 0)
+    {
+        render->overflow = true;
+        return;
+    }
+
+    render->used += n;
+}
+
+int
+render_string (char * buffer, size_t len, const char * value)
+{
+    size_t i = 0;
+
+    if (len < 3)
+    {
+        return -1;
+    }
+
+    buffer[i++] = '"';
+
+    for ( ; *value != '\0' ; value++)
+    {
+        /* room for an escape, the closing quote and the terminator */
+        if (i + 4 > len)
+        {
+            return -1;
+        }
+
+        if (*value == '"' || *value == '\\')
+        {
+            buffer[i++] = '\\';
+            buffer[i++] = *value;
+        }
+        else if ((unsigned char) *value < 0x20)
+        {
+            buffer[i++] = ' ';
+        }
+        else
+        {
+            buffer[i++] = *value;
+        }
+    }
+
+    buffer[i++] = '"';
+    buffer[i] = '\0';
+
+    return i;
+}
+
+static void
+render_zone_object (render_t * render, configuration_t * configuration,
+                    int i)
+{
+    render_printf (render, "{\"name\":");
+    render_name (render, configuration->zones[i].name);
+    render_printf (render,
+                   ",\"alarm\":%d,\"sabotage\":%d,\"included\":%d,"
+                   "\"alarm_memory\":%d,\"sabotage_memory\":%d}",
+                   configuration->zones[i].alarm,
+                   configuration->zones[i].sabotage,
+                   configuration->zones[i].inclusion,
+                   configuration->zones[i].alarm_memory,
+                   configuration->zones[i].sabotage_memory);
+}
+
+static void
+render_partition_object (render_t * render, configuration_t * configuration,
+                         int i)
+{
+    render_printf (render, "{\"name\":");
+    render_name (render, configuration->partitions[i].name);
+    render_printf (render, ",\"alarm\":%d,\"armed\":%d}",
+                   configuration->partitions[i].alarm,
+                   configuration->partitions[i].armed);
+}
+
+int
+render_finish (render_t * render)
+{
+    if (render->overflow)
+    {
+        return -1;
+    }
+
+    return render->used;
+}
+
+int
+render_zone (char * buffer, size_t len,
+             configuration_t * configuration, int i)
+{
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+
+    render_zone_object (&render, configuration, i);
+
+    return render_finish (&render);
+}
+
+int
+render_partition (char * buffer, size_t len,
+                  configuration_t * configuration, int i)
+{
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+
+    render_partition_object (&render, configuration, i);
+
+    return render_finish (&render);
+}
+
+int
+render_delta (char * buffer, size_t len,
+              configuration_t * configuration, uint32_t since)
+{
+    int i;
+    bool first;
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+
+    render_printf (&render, "\"gen\":%u", configuration->generation);
+
+    if (since == 0 || configuration->identity_generation > since)
+    {
+        render_printf (&render, ",\"model\":");
+        render_name (&render, configuration->model);
+        render_printf (&render, ",\"fw\":\"%d.%02d\",\"cached\":%d",
+                       configuration->fw_major, configuration->fw_minor,
+                       configuration->identity_cached);
+        render_printf (&render,
+                       ",\"capacity\":{\"zones\":%d,\"partitions\":%d}",
+                       configuration->capacity->zones,
+                       configuration->capacity->partitions);
+    }
+
+    first = true;
+    for (i = 0 ; i < configuration->capacity->zones ; i++)
+    {
+        if (since != 0 && configuration->zones[i].generation <= since)
+        {
+            continue;
+        }
+
+        render_printf (&render, "%s\"%d\":",
+                       first ? ",\"zones\":{" : ",", i);
+        render_zone_object (&render, configuration, i);
+        first = false;
+    }
+    if (!first)
+    {
+        render_printf (&render, "}");
+    }
+
+    first = true;
+    for (i = 0 ; i < configuration->capacity->partitions ; i++)
+    {
+        if (since != 0 && configuration->partitions[i].generation <= since)
+        {
+            continue;
+        }
+
+        render_printf (&render, "%s\"%d\":",
+                       first ? ",\"partitions\":{" : ",", i);
+        render_partition_object (&render, configuration, i);
+        first = false;
+    }
+    if (!first)
+    {
+        render_printf (&render, "}");
+    }
+
+    first = true;
+    for (i = 0 ; i < 16 ; i++)
+    {
+        if (since != 0 &&
+            configuration->digital_outputs[i].generation <= since)
+        {
+            continue;
+        }
+
+        render_printf (&render, "%s\"%d\":%d",
+                       first ? ",\"outputs\":{" : ",", i,
+                       configuration->digital_outputs[i].active);
+        first = false;
+    }
+    if (!first)
+    {
+        render_printf (&render, "}");
+    }
+
+    if (since == 0 || configuration->faults_generation > since)
+    {
+        render_printf (&render,
+                       ",\"faults\":{"
+                       "\"alarm_power\":%d,\"alarm_bpi\":%d,"
+                       "\"alarm_fuse\":%d,\"alarm_battery_low\":%d,"
+                       "\"alarm_telephone_line\":%d,"
+                       "\"alarm_default_codes\":%d,\"alarm_wireless\":%d,"
+                       "\"sabotage_partition\":%d,\"sabotage_fake_key\":%d,"
+                       "\"sabotage_bpi\":%d,\"sabotage_system\":%d,"
+                       "\"sabotage_jam\":%d,\"sabotage_wireless\":%d,"
+                       "\"siren_state\":%d}",
+                       configuration->alarm_power,
+                       configuration->alarm_bpi,
+                       configuration->alarm_fuse,
+                       configuration->alarm_battery_low,
+                       configuration->alarm_telephone_line,
+                       configuration->alarm_default_codes,
+                       configuration->alarm_wireless,
+                       configuration->sabotage_partition,
+                       configuration->sabotage_fake_key,
+                       configuration->sabotage_bpi,
+                       configuration->sabotage_system,
+                       configuration->sabotage_jam,
+                       configuration->sabotage_wireless,
+                       configuration->siren_state);
+    }
+
+    return render_finish (&render);
+}
+
+static void
+render_ha_peripherals (render_t * render, const char * key,
+                       configuration_t * configuration, bool keyboards)
+{
+    int i;
+    int n;
+    bool present;
+    bool sabotage;
+    bool alive;
+
+    n = keyboards ? 8 : 16;
+
+    render_printf (render, ",\"%s\":{", key);
+
+    for (i = 0 ; i < n ; i++)
+    {
+        if (keyboards)
+        {
+            present = configuration->keyboards[i].present;
+            sabotage = configuration->keyboards[i].sabotage;
+            alive = configuration->keyboards[i].alive;
+        }
+        else
+        {
+            present = configuration->readers[i].present;
+            sabotage = configuration->readers[i].sabotage;
+            alive = configuration->readers[i].alive;
+        }
+
+        render_printf (render,
+                       "%s\"%d\":{\"present\":\"%d\",\"sabotage\":\"%d\","
+                       "\"alive\":\"%d\"}",
+                       i == 0 ? "" : ",", i, present, sabotage, alive);
+    }
+
+    render_printf (render, "}");
+}
+
+int
+render_ha (char * buffer, size_t len, configuration_t * configuration)
+{
+    int i;
+    render_t render =
+    {
+        .buffer = buffer,
+        .len = len,
+        .used = 0,
+        .overflow = false,
+    };
+
+    render_printf (&render, "\"fw\":\"%d.%02d\",\"model\":",
+                   configuration->fw_major, configuration->fw_minor);
+    render_name (&render, configuration->model);
+
+    render_ha_peripherals (&render, "readers", configuration, false);
+    render_ha_peripherals (&render, "keyboards", configuration, true);
+
+    render_printf (&render, ",\"zones\":{");
+    for (i = 0 ; i < configuration->capacity->zones ; i++)
+    {
+        render_printf (&render, "%s\"%d\":{\"name\":", i == 0 ? "" : ",", i);
+        render_name (&render, configuration->zones[i].name);
+        render_printf (&render,
+                       ",\"sabotage\":\"%d\",\"alarm\":\"%d\","
+                       "\"included\":\"%d\",\"alarm_memory\":\"%d\","
+                       "\"sabotage_memory\":\"%d\"}",
+                       configuration->zones[i].sabotage,
+                       configuration->zones[i].alarm,
+                       configuration->zones[i].inclusion,
+                       configuration->zones[i].alarm_memory,
+                       configuration->zones[i].sabotage_memory);
+    }
+    render_printf (&render, "}");
+
+    render_printf (&render, ",\"partitions\":{");
+    for (i = 0 ; i < configuration->capacity->partitions ; i++)
+    {
+        render_printf (&render, "%s\"%d\":{\"name\":", i == 0 ? "" : ",", i);
+        render_name (&render, configuration->partitions[i].name);
+        render_printf (&render, ",\"alarm\":\"%d\",\"armed\":\"%d\"}",
+                       configuration->partitions[i].alarm,
+                       configuration->partitions[i].armed);
+    }
+    render_printf (&render, "}");
+
+    render_printf (&render,
+                   ",\"alarm_power\":\"%d\",\"alarm_bpi\":\"%d\","
+                   "\"alarm_fuse\":\"%d\",\"alarm_battery_low\":\"%d\","
+                   "\"alarm_telephone_line\":\"%d\","
+                   "\"alarm_default_codes\":\"%d\",\"alarm_wireless\":\"%d\","
+                   "\"sabotage_partition\":\"%d\",\"sabotage_fake_key\":\"%d\","
+                   "\"sabotage_bpi\":\"%d\",\"sabotage_system\":\"%d\","
+                   "\"sabotage_jam\":\"%d\",\"sabotage_wireless\":\"%d\","
+                   "\"siren_state\":\"%d\"",
+                   configuration->alarm_power,
+                   configuration->alarm_bpi,
+                   configuration->alarm_fuse,
+                   configuration->alarm_battery_low,
+                   configuration->alarm_telephone_line,
+                   configuration->alarm_default_codes,
+                   configuration->alarm_wireless,
+                   configuration->sabotage_partition,
+                   configuration->sabotage_fake_key,
+                   configuration->sabotage_bpi,
+                   configuration->sabotage_system,
+                   configuration->sabotage_jam,
+                   configuration->sabotage_wireless,
+                   configuration->siren_state);
+
+    return render_finish (&render);
+}
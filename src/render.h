@@ -0,0 +1,79 @@
+#ifndef _render_h_
+#define _render_h_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "configuration.h"
+
+/*
+ * JSON rendering of the configuration, independent of the HTTP server,
+ * so that the same code can feed HTTP responses and other publishers.
+ *
+ * All functions must be called with the configuration semaphore held,
+ * and return the length of the rendered string, or -1 if it did not
+ * fit in len bytes.
+ */
+
+/*
+ * Render the entities that changed after generation since, as the
+ * members of a JSON object (without the enclosing braces):
+ *
+ * "gen":7,"zones":{"5":{...}},"partitions":{...},"faults":{...},...
+ *
+ * since == 0 renders everything.
+ */
+int render_delta (char * buffer, size_t len,
+                  configuration_t * configuration, uint32_t since);
+
+/*
+ * Render the whole configuration for /ha, as the members of a JSON
+ * object (without the enclosing braces), with the flags as strings:
+ *
+ * "fw":"1.02","model":"...","readers":{"0":{"present":"1",...}},
+ * "keyboards":{...},"zones":{...},"partitions":{...},"alarm_power":"0",...
+ *
+ * Only the zones and partitions of the panel's capacity are rendered.
+ */
+int render_ha (char * buffer, size_t len, configuration_t * configuration);
+
+/*
+ * Render a single zone or partition as a JSON object:
+ *
+ * {"name":"...","alarm":0,...}
+ */
+int render_zone (char * buffer, size_t len,
+                 configuration_t * configuration, int i);
+
+int render_partition (char * buffer, size_t len,
+                      configuration_t * configuration, int i);
+
+/*
+ * Copy the string value into buffer as a JSON string literal, quotes
+ * included.
+ */
+int render_string (char * buffer, size_t len, const char * value);
+
+/*
+ * Bounded appending to buffer, also used for the JSON of other modules,
+ * without the semaphore: once a render_printf () does not fit, it and
+ * all the following ones are dropped, and render_finish () returns -1
+ * instead of the length.
+ */
+typedef struct _render_t render_t;
+
+struct _render_t
+{
+    char * buffer;
+    size_t len;
+    size_t used;
+    bool overflow;
+};
+
+void render_printf (render_t * render, const char * format, ...)
+    __attribute__ ((format (printf, 2, 3)));
+
+int render_finish (render_t * render);
+
+#endif /* _render_h_ */
@@ -1,37 +1,584 @@
 #include "state_machine.h"
 #include "bentel_layer.h"
+#include "configuration.h"
+#include "event_log.h"
+#include "identity_cache.h"
 
+#include <pico/sem.h>
+#include <pico/time.h>
+
+#include <stdbool.h>
 #include <string.h>
 
-extern bentel_layer_t bentel_layer;
+/*
+ * The identity is swept again after this many status polls (each poll
+ * is one status and one armed request), to pick up names changed on
+ * the panel. Like the logger, a sweep sends one request after each
+ * poll.
+ */
+#define STATE_MACHINE_IDENTITY_CYCLES 300
+
+/*
+ * The event logger is read again this many status polls after the end
+ * of the previous sweep. A sweep sends one block after each status and
+ * armed poll, so that the polls go on while it runs.
+ */
+#define STATE_MACHINE_LOGGER_CYCLES 30
+
+/* one request per 64 bytes block of the logger */
+#define LOGGER_REQUESTS \
+    (BENTEL_LOGGER_EVENTS * BENTEL_EVENT_SIZE / 64)
+
+/*
+ * The names come in blocks of four; a block is only requested if its
+ * first zone or partition exists on the panel, see capacity.h.
+ */
+static const struct
+{
+    bentel_message_type_t message_type;
+    int zone;
+    int partition;
+} identity_requests[] =
+{
+    { BENTEL_GET_MODEL_REQUEST, -1, -1 },
+    { BENTEL_GET_PERIPHERALS_REQUEST, -1, -1 },
+    { BENTEL_GET_ZONES_NAMES_0_3_REQUEST, 0, -1 },
+    { BENTEL_GET_ZONES_NAMES_4_7_REQUEST, 4, -1 },
+    { BENTEL_GET_ZONES_NAMES_8_11_REQUEST, 8, -1 },
+    { BENTEL_GET_ZONES_NAMES_12_15_REQUEST, 12, -1 },
+    { BENTEL_GET_ZONES_NAMES_16_19_REQUEST, 16, -1 },
+    { BENTEL_GET_ZONES_NAMES_20_23_REQUEST, 20, -1 },
+    { BENTEL_GET_ZONES_NAMES_24_27_REQUEST, 24, -1 },
+    { BENTEL_GET_ZONES_NAMES_28_31_REQUEST, 28, -1 },
+    { BENTEL_GET_PARTITIONS_NAMES_0_3_REQUEST, -1, 0 },
+    { BENTEL_GET_PARTITIONS_NAMES_4_7_REQUEST, -1, 4 },
+};
+
+#define IDENTITY_REQUESTS \
+    (int) (sizeof (identity_requests) / sizeof (identity_requests[0]))
+
+/* the steps of a command, see state_machine.h */
+enum
+{
+    PHASE_IDLE = 0,
+    PHASE_SEND,
+    PHASE_CONFIRM,
+    PHASE_VERIFY,
+};
+
+/* released when a command is queued, for core1 to send it right away */
+static semaphore_t wakeup;
+static bool wakeup_initialized = false;
+
+static bool
+state_machine_identity_needed (state_machine_t * machine, int index)
+{
+    const capacity_t * capacity;
+
+    capacity = machine->configuration->capacity;
+
+    return identity_requests[index].zone < capacity->zones &&
+           identity_requests[index].partition < capacity->partitions;
+}
+
+static void
+state_machine_identity_start (state_machine_t * machine)
+{
+    sem_acquire_blocking (&machine->configuration->semaphore);
+    machine->configuration->identity_answered = 0;
+    sem_release (&machine->configuration->semaphore);
+
+    machine->identity = 0;
+}
+
+/*
+ * Whether a sweep has a request left to send, skipping the names the
+ * model does not have.
+ */
+static bool
+state_machine_sweeping (state_machine_t * machine)
+{
+    while (machine->identity >= 0 && machine->identity < IDENTITY_REQUESTS &&
+           !state_machine_identity_needed (machine, machine->identity))
+    {
+        machine->identity++;
+    }
+
+    return (machine->identity >= 0 && machine->identity < IDENTITY_REQUESTS) ||
+           (machine->logger >= 0 && machine->logger < LOGGER_REQUESTS);
+}
+
+static void
+state_machine_send (state_machine_t * machine,
+                    bentel_message_type_t message_type)
+{
+    /* static: bentel_message_t is too large for the core1 stack */
+    static bentel_message_t bentel_message;
+
+    memset (&bentel_message, 0, sizeof (bentel_message_t));
+
+    bentel_message.message_type = message_type;
+
+    bentel_layer_send_message (machine->bentel_layer, &bentel_message);
+
+    machine->link_free = make_timeout_time_ms (STATE_MACHINE_FRAME_MS);
+}
+
+static void
+state_machine_send_command (state_machine_t * machine, command_t * command)
+{
+    int i;
+    /* static: bentel_message_t is too large for the core1 stack */
+    static bentel_message_t bentel_message;
+
+    memset (&bentel_message, 0, sizeof (bentel_message_t));
+
+    switch (command->type)
+    {
+        case COMMAND_ARM:
+        case COMMAND_STAY:
+        case COMMAND_DISARM:
+            bentel_message.message_type = BENTEL_ARM_PARTITIONS_REQUEST;
+
+            for (i = 0 ; i < 8 ; i++)
+            {
+                if ((command->mask & (1u << i)) == 0)
+                {
+                    continue;
+                }
+
+                bentel_message.u.arm_partitions_request.arm[i] =
+                    command->type == COMMAND_ARM;
+                bentel_message.u.arm_partitions_request.stay[i] =
+                    command->type == COMMAND_STAY;
+                bentel_message.u.arm_partitions_request.disarm[i] =
+                    command->type == COMMAND_DISARM;
+            }
+            break;
+
+        case COMMAND_EXCLUDE:
+        case COMMAND_INCLUDE:
+            bentel_message.message_type = BENTEL_BYPASS_ZONES_REQUEST;
+
+            for (i = 0 ; i < 32 ; i++)
+            {
+                if ((command->mask & (1u << i)) == 0)
+                {
+                    continue;
+                }
+
+                bentel_message.u.bypass_zones_request.exclude[i] =
+                    command->type == COMMAND_EXCLUDE;
+                bentel_message.u.bypass_zones_request.include[i] =
+                    command->type == COMMAND_INCLUDE;
+            }
+            break;
+
+        case COMMAND_RESET:
+            bentel_message.message_type = BENTEL_RESET_ALARMS_REQUEST;
+            break;
+    }
+
+    bentel_layer_send_message (machine->bentel_layer, &bentel_message);
+
+    machine->link_free = make_timeout_time_ms (STATE_MACHINE_COMMAND_MS);
+}
+
+/* arm, stay and disarm act on partitions, the others on zones */
+static bool
+state_machine_partition_command (command_type_t type)
+{
+    return type == COMMAND_ARM || type == COMMAND_STAY ||
+           type == COMMAND_DISARM;
+}
+
+/*
+ * Whether the configuration, as re-read after the batch, shows the
+ * zones or partitions of command index in the state it asked for.
+ * Those that a later command of the batch acts on again are left out.
+ */
+static bool
+state_machine_command_done (state_machine_t * machine, int index)
+{
+    int i;
+    bool set;
+    bool done = true;
+    uint32_t mask;
+    command_t * command;
+    configuration_t * configuration;
+
+    command = &machine->batch.commands[index];
+    configuration = machine->configuration;
+
+    mask = command->mask;
+    for (i = index + 1 ; i < machine->batch.count ; i++)
+    {
+        if (state_machine_partition_command (machine->batch.commands[i].type) ==
+            state_machine_partition_command (command->type))
+        {
+            mask &= ~machine->batch.commands[i].mask;
+        }
+    }
+
+    sem_acquire_blocking (&configuration->semaphore);
+
+    for (i = 0 ; i < 32 ; i++)
+    {
+        set = (mask & (1u << i)) != 0;
+
+        switch (command->type)
+        {
+            case COMMAND_ARM:
+            case COMMAND_STAY:
+                if (set && i < configuration->capacity->partitions &&
+                    !configuration->partitions[i].armed)
+                {
+                    done = false;
+                }
+                break;
+
+            case COMMAND_DISARM:
+                if (set && i < configuration->capacity->partitions &&
+                    configuration->partitions[i].armed)
+                {
+                    done = false;
+                }
+                break;
+
+            case COMMAND_EXCLUDE:
+                if (set && i < configuration->capacity->zones &&
+                    configuration->zones[i].inclusion)
+                {
+                    done = false;
+                }
+                break;
+
+            case COMMAND_INCLUDE:
+                if (set && i < configuration->capacity->zones &&
+                    !configuration->zones[i].inclusion)
+                {
+                    done = false;
+                }
+                break;
+
+            case COMMAND_RESET:
+                if (i < configuration->capacity->zones &&
+                    configuration->zones[i].alarm_memory)
+                {
+                    done = false;
+                }
+                break;
+        }
+    }
+
+    sem_release (&configuration->semaphore);
+
+    return done;
+}
+
+static void
+state_machine_set_result (state_machine_t * machine, uint32_t id,
+                          command_status_t status)
+{
+    int slot;
+
+    /* the ids are consecutive, so a slot is reused for the oldest id */
+    slot = id % STATE_MACHINE_RESULTS;
+
+    critical_section_enter_blocking (&machine->results_critsec);
+    machine->results[slot].id = id;
+    machine->results[slot].status = status;
+    critical_section_exit (&machine->results_critsec);
+}
+
+/* ms from now until time, 0 if it has passed */
+static uint32_t
+state_machine_until (absolute_time_t time)
+{
+    int64_t us;
+
+    us = absolute_time_diff_us (get_absolute_time (), time);
+
+    return (us > 0) ? (uint32_t) ((us + 999) / 1000) : 0;
+}
 
 void
 state_machine_start (state_machine_t *machine)
 {
+    if (!wakeup_initialized)
+    {
+        sem_init (&wakeup, 0, 1);
+        wakeup_initialized = true;
+    }
+
     machine->state = STATE_START;
+    machine->identity = -1;
+    machine->logger = -1;
+    machine->cycles = 0;
+    machine->logger_cycles = 0;
+
+    machine->next_poll = get_absolute_time ();
+    machine->link_free = get_absolute_time ();
+
+    queue_init (&machine->commands, sizeof (command_batch_t),
+                STATE_MACHINE_BATCHES);
+    machine->phase = PHASE_IDLE;
+    machine->next_id = 1;
+
+    critical_section_init (&machine->results_critsec);
+    memset (machine->results, 0, sizeof (machine->results));
 }
 
 void
+state_machine_wait (uint32_t timeout_ms)
+{
+    sem_acquire_timeout_ms (&wakeup, timeout_ms);
+}
+
+int
+state_machine_command (state_machine_t * machine, command_type_t type,
+                       uint32_t mask, uint32_t * id)
+{
+    command_t command;
+
+    command.type = type;
+    command.mask = mask;
+
+    return state_machine_batch (machine, &command, 1, id);
+}
+
+int
+state_machine_batch (state_machine_t * machine,
+                     const command_t * commands, int count,
+                     uint32_t * first_id)
+{
+    int i;
+    /* static: only called from core0, and too large for its stack */
+    static command_batch_t batch;
+
+    if (machine->bentel_layer->listen_only)
+    {
+        return -2;
+    }
+
+    if (count < 1 || count > STATE_MACHINE_BATCH)
+    {
+        return -3;
+    }
+
+    batch.count = count;
+
+    /* before they are queued, core1 may set SENT as soon as they are */
+    for (i = 0 ; i < count ; i++)
+    {
+        batch.commands[i] = commands[i];
+        batch.commands[i].id = machine->next_id + i;
+
+        state_machine_set_result (machine, batch.commands[i].id,
+                                  COMMAND_QUEUED);
+    }
+
+    if (!queue_try_add (&machine->commands, &batch))
+    {
+        for (i = 0 ; i < count ; i++)
+        {
+            state_machine_set_result (machine, batch.commands[i].id,
+                                      COMMAND_UNKNOWN);
+        }
+        return -1;
+    }
+
+    *first_id = machine->next_id;
+    machine->next_id += count;
+
+    sem_release (&wakeup);
+
+    return 0;
+}
+
+command_status_t
+state_machine_command_status (state_machine_t * machine, uint32_t id)
+{
+    int slot;
+    command_status_t status = COMMAND_UNKNOWN;
+
+    slot = id % STATE_MACHINE_RESULTS;
+
+    critical_section_enter_blocking (&machine->results_critsec);
+    if (machine->results[slot].id == id)
+    {
+        status = machine->results[slot].status;
+    }
+    critical_section_exit (&machine->results_critsec);
+
+    return status;
+}
+
+/*
+ * Called from core1, sends at most one frame per call, and never
+ * before the answer to the previous one has had time to arrive.
+ * Commands and their confirmation come first, the polls below only
+ * run every STATE_MACHINE_POLL_MS.
+ */
+uint32_t
 state_machine_next (state_machine_t * machine)
 {
-    bentel_message_t bentel_message;
+    int i;
+    uint32_t wait;
+    command_t * command;
+
+    /* a listen-only link is kept up to date by another master */
+    if (machine->bentel_layer->listen_only)
+    {
+        return STATE_MACHINE_POLL_MS;
+    }
+
+    wait = state_machine_until (machine->link_free);
+    if (wait > 0)
+    {
+        return wait;
+    }
+
+    switch (machine->phase)
+    {
+        case PHASE_CONFIRM:
+            /* armed partitions, zone inclusion and alarm memory */
+            state_machine_send (machine, BENTEL_GET_ARMED_PARTITIONS_REQUEST);
+            machine->phase = PHASE_VERIFY;
+            return STATE_MACHINE_FRAME_MS;
+
+        case PHASE_VERIFY:
+            for (i = 0 ; i < machine->batch.count ; i++)
+            {
+                state_machine_set_result (machine,
+                    machine->batch.commands[i].id,
+                    state_machine_command_done (machine, i) ?
+                    COMMAND_CONFIRMED : COMMAND_FAILED);
+            }
+            machine->phase = PHASE_IDLE;
+            break;
+
+        default:
+            break;
+    }
+
+    if (machine->phase == PHASE_IDLE &&
+        queue_try_remove (&machine->commands, &machine->batch))
+    {
+        machine->sent = 0;
+        machine->phase = PHASE_SEND;
+    }
+
+    if (machine->phase == PHASE_SEND)
+    {
+        command = &machine->batch.commands[machine->sent];
+
+        state_machine_send_command (machine, command);
+        state_machine_set_result (machine, command->id, COMMAND_SENT);
+
+        machine->sent++;
+        if (machine->sent == machine->batch.count)
+        {
+            machine->phase = PHASE_CONFIRM;
+        }
+        return STATE_MACHINE_COMMAND_MS;
+    }
+
+    wait = state_machine_until (machine->next_poll);
+    if (wait > 0)
+    {
+        return wait;
+    }
+
+    machine->next_poll = make_timeout_time_ms (STATE_MACHINE_POLL_MS);
 
     switch (machine->state)
     {
         case STATE_START:
-            //machine->state = STATE_REQUEST_MODEL;
+            /*
+             * Only the model goes before the polls, the capacity depends
+             * on it; the rest of the identity follows one request per
+             * poll, as the logger.
+             */
+            state_machine_identity_start (machine);
+            state_machine_send (machine, identity_requests[0].message_type);
+            machine->identity++;
+
+            machine->logger = (machine->event_log != NULL) ? 0 : -1;
+            machine->state = STATE_REQUEST_STATUS;
+            break;
+
+        case STATE_REQUEST_STATUS:
+            /* the answers to the last requests of a sweep are in by now */
+            if (machine->identity == IDENTITY_REQUESTS)
+            {
+                identity_cache_save (machine->configuration);
+
+                machine->identity = -1;
+                machine->cycles = 0;
+            }
+
+            if (machine->logger == LOGGER_REQUESTS)
+            {
+                event_log_sync (machine->event_log,
+                                machine->bentel_layer->logger);
+
+                machine->logger = -1;
+                machine->logger_cycles = 0;
+            }
+
+            state_machine_send (machine, BENTEL_GET_STATUS_AND_FAULTS_REQUEST);
+
+            machine->state = STATE_REQUEST_ARMED;
             break;
 
-        case STATE_REQUEST_MODEL:
-            memset (&bentel_message, 0, sizeof (bentel_message_t));
+        case STATE_REQUEST_ARMED:
+            state_machine_send (machine, BENTEL_GET_ARMED_PARTITIONS_REQUEST);
 
-            bentel_message.message_type = BENTEL_GET_MODEL_REQUEST;
+            machine->cycles++;
+            machine->logger_cycles++;
 
-	    bentel_layer_send_message (&bentel_layer, &bentel_message);
+            if (machine->identity < 0 &&
+                machine->cycles >= STATE_MACHINE_IDENTITY_CYCLES)
+            {
+                state_machine_identity_start (machine);
+            }
 
+            if (machine->event_log != NULL && machine->logger < 0 &&
+                machine->logger_cycles >= STATE_MACHINE_LOGGER_CYCLES)
+            {
+                machine->logger = 0;
+            }
+
+            machine->state = state_machine_sweeping (machine) ?
+                STATE_REQUEST_SWEEP : STATE_REQUEST_STATUS;
+            break;
+
+        case STATE_REQUEST_SWEEP:
+            /*
+             * The identity first, it is shorter. What a sweep sent last
+             * is saved or stored with the next poll, once it is answered.
+             */
+            if (machine->identity >= 0 && machine->identity < IDENTITY_REQUESTS)
+            {
+                state_machine_send (machine,
+                    identity_requests[machine->identity].message_type);
+                machine->identity++;
+            }
+            else
+            {
+                /* the request types alternate with their responses */
+                state_machine_send (machine, BENTEL_GET_LOGGER_1_REQUEST +
+                                    2 * machine->logger);
+                machine->logger++;
+            }
+
+            machine->state = STATE_REQUEST_STATUS;
             break;
 
         default:
             break;
     }
+
+    return STATE_MACHINE_POLL_MS;
 }
@@ -1,22 +1,171 @@
 #ifndef _state_machine_h
 #define _state_machine_h
 
+#include <stdint.h>
+
+#include <pico/critical_section.h>
+#include <pico/time.h>
+#include <pico/util/queue.h>
+
+#include "bentel_layer.h"
+#include "configuration.h"
+#include "event_log.h"
+
 typedef enum _state_t state_t;
 
 enum _state_t
 {
+    /** @brief the model, for the capacity */
     STATE_START = 1,
-    STATE_REQUEST_MODEL,
+    STATE_REQUEST_STATUS,
+    STATE_REQUEST_ARMED,
+    /**
+     * @brief after each status and armed poll while a sweep is
+     * running: the next of the identity requests (peripherals, zone
+     * and partition names, and the model again on a re-sweep), else the
+     * next of the 28 blocks of the panel event logger
+     */
+    STATE_REQUEST_SWEEP,
+};
+
+/*
+ * Commands to the panel, queued in batches of one or more. They jump
+ * the queue of the polls: the next calls of state_machine_next () send
+ * the commands of a batch back to back (STATE_MACHINE_COMMAND_MS
+ * apart), the one after them re-reads the armed partitions once for
+ * the whole batch, and the one after that checks the result of each
+ * command, a frame time (STATE_MACHINE_FRAME_MS) later.
+ */
+typedef enum _command_type_t command_type_t;
+
+enum _command_type_t
+{
+    /** @brief mask: partitions */
+    COMMAND_ARM = 1,
+    COMMAND_STAY,
+    COMMAND_DISARM,
+    /** @brief mask: zones */
+    COMMAND_EXCLUDE,
+    COMMAND_INCLUDE,
+    /** @brief alarm memory of all zones, mask unused */
+    COMMAND_RESET,
+};
+
+typedef enum _command_status_t command_status_t;
+
+enum _command_status_t
+{
+    /** @brief too old, or never queued */
+    COMMAND_UNKNOWN = 0,
+    COMMAND_QUEUED,
+    COMMAND_SENT,
+    /** @brief the re-read shows the panel in the requested state */
+    COMMAND_CONFIRMED,
+    COMMAND_FAILED,
+};
+
+typedef struct _command_t command_t;
+
+struct _command_t
+{
+    uint32_t id;
+    command_type_t type;
+    /** @brief bit n for partition or zone n */
+    uint32_t mask;
+};
+
+#define STATE_MACHINE_BATCH 8
+#define STATE_MACHINE_BATCHES 4
+/* enough for the queued batches and the one being sent */
+#define STATE_MACHINE_RESULTS \
+    ((STATE_MACHINE_BATCHES + 1) * STATE_MACHINE_BATCH)
+
+typedef struct _command_batch_t command_batch_t;
+
+struct _command_batch_t
+{
+    int count;
+    command_t commands[STATE_MACHINE_BATCH];
 };
 
+/* time for the longest response (a logger block) at 9600 baud */
+#define STATE_MACHINE_FRAME_MS 100
+/* time for the longest command and its acknowledge */
+#define STATE_MACHINE_COMMAND_MS 40
+/* period of the background polls */
+#define STATE_MACHINE_POLL_MS 1000
+
 typedef struct _state_machine_t state_machine_t;
 
 struct _state_machine_t
 {
+    bentel_layer_t * bentel_layer;
+    configuration_t * configuration;
+    /** @brief NULL if the logger is not kept in flash */
+    event_log_t * event_log;
+
     state_t state;
+
+    /** @brief next request of the identity sweep, -1 if none is running */
+    int identity;
+    /** @brief next block of the logger sweep, -1 if none is running */
+    int logger;
+
+    /** @brief status polls since the last identity sweep */
+    uint32_t cycles;
+    /** @brief status polls since the last logger sweep */
+    uint32_t logger_cycles;
+
+    absolute_time_t next_poll;
+    absolute_time_t link_free;
+
+    /** @brief of command_batch_t, filled from the HTTP handlers */
+    queue_t commands;
+    /** @brief the batch being sent and checked, if phase is not idle */
+    command_batch_t batch;
+    int sent;
+    int phase;
+
+    /** @brief next command id, only used by the HTTP handlers */
+    uint32_t next_id;
+
+    critical_section_t results_critsec;
+    struct
+    {
+        uint32_t id;
+        command_status_t status;
+    } results[STATE_MACHINE_RESULTS];
 };
 
-void state_machine_next (state_machine_t * machine);
+/*
+ * Sends at most one frame, and returns the time in ms until it wants
+ * to be called again. core1 calls it for every panel, and waits for
+ * the shortest of the times, or until a command is queued, with
+ * state_machine_wait ().
+ */
+uint32_t state_machine_next (state_machine_t * machine);
+
+void state_machine_wait (uint32_t timeout_ms);
+
+/*
+ * Queue a command, and set *id to the id to ask for its status with.
+ * Returns -1 if the queue is full, -2 for a listen-only panel. Only
+ * called from core0.
+ */
+int state_machine_command (state_machine_t * machine, command_type_t type,
+                           uint32_t mask, uint32_t * id);
+
+/*
+ * Queue the count commands (their type and mask) as one batch, all or
+ * none of them. They get consecutive ids starting from *first_id.
+ * Returns as state_machine_command (), or -3 for a bad count.
+ */
+int state_machine_batch (state_machine_t * machine,
+                         const command_t * commands, int count,
+                         uint32_t * first_id);
+
+command_status_t state_machine_command_status (state_machine_t * machine,
+                                               uint32_t id);
 
 void state_machine_start (state_machine_t *machine);
 
@@ -0,0 +1,46 @@
+#include "mbedtls/ssl_cache.h"
+
+#include "tls_stats.h"
+
+/*
+ * Only updated and read from the lwIP context (the TLS handshake and
+ * the HTTP handlers), so no locking is needed.
+ */
+static tls_stats_t tls_stats;
+
+int __real_mbedtls_ssl_cache_get (void * data, mbedtls_ssl_session * session);
+int __real_mbedtls_ssl_cache_set (void * data,
+                                  const mbedtls_ssl_session * session);
+
+int
+__wrap_mbedtls_ssl_cache_get (void * data, mbedtls_ssl_session * session)
+{
+    int ret;
+
+    ret = __real_mbedtls_ssl_cache_get (data, session);
+
+    if (ret == 0)
+    {
+        tls_stats.resumed++;
+    }
+    else
+    {
+        tls_stats.missed++;
+    }
+
+    return ret;
+}
+
+int
+__wrap_mbedtls_ssl_cache_set (void * data, const mbedtls_ssl_session * session)
+{
+    tls_stats.full++;
+
+    return __real_mbedtls_ssl_cache_set (data, session);
+}
+
+void
+tls_stats_get (tls_stats_t * stats)
+{
+    *stats = tls_stats;
+}
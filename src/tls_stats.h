@@ -0,0 +1,32 @@
+#ifndef _tls_stats_h_
+#define _tls_stats_h_
+
+#include <stdint.h>
+
+/*
+ * Handshake counters for the HTTPS build targets.
+ *
+ * The server keeps a small session-ID cache (lwIP altcp_tls_mbedtls
+ * with ALTCP_MBEDTLS_USE_SESSION_CACHE, see CMakeLists.txt), so that a
+ * client that reconnects can resume its session and skip the
+ * asymmetric operations of a full handshake. The counters are kept by
+ * wrapping mbedtls_ssl_cache_get() and mbedtls_ssl_cache_set() at link
+ * time:
+ *
+ * - full: handshakes that created a new session (cache set)
+ * - resumed: handshakes that resumed a cached session (cache hit)
+ * - missed: clients that offered a session that was not, or no longer,
+ *   in the cache, and fell back to a full handshake
+ */
+typedef struct _tls_stats_t tls_stats_t;
+
+struct _tls_stats_t
+{
+    uint32_t full;
+    uint32_t resumed;
+    uint32_t missed;
+};
+
+void tls_stats_get (tls_stats_t * stats);
+
+#endif /* _tls_stats_h_ */
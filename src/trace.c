@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include <pico/stdlib.h>
+#include <pico/sem.h>
+
+#include "trace.h"
+
+static trace_t * volatile traces = NULL;
+
+void __real_sem_acquire_blocking (semaphore_t * sem);
+void __wrap_sem_acquire_blocking (semaphore_t * sem);
+
+int
+trace_start (trace_t * t)
+{
+    int core;
+
+    for (core = 0 ; core < TRACE_CORES ; core++)
+    {
+        if (t[core].records == NULL || t[core].size == 0 ||
+            (t[core].size & (t[core].size - 1)) != 0)
+        {
+            return -1;
+        }
+
+        critical_section_init (&t[core].critsec);
+        t[core].head = 0;
+    }
+
+    traces = t;
+
+    return 0;
+}
+
+void
+trace_stop (void)
+{
+    traces = NULL;
+}
+
+void
+__time_critical_func(trace_write) (trace_event_t event, uint16_t arg)
+{
+    trace_t * trace;
+    trace_record_t * record;
+
+    if (traces == NULL)
+    {
+        return;
+    }
+
+    trace = &traces[get_core_num ()];
+
+    critical_section_enter_blocking (&trace->critsec);
+
+    record = &trace->records[trace->head % trace->size];
+    record->us = (uint32_t) to_us_since_boot (get_absolute_time ());
+    record->event = event;
+    record->arg = arg;
+    trace->head++;
+
+    critical_section_exit (&trace->critsec);
+}
+
+/*
+ * The semaphores are waited for through here (--wrap at link time, see
+ * CMakeLists.txt), only the waits that block are traced.
+ */
+void
+__wrap_sem_acquire_blocking (semaphore_t * sem)
+{
+    if (traces == NULL)
+    {
+        __real_sem_acquire_blocking (sem);
+        return;
+    }
+
+    if (sem_acquire_timeout_ms (sem, 0))
+    {
+        return;
+    }
+
+    trace_write (TRACE_SEM_WAIT_BEGIN, (uint16_t) (uintptr_t) sem);
+    __real_sem_acquire_blocking (sem);
+    trace_write (TRACE_SEM_WAIT_END, (uint16_t) (uintptr_t) sem);
+}
+
+int
+trace_read (uint8_t * buffer, int len)
+{
+    trace_header_t header;
+    trace_t * t;
+    uint32_t used;
+    uint32_t count;
+    uint32_t i;
+    int core;
+
+    t = traces;
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, TRACE_MAGIC, sizeof (header.magic));
+    header.version = TRACE_VERSION;
+    header.cores = TRACE_CORES;
+
+    if (sizeof (header) > (uint32_t) len)
+    {
+        return -1;
+    }
+
+    used = sizeof (header);
+
+    for (core = 0 ; t != NULL && core < TRACE_CORES ; core++)
+    {
+        critical_section_enter_blocking (&t[core].critsec);
+
+        count = (t[core].head < t[core].size) ? t[core].head : t[core].size;
+
+        if (used + count * sizeof (trace_record_t) > (uint32_t) len)
+        {
+            critical_section_exit (&t[core].critsec);
+            return -1;
+        }
+
+        for (i = 0 ; i < count ; i++)
+        {
+            memcpy (&buffer[used],
+                    &t[core].records[(t[core].head - count + i) % t[core].size],
+                    sizeof (trace_record_t));
+            used += sizeof (trace_record_t);
+        }
+
+        header.count[core] = count;
+        header.dropped[core] = t[core].head - count;
+
+        critical_section_exit (&t[core].critsec);
+    }
+
+    header.now_us = (uint32_t) to_us_since_boot (get_absolute_time ());
+
+    memcpy (buffer, &header, sizeof (header));
+
+    return used;
+}
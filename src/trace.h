@@ -0,0 +1,108 @@
+#ifndef _trace_h_
+#define _trace_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pico/critical_section.h>
+
+/*
+ * A timeline of what each core does, for the stalls that the counters
+ * of perf.h average away: a RAM ring per core of records of 8 bytes,
+ * the time (us since boot, 32 bits), an event and its argument. The
+ * newest are kept.
+ *
+ * /trace downloads the rings, and host/bentel_trace converts them to
+ * the Chrome trace format (chrome://tracing, ui.perfetto.dev), a track
+ * per core.
+ *
+ * trace_read () copies the rings out as a file: a trace_header_t,
+ * little endian, then the records of core 0, oldest first, then those
+ * of core 1. The time of a record is within 2^32 us (71 minutes)
+ * before now_us.
+ *
+ * trace_write () does nothing until trace_start (), so the calls stay
+ * in the firmware without TRACE_SIZE, see CMakeLists.txt.
+ */
+
+#define TRACE_CORES 2
+
+#define TRACE_MAGIC "BTRC"
+#define TRACE_VERSION 1
+
+typedef enum _trace_event_t trace_event_t;
+
+enum _trace_event_t
+{
+    /** @brief first character of a frame, arg: the character */
+    TRACE_FRAME_START = 1,
+    /** @brief a frame decoded and delivered, arg: its message type */
+    TRACE_FRAME_END,
+    /** @brief bentel_message_decode () of a whole frame, arg: its result */
+    TRACE_DECODE,
+    /** @brief a semaphore that was not available, arg: its address */
+    TRACE_SEM_WAIT_BEGIN,
+    TRACE_SEM_WAIT_END,
+    /** @brief an HTTP handler, arg: its perf_id_t */
+    TRACE_HANDLER_BEGIN,
+    TRACE_HANDLER_END,
+    /** @brief a request to the panel, arg: its message type */
+    TRACE_REQUEST_SENT,
+};
+
+typedef struct _trace_record_t trace_record_t;
+
+struct _trace_record_t
+{
+    uint32_t us;
+    uint16_t event;
+    uint16_t arg;
+};
+
+typedef struct _trace_header_t trace_header_t;
+
+struct _trace_header_t
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t cores;
+    uint8_t reserved[2];
+    /** @brief us since boot, when it was read */
+    uint32_t now_us;
+    /** @brief records of each core after the header */
+    uint32_t count[TRACE_CORES];
+    /** @brief records of each core lost to the ring */
+    uint32_t dropped[TRACE_CORES];
+};
+
+typedef struct _trace_t trace_t;
+
+struct _trace_t
+{
+    /* a power of 2, for the free running head */
+    trace_record_t * records;
+    uint32_t size;
+
+    /* set by trace_start () */
+    critical_section_t critsec;
+
+    /* free running, the ring index is modulo size */
+    uint32_t head;
+};
+
+/* Trace into traces[0] on core 0, traces[1] on core 1. */
+int trace_start (trace_t * traces);
+
+void trace_stop (void);
+
+/* Called from anywhere, also from interrupt handlers. */
+void trace_write (trace_event_t event, uint16_t arg);
+
+/*
+ * Copy the rings, header first, into buffer. Returns the length, or -1
+ * if they do not fit in len. Each core is held off tracing while its
+ * ring is copied.
+ */
+int trace_read (uint8_t * buffer, int len);
+
+#endif /* _trace_h_ */
@@ -1,27 +1,53 @@
 #include "uart_layer.h"
+#include "perf.h"
 
 #include <pico/stdlib.h>
 #include <hardware/uart.h>
 
 #include <stdio.h>
 
-void
-__time_critical_func(on_uart_rx)(void)
+/* the layer on each hardware UART, for the interrupt handlers */
+static uart_layer_t * uart_layers[NUM_UARTS];
+
+static void
+__time_critical_func(uart_layer_rx)(uart_layer_t * uart_layer)
 {
-    extern uart_layer_t uart_layer;
+    perf_stamp_t start;
+
+    perf_begin (&start);
 
-    if (uart_layer.upper_layer != NULL &&
-        uart_layer.ops != NULL &&
-        uart_layer.ops->to_upper_layer_received_message != NULL)
+    if (uart_layer != NULL &&
+        uart_layer->upper_layer != NULL &&
+        uart_layer->ops != NULL &&
+        uart_layer->ops->to_upper_layer_received_message != NULL)
     {
-        while (uart_is_readable (uart_layer.uart))
+        while (uart_is_readable (uart_layer->uart))
         {
-            uint8_t ch = uart_getc (uart_layer.uart);
+            uint8_t ch = uart_getc (uart_layer->uart);
 
-            uart_layer.ops->to_upper_layer_received_message (uart_layer.upper_layer,
-                                                             &ch, 1);
+            if (uart_layer->capture != NULL)
+            {
+                capture_write (uart_layer->capture, CAPTURE_RX, &ch, 1);
+            }
+
+            uart_layer->ops->to_upper_layer_received_message (uart_layer->upper_layer,
+                                                              &ch, 1);
         }
     }
+
+    perf_end (PERF_UART_RX, &start);
+}
+
+static void
+__time_critical_func(on_uart0_rx)(void)
+{
+    uart_layer_rx (uart_layers[0]);
+}
+
+static void
+__time_critical_func(on_uart1_rx)(void)
+{
+    uart_layer_rx (uart_layers[1]);
 }
 
 int
@@ -45,14 +71,16 @@ uart_layer_start (void * layer)
 
     uart_set_fifo_enabled (uart_layer->uart, true);
 
+    uart_layers[uart_get_index (uart_layer->uart)] = uart_layer;
+
     if (uart_layer->uart == uart0)
     {
-        irq_set_exclusive_handler (UART0_IRQ, on_uart_rx);
+        irq_set_exclusive_handler (UART0_IRQ, on_uart0_rx);
         irq_set_enabled (UART0_IRQ, true);
     }
     else
     {
-        irq_set_exclusive_handler (UART1_IRQ, on_uart_rx);
+        irq_set_exclusive_handler (UART1_IRQ, on_uart1_rx);
         irq_set_enabled (UART1_IRQ, true);
     }
 
@@ -67,6 +95,10 @@ uart_layer_stop (void * layer)
     uart_layer_t *uart_layer;
 
     uart_layer = (uart_layer_t *) layer;
+
+    uart_set_irq_enables (uart_layer->uart, false, false);
+
+    uart_layers[uart_get_index (uart_layer->uart)] = NULL;
 }
 
 int
@@ -79,6 +111,11 @@ uart_layer_send_message (void * layer, void * message, int len)
     uart_layer = (uart_layer_t *) layer;
     buffer = (const uint8_t *) message;
 
+    if (uart_layer->capture != NULL)
+    {
+        capture_write (uart_layer->capture, CAPTURE_TX, buffer, len);
+    }
+
     uart_write_blocking (uart_layer->uart, buffer, len);
 
     return 0;
@@ -5,6 +5,8 @@
 
 #include <hardware/uart.h>
 
+#include "capture.h"
+
 typedef struct _uart_layer_ops_t uart_layer_ops_t;
 
 struct _uart_layer_ops_t
@@ -27,6 +29,8 @@ struct _uart_layer_t
     int parity;
     void * upper_layer;
     uart_layer_ops_t *ops;
+    /* the bytes both ways are written here, if not NULL */
+    capture_t * capture;
 };
 
 int uart_layer_start (void * layer);
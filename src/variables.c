@@ -2,10 +2,17 @@
 #include "bentel_layer.h"
 #include "state_machine.h"
 #include "uart_layer.h"
+#include "pio_uart_layer.h"
 #include "logic.h"
+#include "mqtt_publisher.h"
+#include "event_log.h"
+#include "flash_store.h"
+#include "panel.h"
+#include "trace.h"
 
 configuration_t configuration =
 {
+    .identity_offset = FLASH_STORE_IDENTITY_OFFSET (0),
     .model = "",
     .fw_major = 0,
     .fw_minor = 0,
@@ -459,7 +466,40 @@ configuration_t configuration =
     .siren_state = false,
 };
 
-state_machine_t state_machine;
+event_log_t event_log =
+{
+    .offset = FLASH_STORE_EVENTS_OFFSET,
+    .sectors = FLASH_STORE_EVENTS_SECTORS,
+};
+
+#ifdef MQTT_BROKER
+mqtt_publisher_t mqtt_publisher =
+{
+    .configuration = &configuration,
+    .broker = MQTT_BROKER,
+    .port = MQTT_PORT,
+};
+#endif
+
+#ifdef CAPTURE_SIZE
+static uint8_t capture_ring[CAPTURE_SIZE];
+
+capture_t capture =
+{
+    .ring = capture_ring,
+    .size = CAPTURE_SIZE,
+};
+#endif
+
+#ifdef TRACE_SIZE
+static trace_record_t trace_records[TRACE_CORES][TRACE_SIZE];
+
+trace_t trace_rings[TRACE_CORES] =
+{
+    { .records = trace_records[0], .size = TRACE_SIZE, },
+    { .records = trace_records[1], .size = TRACE_SIZE, },
+};
+#endif
 
 /* forward declaration of uart_layer */
 uart_layer_t uart_layer;
@@ -479,6 +519,13 @@ bentel_layer_t bentel_layer =
     .upper_layer = &configuration,
 };
 
+state_machine_t state_machine =
+{
+    .bentel_layer = &bentel_layer,
+    .configuration = &configuration,
+    .event_log = &event_log,
+};
+
 uart_layer_ops_t uart_layer_ops =
 {
     .to_upper_layer_received_message = &bentel_layer_received_message,
@@ -497,4 +544,87 @@ uart_layer_t uart_layer =
     .parity = UART_PARITY_NONE,
     .upper_layer = &bentel_layer,
     .ops = &uart_layer_ops,
+#ifdef CAPTURE_SIZE
+    .capture = &capture,
+#endif
+};
+
+#ifdef PANEL1_RX_PIN
+/*
+ * A second panel on a PIO UART, see PANEL1_RX_PIN in CMakeLists.txt.
+ * Its state starts out empty like the first one's, so only the fields
+ * that differ are set.
+ */
+configuration_t configuration1 =
+{
+    .identity_offset = FLASH_STORE_IDENTITY_OFFSET (1),
+    .model = "",
+};
+
+pio_uart_layer_t pio_uart_layer1;
+
+bentel_layer_ops_t bentel_layer1_ops =
+{
+    .to_lower_layer_start_layer = pio_uart_layer_start,
+    .to_lower_layer_stop_layer = pio_uart_layer_stop,
+    .to_lower_layer_send_message = pio_uart_layer_send_message,
+    .to_upper_layer_received_message = handle_bentel_message,
+};
+
+bentel_layer_t bentel_layer1 =
+{
+    .ops = &bentel_layer1_ops,
+    .lower_layer = &pio_uart_layer1,
+    .upper_layer = &configuration1,
+    /* without a TX pin, only listen to another master's polling */
+    .listen_only = PANEL1_TX_PIN < 0,
+};
+
+state_machine_t state_machine1 =
+{
+    .bentel_layer = &bentel_layer1,
+    .configuration = &configuration1,
+    .event_log = NULL,
+};
+
+pio_uart_layer_t pio_uart_layer1 =
+{
+    .pio = pio0,
+    .speed = 9600,
+    .tx_pin = PANEL1_TX_PIN,
+    .rx_pin = PANEL1_RX_PIN,
+    .upper_layer = &bentel_layer1,
+    .ops = &uart_layer_ops,
 };
+#endif
+
+/*
+ * The panels, up to PANELS_MAX. Another panel needs its own
+ * configuration (with the next FLASH_STORE_IDENTITY_OFFSET), bentel
+ * layer, link layer and state machine; the event history in flash is
+ * only kept for the first one.
+ */
+panel_t panels[] =
+{
+    {
+        .name = "panel0",
+        .configuration = &configuration,
+        .bentel_layer = &bentel_layer,
+        .state_machine = &state_machine,
+        .event_log = &event_log,
+#ifdef CAPTURE_SIZE
+        .capture = &capture,
+#endif
+    },
+#ifdef PANEL1_RX_PIN
+    {
+        .name = "panel1",
+        .configuration = &configuration1,
+        .bentel_layer = &bentel_layer1,
+        .state_machine = &state_machine1,
+        .event_log = NULL,
+    },
+#endif
+};
+
+const int panels_count = sizeof (panels) / sizeof (panels[0]);
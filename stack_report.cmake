@@ -0,0 +1,103 @@
+# Stack and RAM budget report, see stack_report.py.
+#
+# The sources of an executable are compiled with -fcallgraph-info=su,
+# that makes gcc write, next to each object, the stack frame of each
+# function (as -fstack-usage does) together with the calls it makes.
+# The report adds up the frames down the call graph from the roots of
+# each path, and the .data and .bss of each module from the map file of
+# the link:
+#	make stack-report-my_executable
+# It fails when a budget is exceeded.
+#
+# The paths are:
+# - irq: the interrupt handlers of the links to the panel, and of the
+#   temperature sensor (on core1)
+# - http: the response handlers, all called from timed_handler()
+# - core1: the main loop of core1, that polls the panels
+#
+# The budgets are in bytes, and may be given in the cmake invocation:
+#	-DSTACK_BUDGET_IRQ=... -DSTACK_BUDGET_HTTP=... -DSTACK_BUDGET_CORE1=...
+#	-DSTACK_BUDGET_FUNCTION=... -DRAM_BUDGET=...
+# The stacks of the SDK are 2 KB per core (PICO_STACK_SIZE and
+# PICO_CORE1_STACK_SIZE), the handlers of the interrupts run on the
+# stack of the core they interrupt.
+
+find_package(Python3 COMPONENTS Interpreter)
+set(STACK_REPORT_PY ${CMAKE_CURRENT_LIST_DIR}/stack_report.py)
+
+set(STACK_BUDGET_IRQ 1024 CACHE STRING
+  "stack budget of the interrupt handlers, bytes")
+set(STACK_BUDGET_HTTP 1536 CACHE STRING
+  "stack budget of the HTTP response handlers, bytes")
+set(STACK_BUDGET_CORE1 1536 CACHE STRING
+  "stack budget of the main loop of core1, bytes")
+set(STACK_BUDGET_FUNCTION 1024 CACHE STRING
+  "stack budget of any one function, bytes")
+set(RAM_BUDGET 204800 CACHE STRING
+  "budget of .data and .bss together, bytes")
+
+# gcc does not follow the calls through function pointers: the
+# functions the pointers of each caller (as named after inlining) may
+# reach.
+set(STACK_REPORT_HANDLERS
+  batch_handler bootloader_handler capture_handler command_handler
+  connections_handler delta_handler events_handler ha_handler log_handler
+  led_handler netinfo_handler panels_handler perf_handler ram_handler
+  rssi_handler temp_handler tls_handler trace_handler
+)
+string(REPLACE ";" "," STACK_REPORT_HANDLERS "${STACK_REPORT_HANDLERS}")
+
+# The encoders of the commands, through the table of
+# src/bentel_layer_private.c.
+set(STACK_REPORT_ENCODERS
+  bentel_ARM_PARTITIONS_encode bentel_BYPASS_ZONES_encode
+  bentel_RESET_ALARMS_encode
+)
+string(REPLACE ";" "," STACK_REPORT_ENCODERS "${STACK_REPORT_ENCODERS}")
+
+set(STACK_REPORT_CALLS
+  --call uart_layer_rx=bentel_layer_received_message
+  --call on_uart0_rx=bentel_layer_received_message
+  --call on_uart1_rx=bentel_layer_received_message
+  --call on_dma_complete=bentel_layer_received_message
+  --call pio_uart_layer_poll=bentel_layer_received_message
+  --call bentel_layer_received_message=handle_bentel_message
+  --call bentel_layer_receive=handle_bentel_message
+  --call bentel_layer_sniff=handle_bentel_message
+  --call bentel_layer_deliver=handle_bentel_message
+  --call bentel_layer_send_message=uart_layer_send_message,pio_uart_layer_send_message
+  --call bentel_message_encode=${STACK_REPORT_ENCODERS}
+  --call timed_handler=${STACK_REPORT_HANDLERS}
+)
+
+# Creates a target for the report of an executable.
+#
+# CMakeLists.txt should include:
+#	stack_report_add_target(my_executable)
+# for a target defined in add_executable(), after it is configured.
+function(stack_report_add_target EXECUTABLE_NAME)
+  if (NOT Python3_Interpreter_FOUND)
+    message(WARNING "not generating stack report target for ${EXECUTABLE_NAME}: python3 not found")
+    return()
+  endif()
+
+  target_compile_options(${EXECUTABLE_NAME} PRIVATE -fcallgraph-info=su)
+
+  add_custom_target(stack-report-${EXECUTABLE_NAME}
+    COMMAND ${Python3_EXECUTABLE} ${STACK_REPORT_PY}
+      --ci-dir ${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${EXECUTABLE_NAME}.dir
+      --map $<TARGET_FILE:${EXECUTABLE_NAME}>.map
+      --path irq=on_uart0_rx,on_uart1_rx,on_dma_complete,pio_uart_layer_poll,temp_isr
+      --path http=timed_handler
+      --path core1=core1_main
+      ${STACK_REPORT_CALLS}
+      --budget irq=${STACK_BUDGET_IRQ}
+      --budget http=${STACK_BUDGET_HTTP}
+      --budget core1=${STACK_BUDGET_CORE1}
+      --budget-function ${STACK_BUDGET_FUNCTION}
+      --budget-ram ${RAM_BUDGET}
+    DEPENDS ${EXECUTABLE_NAME}
+    COMMENT "Stack and RAM budget report of ${EXECUTABLE_NAME}"
+    VERBATIM
+  )
+endfunction()
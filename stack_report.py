@@ -0,0 +1,343 @@
+#!/usr/bin/env python3
+#
+# Stack and RAM budget report, see stack_report.cmake.
+#
+# Reads the call graphs that gcc writes with -fcallgraph-info=su (a .ci
+# file next to each object) and the map file of the link, and reports:
+#
+# - the stack frame of each function, largest first
+# - the worst case stack depth of each path, from its roots down the
+#   call graph, with the chain that reaches it
+# - the .data and .bss of each module
+#
+# and exits with 1 if any of the budgets given is exceeded.
+#
+# gcc cannot follow calls through function pointers; --call names the
+# functions that the indirect calls of a caller (after inlining, as
+# reported) may reach. Functions without call graph information (libc,
+# libgcc, assembler) count as 0 and are listed as unknown.
+
+import argparse
+import os
+import re
+import sys
+
+INDIRECT = '__indirect_call'
+
+NODE_RE = re.compile(r'^node: \{ title: "([^"]*)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "([^"]*)" targetname: "([^"]*)"')
+STACK_RE = re.compile(r'\\n(\d+) bytes \(([a-z,]+)\)')
+
+MAP_START = 'Linker script and memory map'
+MAP_OUTPUT_RE = re.compile(r'^(\.\S+)(?:\s+0x[0-9a-f]+\s+0x[0-9a-f]+)?')
+MAP_INPUT_RE = re.compile(r'^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$')
+MAP_INPUT_NAME_RE = re.compile(r'^ (\S+)$')
+MAP_INPUT_REST_RE = re.compile(r'^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$')
+
+# output sections in RAM, and the column they count in
+MAP_RAM = {
+    '.data': 'data',
+    '.sdata': 'data',
+    '.scratch_x': 'data',
+    '.scratch_y': 'data',
+    '.bss': 'bss',
+    '.sbss': 'bss',
+    '.uninitialized_data': 'bss',
+}
+
+
+class Function:
+    def __init__(self, title, name, location):
+        self.title = title
+        self.name = name
+        self.location = location
+        self.stack = 0
+        self.bounded = True
+        self.calls = set()
+        self.indirect = False
+
+
+def short_name(title):
+    return title.rsplit(':', 1)[-1]
+
+
+def read_callgraph(path, functions, edges):
+    with open(path, errors='replace') as ci:
+        for line in ci:
+            m = NODE_RE.match(line)
+            if m:
+                title, label = m.groups()
+                s = STACK_RE.search(label)
+                # only the functions defined here have a stack
+                if s is None:
+                    continue
+                parts = label.split('\\n')
+                fn = Function(title, short_name(title),
+                              parts[1] if len(parts) > 1 else '')
+                fn.stack = int(s.group(1))
+                fn.bounded = 'dynamic' not in s.group(2).split(',') or \
+                    'bounded' in s.group(2).split(',')
+                functions[title] = fn
+                continue
+            m = EDGE_RE.match(line)
+            if m:
+                edges.append(m.groups())
+
+
+def read_callgraphs(directories):
+    functions = {}
+    edges = []
+
+    for directory in directories:
+        for root, _, files in os.walk(directory):
+            for f in sorted(files):
+                if f.endswith('.ci'):
+                    read_callgraph(os.path.join(root, f), functions, edges)
+
+    # calls within a file are by title, calls to other files by name
+    by_name = {}
+    for fn in functions.values():
+        by_name.setdefault(fn.name, []).append(fn)
+
+    for source, target in edges:
+        caller = functions.get(source)
+        if caller is None:
+            continue
+        if target == INDIRECT:
+            caller.indirect = True
+        else:
+            caller.calls.add(target)
+
+    return functions, by_name
+
+
+def resolve(functions, by_name, title):
+    """The function a call target stands for, or None if unknown."""
+    if title in functions:
+        return functions[title]
+    # a name defined in more than one file (statics): the deepest
+    # frame, to stay on the safe side
+    candidates = by_name.get(short_name(title), [])
+    if not candidates:
+        return None
+    return max(candidates, key=lambda fn: fn.stack)
+
+
+class Path:
+    def __init__(self, functions, by_name, indirect):
+        self.functions = functions
+        self.by_name = by_name
+        self.indirect = indirect
+        self.memo = {}
+        self.active = set()
+        self.unknown = set()
+        self.unresolved = set()
+        self.recursive = set()
+        self.unbounded = set()
+
+    def callees(self, fn):
+        for target in sorted(fn.calls):
+            yield target
+        if fn.indirect:
+            targets = self.indirect.get(fn.name)
+            if targets is None:
+                self.unresolved.add(fn.name)
+            else:
+                for target in targets:
+                    yield target
+
+    def depth(self, fn):
+        """(bytes, chain) of the deepest chain from fn"""
+        if fn.title in self.memo:
+            return self.memo[fn.title]
+        if fn.title in self.active:
+            self.recursive.add(fn.name)
+            return (0, [])
+        if not fn.bounded:
+            self.unbounded.add(fn.name)
+
+        self.active.add(fn.title)
+        best = (0, [])
+        for target in self.callees(fn):
+            callee = resolve(self.functions, self.by_name, target)
+            if callee is None:
+                self.unknown.add(target)
+                continue
+            d = self.depth(callee)
+            if d[0] > best[0]:
+                best = d
+        self.active.discard(fn.title)
+
+        result = (fn.stack + best[0], [fn.name] + best[1])
+        self.memo[fn.title] = result
+        return result
+
+
+def module_name(path):
+    # archive(member.o) or path/member.o
+    m = re.search(r'\(([^)]+)\)$', path)
+    name = m.group(1) if m else os.path.basename(path)
+    for suffix in ('.obj', '.o'):
+        if name.endswith(suffix):
+            name = name[:-len(suffix)]
+    return name
+
+
+def read_map(path):
+    modules = {}
+    started = False
+    output = None
+    pending = None
+
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if not started:
+                started = line.startswith(MAP_START)
+                continue
+
+            if pending is not None:
+                m = MAP_INPUT_REST_RE.match(line)
+                pending = None
+                if m and output in MAP_RAM:
+                    size = int(m.group(2), 16)
+                    add_module(modules, m.group(3), MAP_RAM[output], size)
+                continue
+
+            if line.startswith('.'):
+                m = MAP_OUTPUT_RE.match(line)
+                output = m.group(1) if m else None
+                continue
+
+            m = MAP_INPUT_RE.match(line)
+            if m:
+                if output in MAP_RAM and m.group(1) != '*fill*':
+                    size = int(m.group(3), 16)
+                    add_module(modules, m.group(4), MAP_RAM[output], size)
+                continue
+
+            m = MAP_INPUT_NAME_RE.match(line)
+            if m and m.group(1) != '*fill*':
+                pending = m.group(1)
+
+    return modules
+
+
+def add_module(modules, path, column, size):
+    if size == 0:
+        return
+    entry = modules.setdefault(module_name(path.strip()),
+                               {'data': 0, 'bss': 0})
+    entry[column] += size
+
+
+def parse_pairs(values, what):
+    pairs = {}
+    for value in values or []:
+        if '=' not in value:
+            sys.exit('stack_report: %s %s: expected name=...' % (what, value))
+        name, rest = value.split('=', 1)
+        pairs[name] = rest
+    return pairs
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stack and RAM budget report')
+    parser.add_argument('--ci-dir', required=True, action='append',
+                        help='directory searched for the .ci files')
+    parser.add_argument('--map', help='map file of the link')
+    parser.add_argument('--path', action='append', metavar='NAME=ROOT,...',
+                        help='a path and the functions it starts from')
+    parser.add_argument('--call', action='append', metavar='CALLER=CALLEE,...',
+                        help='the functions the indirect calls of CALLER reach')
+    parser.add_argument('--budget', action='append', metavar='NAME=BYTES',
+                        help='stack budget of a path')
+    parser.add_argument('--budget-function', type=int, metavar='BYTES',
+                        help='stack budget of any one function')
+    parser.add_argument('--budget-ram', type=int, metavar='BYTES',
+                        help='budget of .data and .bss together')
+    parser.add_argument('--top', type=int, default=20,
+                        help='functions and modules listed (default 20)')
+    args = parser.parse_args()
+
+    functions, by_name = read_callgraphs(args.ci_dir)
+    if not functions:
+        sys.exit('stack_report: no .ci files in %s, built without '
+                 '-fcallgraph-info=su?' % ', '.join(args.ci_dir))
+
+    indirect = {name: [t for t in targets.split(',') if t]
+                for name, targets in parse_pairs(args.call, '--call').items()}
+    paths = parse_pairs(args.path, '--path')
+    budgets = {name: int(v)
+               for name, v in parse_pairs(args.budget, '--budget').items()}
+    over = []
+
+    print('Stack per function (bytes):')
+    ranked = sorted(functions.values(), key=lambda fn: -fn.stack)
+    for fn in ranked[:args.top]:
+        print('%8d%s  %-40s %s' % (fn.stack, ' ' if fn.bounded else '+',
+                                   fn.name, fn.location))
+    if args.budget_function is not None and ranked:
+        if ranked[0].stack > args.budget_function:
+            over.append('function %s: %d > %d bytes' %
+                        (ranked[0].name, ranked[0].stack,
+                         args.budget_function))
+
+    if paths:
+        print()
+        print('Worst case stack per path (bytes):')
+    for name, roots in paths.items():
+        path = Path(functions, by_name, indirect)
+        best = (0, [])
+        missing = []
+        for root in [r for r in roots.split(',') if r]:
+            fn = resolve(functions, by_name, root)
+            if fn is None:
+                missing.append(root)
+                continue
+            d = path.depth(fn)
+            if d[0] > best[0]:
+                best = d
+        print('%8d  %s: %s' % (best[0], name, ' > '.join(best[1])))
+        for label, names in (('roots not found', missing),
+                             ('unresolved indirect calls in',
+                              path.unresolved),
+                             ('recursion in', path.recursive),
+                             ('dynamic stack in', path.unbounded),
+                             ('unknown (counted as 0)', path.unknown)):
+            if names:
+                print('          %s: %s' % (label, ', '.join(sorted(names))))
+        if name in budgets and best[0] > budgets[name]:
+            over.append('path %s: %d > %d bytes' %
+                        (name, best[0], budgets[name]))
+
+    if args.map:
+        modules = read_map(args.map)
+        total = {'data': 0, 'bss': 0}
+        for entry in modules.values():
+            for column in total:
+                total[column] += entry[column]
+        print()
+        print('RAM per module (bytes):')
+        print('%8s %8s  %s' % ('data', 'bss', 'module'))
+        ranked = sorted(modules.items(),
+                        key=lambda item: -(item[1]['data'] + item[1]['bss']))
+        for module, entry in ranked[:args.top]:
+            print('%8d %8d  %s' % (entry['data'], entry['bss'], module))
+        print('%8d %8d  total' % (total['data'], total['bss']))
+        if args.budget_ram is not None and \
+           total['data'] + total['bss'] > args.budget_ram:
+            over.append('ram: %d > %d bytes' %
+                        (total['data'] + total['bss'], args.budget_ram))
+
+    if over:
+        print()
+        for line in over:
+            print('OVER BUDGET: %s' % line)
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -12,16 +12,16 @@
  *
  * - converting the temperature scale preferred by the user
  *
- * - periodically updating measurements from the server side
- *   (temperature and signal strength)
+ * - keeping the panel state, temperature and signal strength up to
+ *   date from the /delta stream
  */
 
 /*
- * Intervals at which update requests for /temp and /rssi are sent
- * (staggered a bit).
+ * Pause between the end of one /delta request and the start of the
+ * next. Requests are chained, never overlapping, and stop while the
+ * window is hidden.
  */
-const TEMP_UPDATE_INTVL_MS = 2 * 2718;
-const RSSI_UPDATE_INTVL_MS = 3 * 3141;
+const DELTA_UPDATE_INTVL_MS = 2000;
 
 /*
  * The preferred temperature scale (K, C, F) is stored in browser
@@ -39,6 +39,28 @@ const DEFAULT_SCALE_PREF = 'K';
 let scalePref = DEFAULT_SCALE_PREF;
 let tempK = 0.0;
 
+/*
+ * The "gen" field of the last /delta response. The server only sends
+ * entities that changed after this generation.
+ */
+let generation = 0;
+/*
+ * The "epoch" field of the last /delta response, drawn by the server at
+ * each boot. The generations restart at boot, so when it changes, the
+ * generation above means nothing to the server any more.
+ */
+let epoch = null;
+let deltaTimeout = -1;
+let deltaInFlight = false;
+
+/*
+ * The page's own ?panel=<n> parameter is passed on to /delta, so that
+ * one copy of the app serves every panel.
+ */
+const panelParam = new URLSearchParams(location.search).get("panel");
+const panelQuery = panelParam === null ? "" :
+      "&panel=" + encodeURIComponent(panelParam);
+
 /* Cache document elements */
 const tempValElem = document.getElementById("tempValue");
 const tempScaleElem = document.getElementById("tempScale");
@@ -71,6 +93,12 @@ const ssidElem = document.getElementById("ssid");
 const rssiElem = document.getElementById("rssi");
 const ssElem = document.getElementById("ss_pct");
 
+const modelElem = document.getElementById("model");
+const fwElem = document.getElementById("fw");
+const zonesBodyElem = document.getElementById("zonesBody");
+const partitionsBodyElem = document.getElementById("partitionsBody");
+const faultsBodyElem = document.getElementById("faultsBody");
+
 const toastElem = document.getElementById("toast");
 const errMsgElem = document.getElementById("errMsg");
 
@@ -130,33 +158,17 @@ function renderTemp(tmpK, scale) {
 }
 
 /*
- * Update the temperature value.
- *
- * If the browser window is currently not visible, do nothing.
- *
- * Otherwise fetch the value from the /temp request. If the fetch is
- * successful, then the response body is the temperature in degrees
+ * Update the temperature value, given the temperature in degrees
  * Kelvin as a Q18.14 fixed-point number (18 integer bits and 14
- * fractional bits). Scale it down, and call renderTemp() to display
- * the value.
+ * fractional bits), as sent in the "temp" field of /delta. The value
+ * 4294967295 (UINT32_MAX) means that no valid reading is available.
+ * Scale it down, and call renderTemp() to display the value.
  */
-async function updateTemp() {
-    if (document.visibilityState === "hidden") {
+function updateTemp(tempK_q18_14) {
+    if (tempK_q18_14 > 2147483647)
         return;
-    }
-
-    try {
-        let response = await getResp("/temp");
-        let body = await response.text();
-        let tempK_q18_14 = parseInt(body);
-        if (tempK_q18_14 == NaN)
-            throw new Error("/temp response body: " + body);
-        tempK = tempK_q18_14 / 16384.0;
-        renderTemp(tempK, scalePref);
-    }
-    catch (ex) {
-        toast(ex);
-    }
+    tempK = tempK_q18_14 / 16384.0;
+    renderTemp(tempK, scalePref);
 }
 
 /*
@@ -295,73 +307,214 @@ async function updateNetinfo() {
 }
 
 /*
- * Update the measurement of the access point's signal strength.
- *
- * If the browser window is currently not visible, do nothing.
- *
- * Otherwise fetch the response for /rssi. If the fetch is successful,
- * the response body is a JSON document with the rssi in dBm, and a boolean
- * field indicating whether the rssi is valid.
+ * Update the measurement of the access point's signal strength, from
+ * the "rssi" field of /delta in dBm. The value 2147483647 (INT32_MAX)
+ * means that the rssi is not valid, in which case do nothing.
  *
- * If the value is not valid, do nothing. Otherwise fill the UI element
- * for the rssi, as well as for the signal strength in percent.
- *
- * We use a common formula: %strength = 2 * (100 + rssi)
- * capped to the range 0 to 100.
+ * Otherwise fill the UI element for the rssi, as well as for the
+ * signal strength in percent. We use a common formula:
+ * %strength = 2 * (100 + rssi) capped to the range 0 to 100.
  */
-async function updateRssi() {
-    if (document.visibilityState === "hidden") {
+function updateRssi(rssi) {
+    if (rssi == 2147483647)
+        return;
+    setText(rssiElem, rssi.toString());
+    setText(ssElem,
+            Math.min(Math.max(2 * (100 + rssi), 0), 100).toString());
+    rssiTextElem.style.display = "inline";
+}
+
+/*
+ * DOM patching helpers: only touch a node if its contents actually
+ * change, so that an update that repeats the current state costs
+ * nothing in the browser.
+ */
+function setText(elem, text) {
+    if (elem.textContent !== text)
+        elem.textContent = text;
+}
+
+function setFlag(elem, on) {
+    setText(elem, on ? "\u25cf" : "\u00b7");
+    elem.classList.toggle("flagOn", Boolean(on));
+}
+
+/*
+ * Rows of the zones and partitions tables are created on the first
+ * delta that mentions them, and cached here by index, together with
+ * their cells.
+ */
+const zoneRows = {};
+const partitionRows = {};
+const faultRows = {};
+
+const ZONE_FIELDS =
+      ["alarm", "sabotage", "included", "alarm_memory", "sabotage_memory"];
+const PARTITION_FIELDS = ["alarm", "armed"];
+
+/*
+ * Create a table row with a label cell and one cell per field, and
+ * insert it into tbody, ordered by index.
+ */
+function makeRow(tbody, rows, idx, fields) {
+    let tr = document.createElement("tr");
+    let row = { tr: tr, idx: idx, cells: {} };
+    let label = document.createElement("td");
+    label.textContent = idx.toString();
+    tr.appendChild(label);
+    row.cells.name = document.createElement("td");
+    tr.appendChild(row.cells.name);
+    for (const field of fields) {
+        let td = document.createElement("td");
+        td.classList.add("flag");
+        row.cells[field] = td;
+        tr.appendChild(td);
+    }
+
+    let next = null;
+    for (const other of Object.values(rows)) {
+        if (other.idx > idx && (next == null || other.idx < next.idx))
+            next = other;
+    }
+    tbody.insertBefore(tr, next == null ? null : next.tr);
+    rows[idx] = row;
+    return row;
+}
+
+function patchEntities(tbody, rows, entities, fields) {
+    for (const [key, entity] of Object.entries(entities)) {
+        let idx = parseInt(key);
+        let row = rows[idx] || makeRow(tbody, rows, idx, fields);
+        setText(row.cells.name, entity.name);
+        for (const field of fields)
+            setFlag(row.cells[field], entity[field]);
+    }
+}
+
+/* Drop the rows beyond the capacity of the panel model. */
+function trimEntities(rows, count) {
+    for (const [key, row] of Object.entries(rows)) {
+        if (row.idx >= count) {
+            row.tr.remove();
+            delete rows[key];
+        }
+    }
+}
+
+function patchFaults(faults) {
+    for (const [name, on] of Object.entries(faults)) {
+        let row = faultRows[name];
+        if (row === undefined) {
+            row = { tr: document.createElement("tr") };
+            let label = document.createElement("td");
+            label.textContent = name.replace(/_/g, " ");
+            row.flag = document.createElement("td");
+            row.flag.classList.add("flag");
+            row.tr.appendChild(label);
+            row.tr.appendChild(row.flag);
+            faultsBodyElem.appendChild(row.tr);
+            faultRows[name] = row;
+        }
+        setFlag(row.flag, on);
+    }
+}
+
+/*
+ * Apply one /delta response. Only the entities that are present in
+ * the response have changed; everything else is left alone.
+ */
+function applyDelta(data) {
+    updateTemp(data.temp);
+    updateRssi(data.rssi);
+    if (data.model !== undefined) {
+        setText(modelElem, data.model);
+        setText(fwElem, data.fw);
+    }
+    if (data.capacity !== undefined) {
+        trimEntities(zoneRows, data.capacity.zones);
+        trimEntities(partitionRows, data.capacity.partitions);
+    }
+    if (data.zones !== undefined)
+        patchEntities(zonesBodyElem, zoneRows, data.zones, ZONE_FIELDS);
+    if (data.partitions !== undefined)
+        patchEntities(partitionsBodyElem, partitionRows, data.partitions,
+                      PARTITION_FIELDS);
+    if (data.faults !== undefined)
+        patchFaults(data.faults);
+    generation = data.gen;
+}
+
+/*
+ * Fetch /delta for everything newer than the last generation seen,
+ * apply it, and schedule the next request. Requests are chained with
+ * setTimeout() rather than setInterval(), so a slow response never
+ * causes requests to pile up, and polling stops entirely while the
+ * window is hidden.
+ */
+async function updateDelta() {
+    deltaTimeout = -1;
+    if (deltaInFlight || document.visibilityState === "hidden") {
         return;
     }
 
-    let data = null;
+    deltaInFlight = true;
     try {
-        let response = await getResp("/rssi");
-        data = await response.json();
+        let since = generation;
+        let response = await getResp("/delta?since=" + since + panelQuery);
+        let data = await response.json();
+        applyDelta(data);
+        if (data.epoch !== epoch) {
+            /*
+             * The server rebooted: this delta may miss entities that
+             * changed before our old generation. Start again from 0.
+             */
+            if (epoch !== null && since != 0) {
+                generation = 0;
+                deltaTimeout = setTimeout(updateDelta, 0);
+            }
+            epoch = data.epoch;
+        }
     }
     catch (ex) {
         toast(ex);
-        return;
     }
+    deltaInFlight = false;
 
-    if (data.valid) {
-        rssiElem.textContent = data.rssi.toString();
-        ssElem.textContent
-            = Math.min(Math.max(2 * (100 + data.rssi), 0), 100).toString();
-        rssiTextElem.style.display = "inline";
-    }
+    if (deltaTimeout == -1)
+        deltaTimeout = setTimeout(updateDelta, DELTA_UPDATE_INTVL_MS);
 }
 
 /*
  * Event listener for visibility changes. If the browser window
- * becomes visible, initiate updates for the temperature and signal
- * strength.
+ * becomes visible, resume the /delta updates right away.
  */
 async function updateOnVisible() {
     if (document.visibilityState === "hidden") {
         return;
     }
 
-    await updateTemp();
-    await updateRssi();
+    if (deltaTimeout != -1) {
+        clearTimeout(deltaTimeout);
+        deltaTimeout = -1;
+    }
+    await updateDelta();
 }
 
 /*
  * At initialization:
  *
- * - initiate fetches for the temperature, LED state, network info, and
- *   the signal strength
- *
  * - get the preferred temperature scale from browser localStorage,
  *   or set the default if it's never been stored
  *
+ * - initiate fetches for the LED state and network info
+ *
  * - set event listeners for visibility changes, the temperature scale
  *   buttons, and the LED buttons
  *
- * - start periodic updates for temperature and signal strength
+ * - start the /delta updates; the first one (since=0) fills in the
+ *   whole panel state, the temperature and the signal strength
  */
 async function init() {
-    await updateTemp();
     let scale = localStorage.getItem(SCALE_PREF_KEY);
     if (scale == null) {
         scale = DEFAULT_SCALE_PREF;
@@ -369,7 +522,6 @@ async function init() {
     doScale(scale);
     await updateLed();
     await updateNetinfo();
-    await updateRssi();
 
     document.addEventListener("visibilitychange", updateOnVisible);
 
@@ -381,8 +533,7 @@ async function init() {
     ledBtnOff.addEventListener("click", ledDoOff);
     ledBtnToggle.addEventListener("click", ledDoToggle);
 
-    setInterval(updateTemp, TEMP_UPDATE_INTVL_MS);
-    setInterval(updateRssi, RSSI_UPDATE_INTVL_MS);
+    await updateDelta();
 }
 
 /* Run initialization when the document has been loaded. */